@@ -28,6 +28,8 @@
 # LOG
 # ---
 #
+# 2008/03/09    #136: The code objs of an image keep its string
+# 2008/02/12    #124: Read chars through STRING_GET_CHARS()
 # 2007/01/23    Deleted ram-hogging copyright statement (I don't believe this should be in the binaries)
 # 2006/11/24    #26: Implement more builtin functions
 # 2006/08/21    #28: Adapt native libs to use the changed func calls
@@ -378,7 +380,7 @@ def ord(s):
     }
 
     /* Get integer value of character */
-    n = ((pPmString_t)ps)->val[0];
+    n = STRING_GET_CHARS(ps)[0];
     retval = int_new(n, &pn);
     NATIVE_SET_TOS(pn);
     return retval;
@@ -584,7 +586,7 @@ def list(o):
         /* Get each char from the string, pack it into an int, and add it to the list */
         for (; i < ((pPmString_t)piter)->length; i++)
         {
-            retval = int_new((((pPmString_t)piter)->val)[i], &pobj);
+            retval = int_new(STRING_GET_CHARS(piter)[i], &pobj);
             PM_RETURN_IF_ERROR(retval);
             retval = list_append(plist, pobj);
             PM_RETURN_IF_ERROR(retval);
@@ -660,9 +662,11 @@ def Co(i):
         return retval;
     }
 
-    /* Create a code object from the image */
-    imgaddr = (uint8_t *)&((pPmString_t)pimg)->val;
+    /* Create a code object from the image; it keeps the string */
+    imgaddr = STRING_GET_CHARS(pimg);
+    gVmGlobal.pimgstr = pimg;
     retval = obj_loadFromImg(MEMSPACE_RAM, &imgaddr, &pco);
+    gVmGlobal.pimgstr = C_NULL;
     PM_RETURN_IF_ERROR(retval);
 
     /* Return the code object */
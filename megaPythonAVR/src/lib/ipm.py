@@ -22,71 +22,256 @@
 # LOG
 # ---
 #
+# 2008/03/25    #144: Get a large image in parts, each referred to as in a pool
+# 2008/03/11    #137: Get the image in frames with a CRC each, straight into
+#               its string
+# 2008/03/09    #136: Get the rest of the image with plat_getBytes()
+# 2008/02/12    #124: Make the image string with string_alloc()
 # 2006/12/30    Created.
 #
 
 
+"""__NATIVE__
+/*
+ * The host sends an image in frames: a type byte, the payload length
+ * (2 bytes, little endian), the payload and a CRC-16 (CCITT, 2 bytes,
+ * little endian) of the length and payload.  The image is the payloads
+ * of its frames in order, and a frame of length 0 ends it.  The host
+ * ends the session by sending some other type byte instead of an image.
+ *
+ * An image too large for one string comes in parts: each nested code
+ * image is sent ahead, innermost first, in frames of its own type.
+ * The image that holds it refers to it by its index among the parts
+ * (OBJ_TYPE_PRF, as to a pool), so each string holds one code image.
+ */
+
+/** Type byte of the frames of an image */
+#define IPM_FRAME_IMG 'I'
+
+/** Type byte of the frames of a part of a later image */
+#define IPM_FRAME_PART 'P'
+
+/** Adds the bytes to the CRC-16 (CCITT) */
+static uint16_t
+ipm_crc(uint16_t crc, uint8_t const *pbuf, uint16_t n)
+{
+    uint8_t i;
+
+    while (n-- > 0)
+    {
+        crc ^= (uint16_t)*pbuf++ << 8;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                                 : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/** Gets all n bytes, as many at a time as came */
+static PmReturn_t
+ipm_get(uint8_t *pbuf, uint16_t n)
+{
+    PmReturn_t retval = PM_RET_OK;
+    uint16_t got;
+
+    while (n > 0)
+    {
+        retval = plat_getBytes(pbuf, n, &got);
+        PM_RETURN_IF_ERROR(retval);
+        pbuf += got;
+        n -= got;
+    }
+    return retval;
+}
+
+/** Loads the code obj of the image in the string; its refs are to parts */
+static PmReturn_t
+ipm_load(pPmObj_t pimg, pPmObj_t pparts, pPmObj_t *r_pco)
+{
+    PmReturn_t retval;
+    pPmObj_t ppool;
+    uint8_t const *imgaddr;
+    int16_t i;
+
+    /* Put the parts in a tuple, as the pool of an image set is */
+    retval = tuple_new(((pPmList_t)pparts)->length, &ppool);
+    PM_RETURN_IF_ERROR(retval);
+    for (i = 0; i < ((pPmList_t)pparts)->length; i++)
+    {
+        retval = list_getItem(pparts, i, &((pPmTuple_t)ppool)->val[i]);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* The code obj keeps the string */
+    imgaddr = STRING_GET_CHARS(pimg);
+    gVmGlobal.pimgstr = pimg;
+    gVmGlobal.pimgpool = (pPmTuple_t)ppool;
+    retval = obj_loadFromImg(MEMSPACE_RAM, &imgaddr, r_pco);
+    gVmGlobal.pimgpool = C_NULL;
+    gVmGlobal.pimgstr = C_NULL;
+    return retval;
+}
+"""
+
+
 #### FUNCS
 
 #
 # Receives an image over the platform's standard connection.
-# Returns the image in a string object
+# Returns the image in a string object, None if a frame was damaged
+# or 0 if there is no room for the image.  A part is loaded
+# and put in the list of parts, and 1 is returned.
 #
-def _getImg():
+def _getImg(parts):
     """__NATIVE__
     PmReturn_t retval;
-    uint8_t imgType;
-    uint16_t imgSize;
-    uint8_t *pchunk;
-    pPmString_t pimg;
-    uint16_t i;
-    uint8_t b;
-
-    /* Get the image type */
-    retval = plat_getByte(&imgType);
-    PM_RETURN_IF_ERROR(retval);
+    pPmString_t pimg = C_NULL;
+    pPmObj_t pco;
+    uint8_t hdr[3];
+    uint8_t buf[16];
+    uint8_t *pdest;
+    uint16_t flen;
+    uint16_t len;
+    uint16_t crc;
+    uint16_t size = 0;
+    uint16_t i = 0;
+    uint16_t n;
+    uint8_t kind = 0;
+    uint8_t first = C_TRUE;
+    uint8_t ok = C_TRUE;
+    uint8_t noRoom = C_FALSE;
 
-    /* Quit if a code image type was not received */
-    if (imgType != OBJ_TYPE_CIM)
+    do
     {
-        PM_RAISE(retval, PM_RET_EX_STOP);
-        return retval;
-    }
+        /* Get the frame's type */
+        retval = ipm_get(hdr, 1);
+        PM_RETURN_IF_ERROR(retval);
 
-    /* Get the image size (little endien) */
-    retval = plat_getByte(&b);
-    PM_RETURN_IF_ERROR(retval);
-    imgSize = b;
-    retval = plat_getByte(&b);
-    PM_RETURN_IF_ERROR(retval);
-    imgSize |= (b << 8);
+        /* Quit if the host ends the session instead of sending an image */
+        if (first)
+        {
+            kind = hdr[0];
+            if ((kind != IPM_FRAME_IMG) && (kind != IPM_FRAME_PART))
+            {
+                PM_RAISE(retval, PM_RET_EX_STOP);
+                return retval;
+            }
+        }
+        if (hdr[0] != kind)
+        {
+            ok = C_FALSE;
+        }
+        first = C_FALSE;
 
-    /* Get space for String obj */
-    retval = heap_getChunk(sizeof(PmString_t) + imgSize, &pchunk);
-    PM_RETURN_IF_ERROR(retval);
-    pimg = (pPmString_t)pchunk;
+        /* Get the payload length */
+        retval = ipm_get(&hdr[1], 2);
+        PM_RETURN_IF_ERROR(retval);
+        flen = hdr[1] | (hdr[2] << 8);
+        len = flen;
+        crc = ipm_crc(0xFFFF, &hdr[1], 2);
 
-    /* Set the string object's fields */
-    OBJ_SET_TYPE(pimg, OBJ_TYPE_STR);
-    pimg->length = imgSize;
+        /* The image starts with its type and size; make its string */
+        if ((pimg == C_NULL) && !noRoom && (len >= 3))
+        {
+            retval = ipm_get(hdr, 3);
+            PM_RETURN_IF_ERROR(retval);
+            crc = ipm_crc(crc, hdr, 3);
+            len -= 3;
 
-    /* Start the image with the bytes that have already been received */
-    i = 0;
-    pimg->val[i++] = imgType;
-    pimg->val[i++] = imgSize & 0xFF;
-    pimg->val[i++] = (imgSize >> 8) & 0xFF;
+            size = hdr[1] | (hdr[2] << 8);
+            if ((hdr[0] != OBJ_TYPE_CIM) || (size < 3))
+            {
+                ok = C_FALSE;
+            }
+            else if (string_alloc(size, &pimg) != PM_RET_OK)
+            {
+                /* Drop the rest of the image */
+                pimg = C_NULL;
+                noRoom = C_TRUE;
+            }
+            else
+            {
+                sli_memcpy(pimg->val, hdr, 3);
+                i = 3;
+            }
+        }
 
-    /* Get the remaining bytes in the image */
-    for(; i < imgSize; i++)
-    {
-        retval = plat_getByte(&b);
+        /* Get the payload straight into the image; drop what doesn't fit */
+        while (len > 0)
+        {
+            if ((pimg != C_NULL) && (i < size))
+            {
+                pdest = &pimg->val[i];
+                n = (len < size - i) ? len : size - i;
+            }
+            else
+            {
+                pdest = buf;
+                n = (len < sizeof(buf)) ? len : sizeof(buf);
+                if (!noRoom)
+                {
+                    ok = C_FALSE;
+                }
+            }
+            retval = plat_getBytes(pdest, n, &n);
+            PM_RETURN_IF_ERROR(retval);
+            crc = ipm_crc(crc, pdest, n);
+            if (pdest != buf)
+            {
+                i += n;
+            }
+            len -= n;
+        }
+
+        /* Check the frame's CRC */
+        retval = ipm_get(hdr, 2);
         PM_RETURN_IF_ERROR(retval);
+        if ((uint16_t)(hdr[0] | (hdr[1] << 8)) != crc)
+        {
+            ok = C_FALSE;
+        }
+    }
+    while (flen != 0);
 
-        pimg->val[i] = b;
+    if (noRoom)
+    {
+        NATIVE_SET_TOS(PM_ZERO);
+    }
+    else if (!ok || (pimg == C_NULL) || (i != size))
+    {
+        NATIVE_SET_TOS(PM_NONE);
+    }
+    else if (kind == IPM_FRAME_PART)
+    {
+        /* Keep the part's code obj for the image that refers to it */
+        retval = ipm_load((pPmObj_t)pimg, NATIVE_GET_LOCAL(0), &pco);
+        PM_RETURN_IF_ERROR(retval);
+        retval = list_append(NATIVE_GET_LOCAL(0), pco);
+        PM_RETURN_IF_ERROR(retval);
+        NATIVE_SET_TOS(PM_ONE);
+    }
+    else
+    {
+        NATIVE_SET_TOS((pPmObj_t)pimg);
     }
+    return PM_RET_OK;
+    """
+    pass
+
 
-    /* Return the image as a string object on the stack */
-    NATIVE_SET_TOS((pPmObj_t)pimg);
+#
+# Makes a code object from the image string; its refs are to the parts.
+#
+def _co(img, parts):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pco;
+
+    retval = ipm_load(NATIVE_GET_LOCAL(0), NATIVE_GET_LOCAL(1), &pco);
+    PM_RETURN_IF_ERROR(retval);
+    NATIVE_SET_TOS(pco);
     return retval;
     """
     pass
@@ -97,10 +282,22 @@ def _getImg():
 #
 import sys
 def ipm():
+    parts = []
     while 1:
         # Wait for a code image, make a code object from it
         # and evaluate the code object.
-        rv = eval(Co(_getImg()))
+        img = _getImg(parts)
+        if img == None:
+            # Ask the host to send the damaged image again
+            sys.putb(0x15)
+        elif img == 0:
+            print "MemoryError"
+        elif img != 1:
+            rv = eval(_co(img, parts))
+
+        # The parts were for this image; else the host starts it over
+        if img != 1:
+            parts = []
 
         # Send a byte to indicate completion of evaluation
         sys.putb(0x04)
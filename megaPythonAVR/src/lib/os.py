@@ -0,0 +1,298 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2007 David Greenberg
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# Provides PyMite's os module for the desktop: reads and writes of file
+# descriptors (stdin, pipes, sockets) that let the other threads run
+# while the descriptor is not ready, and the loading of image files
+#
+# USAGE
+# -----
+#
+# import os
+# s = os.read(fd, n)
+# n = os.write(fd, s)
+#
+# w = os.watch("app")
+# while 1:
+#     os.read(w, 255)
+#     os.loadImg("app/app.bin")
+#
+# LOG
+# ---
+#
+# 2008/03/15    #139: Add loadImg() and watch()
+# 2008/03/03    #133: Created.
+#
+"""__NATIVE__
+#include <unistd.h>
+#include <sys/inotify.h>
+
+/* Most bytes read at a time */
+#define OS_READ_MAX 255
+
+/* Most bytes written at a time; a writable pipe takes this many at once */
+#define OS_WRITE_MAX 512
+
+/* Longest path taken, with its null */
+#define OS_PATH_MAX 256
+
+/* Copies the path in the string obj to path, with a null after it */
+static PmReturn_t
+os_getPath(pPmObj_t ps, uint8_t *path)
+{
+    PmReturn_t retval = PM_RET_OK;
+    uint16_t len;
+
+    /* If it's not a string, raise TypeError; if it's too long, ValueError */
+    if (OBJ_GET_TYPE(ps) != OBJ_TYPE_STR)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+    len = ((pPmString_t)ps)->length;
+    if (len >= OS_PATH_MAX)
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    sli_memcpy(path, (uint8_t *)STRING_GET_CHARS(ps), len);
+    path[len] = 0;
+    return retval;
+}
+"""
+
+
+#### FUNCS
+
+#
+# Reads up to n bytes that the descriptor has now, or returns None if
+# the thread has to wait for them first (then it waits before it runs
+# again).  Returns "" at end of file.
+#
+def _read(fd, n):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pfd;
+    pPmObj_t pn;
+    pPmString_t pstr;
+    uint8_t buf[OS_READ_MAX];
+    int32_t len;
+    ssize_t got;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 2)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If either arg is not an int, raise TypeError */
+    pfd = NATIVE_GET_LOCAL(0);
+    pn = NATIVE_GET_LOCAL(1);
+    if ((OBJ_GET_TYPE(pfd) != OBJ_TYPE_INT)
+        || (OBJ_GET_TYPE(pn) != OBJ_TYPE_INT))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If the count is not positive, raise ValueError */
+    len = ((pPmInt_t)pn)->val;
+    if (len <= 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+    if (len > OS_READ_MAX)
+    {
+        len = OS_READ_MAX;
+    }
+
+    retval = plat_waitFd((int)((pPmInt_t)pfd)->val, 0);
+    if (retval == PM_RET_NO)
+    {
+        NATIVE_SET_TOS(PM_NONE);
+        return PM_RET_OK;
+    }
+    PM_RETURN_IF_ERROR(retval);
+
+    got = read((int)((pPmInt_t)pfd)->val, buf, (size_t)len);
+    if (got < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    retval = string_alloc((uint16_t)got, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+    sli_memcpy((uint8_t *)STRING_GET_CHARS(pstr), buf, (uint16_t)got);
+    NATIVE_SET_TOS((pPmObj_t)pstr);
+    return retval;
+    """
+    pass
+
+
+#
+# Writes as many of the chars of s as the descriptor takes now and
+# returns how many, or returns None if the thread has to wait first
+#
+def _write(fd, s):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pfd;
+    pPmObj_t ps;
+    pPmObj_t pn;
+    uint16_t len;
+    ssize_t put;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 2)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If the args are not an int and a string, raise TypeError */
+    pfd = NATIVE_GET_LOCAL(0);
+    ps = NATIVE_GET_LOCAL(1);
+    if ((OBJ_GET_TYPE(pfd) != OBJ_TYPE_INT)
+        || (OBJ_GET_TYPE(ps) != OBJ_TYPE_STR))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = plat_waitFd((int)((pPmInt_t)pfd)->val, 1);
+    if (retval == PM_RET_NO)
+    {
+        NATIVE_SET_TOS(PM_NONE);
+        return PM_RET_OK;
+    }
+    PM_RETURN_IF_ERROR(retval);
+
+    len = ((pPmString_t)ps)->length;
+    if (len > OS_WRITE_MAX)
+    {
+        len = OS_WRITE_MAX;
+    }
+    put = write((int)((pPmInt_t)pfd)->val, STRING_GET_CHARS(ps), len);
+    if (put < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    retval = int_new((int32_t)put, &pn);
+    NATIVE_SET_TOS(pn);
+    return retval;
+    """
+    pass
+
+
+#
+# Maps the file of images made by "pmImgCreator.py -b -u" and indexes
+# them.  They replace the images of the same names: imports that come
+# after get new modules from them, while the modules imported before keep
+# running the old code.  See pm_loadImgFile().
+#
+def loadImg(fn):
+    """__NATIVE__
+    PmReturn_t retval;
+    uint8_t path[OS_PATH_MAX];
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = os_getPath(NATIVE_GET_LOCAL(0), path);
+    PM_RETURN_IF_ERROR(retval);
+
+    retval = pm_loadImgFile(path);
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
+
+
+#
+# Returns a descriptor that can be read once a file in the directory
+# was written or moved into it; what is read tells which file (see
+# inotify(7)), so read up to 255 bytes at a time.
+#
+def watch(dir):
+    """__NATIVE__
+    PmReturn_t retval;
+    uint8_t path[OS_PATH_MAX];
+    pPmObj_t pfd;
+    int fd;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = os_getPath(NATIVE_GET_LOCAL(0), path);
+    PM_RETURN_IF_ERROR(retval);
+
+    fd = inotify_init();
+    if (fd < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    if (inotify_add_watch(fd, (char *)path, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(fd);
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    retval = int_new(fd, &pfd);
+    NATIVE_SET_TOS(pfd);
+    return retval;
+    """
+    pass
+
+
+#
+# Reads up to n bytes from the descriptor, waiting while it has none.
+# Returns "" at end of file.
+#
+def read(fd, n):
+    s = _read(fd, n)
+    while s == None:
+        s = _read(fd, n)
+    return s
+
+
+#
+# Writes all the chars of s to the descriptor, waiting while it is full
+#
+def write(fd, s):
+    i = 0
+    while i < len(s):
+        n = _write(fd, s[i:])
+        if n != None:
+            i = i + n
+    return i
@@ -0,0 +1,77 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# Provides PyMite's string module, string
+#
+# USAGE
+# -----
+#
+# import string
+#
+# LOG
+# ---
+#
+# 2008/02/10    #123: Created with join()
+#
+
+#### FUNCS
+
+#
+# Returns the strings in the list or tuple s joined by the separator sep
+# (a space if sep is not given).
+# To assemble a string from many pieces, collect the pieces in a list and
+# join the list once; this builds the result with a single allocation.
+#
+def join(s, sep):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t psep;
+    pPmObj_t pr;
+    uint8_t const *pspace = (uint8_t const *)" ";
+    uint8_t objid;
+
+    /* If wrong number of args, raise TypeError */
+    if ((NATIVE_GET_NUM_ARGS() < 1) || (NATIVE_GET_NUM_ARGS() > 2))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* Get the separator, a space by default */
+    if (NATIVE_GET_NUM_ARGS() == 2)
+    {
+        psep = NATIVE_GET_LOCAL(1);
+    }
+    else
+    {
+        retval = string_new(&pspace, &psep);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Keep the separator if the GC runs (when it's the new space string) */
+    retval = heap_gcPushTempRoot(psep, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    retval = string_join(psep, NATIVE_GET_LOCAL(0), &pr);
+    heap_gcPopTempRoot(objid);
+    PM_RETURN_IF_ERROR(retval);
+
+    NATIVE_SET_TOS(pr);
+    return retval;
+    """
+    pass
@@ -37,6 +37,9 @@ Log
 Date            Action
 ==========      ================================================================
 2006/12/21      Initial creation
+2008/03/11      #137: Send images in frames with a CRC each, read replies
+                in blocks, load modules
+2008/03/25      #144: Send a large image in parts
 """
 
 
@@ -61,6 +64,51 @@ HELP_MESSAGE = "This is the interactive PyMite command line.\n" \
                "Type another return if you see no prompt to exit multiline mode.\n" \
                "Type Ctrl+C to interrupt and Ctrl+D to quit.\n"
 REPLY_TERMINATOR = '\x04'
+REPLY_RESEND = '\x15'
+
+# An image is sent in frames: type, payload length (2 bytes), payload and
+# the CRC-16 (CCITT) of length and payload (2 bytes); all little endian.
+# A frame with no payload ends the image.  An image too large for a string
+# on the target goes after its parts, which are sent in frames of their own.
+FRAME_IMG = 'I'
+FRAME_PART = 'P'
+FRAME_MAX_PAYLOAD = 1024
+
+# A larger image is sent in parts; the target's heap seldom has a much
+# larger chunk free for the string that holds an image
+IMG_MAX_SIZE = 512
+SEND_TRIES = 3
+
+
+def crc16(s, crc=0xFFFF):
+    """Returns the CRC-16 (CCITT) of the string.
+    """
+    for c in s:
+        crc ^= ord(c) << 8
+        for i in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+    return crc
+
+
+def frame(payload, kind=FRAME_IMG):
+    """Returns the frame of an image that holds the payload.
+    """
+    n = len(payload)
+    body = chr(n & 0xFF) + chr(n >> 8) + payload
+    crc = crc16(body)
+    return kind + body + chr(crc & 0xFF) + chr(crc >> 8)
+
+
+def to_frames(img, kind=FRAME_IMG):
+    """Returns the frames of the image, ready to send at once.
+    """
+    frames = [frame(img[i:i + FRAME_MAX_PAYLOAD], kind)
+              for i in range(0, len(img), FRAME_MAX_PAYLOAD)]
+    frames.append(frame("", kind))
+    return "".join(frames)
 
 
 class Connection(object):
@@ -93,17 +141,17 @@ class PipeConnection(Connection):
         # It will usually be an exception message from the target
         # TODO
 
-        # Collect all characters up to and including the ipm reply terminator
-        chars = []
-        c = 'z'
-        while c != REPLY_TERMINATOR:
-            c = self.child.stdout.read(1)
-            if c == '':
+        # Collect all characters up to and including the ipm reply terminator,
+        # as many at a time as the pipe has
+        chunks = []
+        while not chunks or not chunks[-1].endswith(REPLY_TERMINATOR):
+            chunk = os.read(self.child.stdout.fileno(), 4096)
+            if chunk == '':
                 # DEBUG: uncomment the next line to print the child's return val
                 #print "DEBUG: child returncode = %s\n" % hex(self.child.poll())
                 break
-            chars.append(c)
-        msg = "".join(chars)
+            chunks.append(chunk)
+        msg = "".join(chunks)
         return msg
 
 
@@ -143,8 +191,13 @@ class Interactive(cmd.Cmd):
                               'module must be a ".py" source file.\n')
             return
 
-        print "TODO: Loading module %s" % (args[0])
-        # TODO: load module, compile to image, send to target
+        # Run the module's code on the target
+        try:
+            codeobj = compile(open(fn).read(), fn, "exec")
+        except Exception, e:
+            self.stdout.write("%s:%s\n" % (e.__class__.__name__, e))
+            return
+        self.send(codeobj)
 
 
     def do_input(self, line):
@@ -158,10 +211,18 @@ class Interactive(cmd.Cmd):
         # DEBUG: Uncomment the next line to print the statement's bytecodes
         #dis.disco(codeobj)
 
+        self.send(codeobj)
+
+
+    def send(self, codeobj):
+        """Creates a code image from the code object, sends it to the target
+        and prints the return stream.
+        """
+
         # Convert to a code image
         pic = pmImgCreator.PmImgCreator()
         try:
-            codeimg = pic.co_to_str(codeobj)
+            parts, codeimg = pic.co_to_parts(codeobj, IMG_MAX_SIZE)
 
         # Print any conversion errors
         except Exception, e:
@@ -175,12 +236,25 @@ class Interactive(cmd.Cmd):
             # DEBUG: Uncomment the next line to print the code image
             # print "DEBUG: codeimg = ", repr(codeimg)
 
-            try:
-                self.conn.write(codeimg)
-            except Exception, e:
-                self.stdout.write("Connection write error, type Ctrl+D to quit.\n")
+            # The frames of an image are sent without waiting; the target
+            # asks for the image again if a frame was damaged.  Each part
+            # must be taken before the next is sent; the target drops the
+            # parts it has if one fails, so the image starts over.
+            imgs = [to_frames(part, FRAME_PART) for part in parts]
+            imgs.append(to_frames(codeimg))
+            for i in range(SEND_TRIES):
+                for frames in imgs:
+                    try:
+                        self.conn.write(frames)
+                    except Exception, e:
+                        self.stdout.write("Connection write error, type Ctrl+D to quit.\n")
+
+                    rv = self.conn.read()
+                    if rv != REPLY_TERMINATOR:
+                        break
+                if rv != REPLY_RESEND + REPLY_TERMINATOR:
+                    break
 
-            rv = self.conn.read()
             if rv == '':
                 self.stdout.write("Connection read error, type Ctrl+D to quit.\n")
             else:
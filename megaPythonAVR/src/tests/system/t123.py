@@ -0,0 +1,66 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 123
+#
+# Regression test for issue #123:
+# Add string concatenation and string.join()
+#
+
+import string
+
+# Concatenation
+s = "abc" + "def"
+assert s == "abcdef"
+assert len(s) == 6
+s += "g"
+assert s == "abcdefg"
+assert "" + "" == ""
+assert "x" + "" == "x"
+
+# Join a list built up piece by piece
+parts = []
+i = 0
+while i < 50:
+    parts[i:] = ["ab"]
+    i = i + 1
+s = string.join(parts, "")
+assert len(s) == 100
+
+# Join a tuple, with and without a separator
+assert string.join(("a", "b", "c"), ", ") == "a, b, c"
+assert string.join(("a", "b")) == "a b"
+assert string.join([], "-") == ""
+assert string.join(["solo"], "-") == "solo"
+
+# Joined strings work as dict keys alongside literal ones
+d = {}
+d[string.join(["k", "ey"], "")] = 1
+assert d["key"] == 1
+
+# Lots of short-lived strings, enough to run the GC
+i = 0
+while i < 300:
+    s = string.join(["$GP", "RMC", ",", "123519", "*", "47"], "")
+    t = string.join(["a", "b"]) + s
+    i = i + 1
+assert s == "$GPRMC,123519*47"
+assert t == "a b$GPRMC,123519*47"
+
+print "Test 123 passed"
@@ -0,0 +1,103 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 127
+#
+# Regression test for issue #127:
+# Add locks, semaphores and conditions
+#
+
+
+import string
+import thread
+
+log = []
+
+def note(s):
+    log[len(log):] = [s]
+
+l = thread.newLock()
+s = thread.newSemaphore(0)
+c = thread.newCondition(l)
+
+def locker():
+    thread.acquire(l)
+    note("l")
+    thread.release(l)
+
+def other():
+    note("o")
+
+def poster():
+    note("p")
+    thread.release(s)
+
+def waiter():
+    thread.acquire(l)
+    note("w")
+    thread.waitCond(c)
+    note("n")
+    thread.release(l)
+
+# Uncontended
+assert thread.acquire(l)
+assert not thread.acquire(l, 0)
+thread.release(l)
+
+# Only the thread waiting for the lock stops
+assert thread.acquire(l)
+thread.spawn(locker)
+thread.spawn(other)
+thread.sleep(10)
+assert string.join(log, "") == "o"
+
+# Releasing hands the lock to the waiter
+thread.release(l)
+thread.sleep(10)
+assert string.join(log, "") == "ol"
+
+# A semaphore blocks until it is released
+thread.spawn(poster)
+assert thread.acquire(s)
+assert string.join(log, "") == "olp"
+
+# A timed acquire gives up
+t = thread.acquire(s, 20)
+assert not t
+
+# A condition waiter releases the lock while it waits
+thread.spawn(waiter)
+thread.sleep(10)
+assert string.join(log, "") == "olpw"
+assert thread.acquire(l, 0)
+thread.notify(c)
+thread.sleep(10)
+assert string.join(log, "") == "olpw"
+
+# The notified waiter runs once it holds the lock again
+thread.release(l)
+thread.sleep(10)
+assert string.join(log, "") == "olpwn"
+
+# A timed condition wait gives up, with the lock held again
+thread.acquire(l)
+assert not thread.waitCond(c, 20)
+thread.release(l)
+
+print "Test 127 passed"
@@ -0,0 +1,95 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 128
+#
+# Regression test for issue #128:
+# Dispatch events posted by interrupts
+#
+
+
+import sys
+import thread
+
+got = []
+
+#
+# Posts n events of the given ID, with data 0 to n-1, as an ISR would
+#
+def post(id, n):
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+    int32_t i;
+
+    for (i = 0; i < ((pPmInt_t)NATIVE_GET_LOCAL(1))->val; i++)
+    {
+        retval = event_post((uint8_t)((pPmInt_t)NATIVE_GET_LOCAL(0))->val, i);
+        PM_RETURN_IF_ERROR(retval);
+    }
+    return retval;
+    """
+    pass
+
+def cb(d):
+    got[len(got):] = [d]
+
+def tick():
+    got[len(got):] = [-1]
+
+sys.registerCallback(3, cb)
+sys.registerCallback(5, tick)
+
+# A callback runs, with the event's data, at the next reschedule
+post(3, 1)
+thread.sleep(5)
+assert len(got) == 1
+assert got[0] == 0
+
+# Events of an ID with no callback are dropped
+post(4, 1)
+thread.sleep(5)
+assert len(got) == 1
+
+# A burst beyond the ring loses the data of the events, not the events.
+# Every event of the burst starts a callback thread at once, so it is kept
+# one past the ring to leave the heap room for them
+got = []
+post(5, 1)
+post(3, 17)
+thread.sleep(20)
+assert len(got) == 18
+
+# The callback threads are timesliced, so they may end in any order;
+# 16 of the 17 events fit in the ring with their data, 1 lost it and
+# its callback got None
+lost = 0
+zeros = 0
+total = 0
+for d in got:
+    if d == None:
+        lost = lost + 1
+    else:
+        total = total + d
+        if d == 0:
+            zeros = zeros + 1
+assert lost == 1
+assert zeros == 1
+assert total == 119
+
+print "Test 128 passed"
@@ -0,0 +1,49 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 129
+#
+# Regression test for issue #129:
+# Run several VMs in one process.
+# t129.c runs this module in two VMs at once, on two native threads.
+#
+
+import string
+import thread
+
+log = []
+
+def note(s):
+    log[len(log):] = [s]
+
+def worker():
+    thread.sleep(5)
+    note("w")
+
+# Make garbage so both heaps are collected while the other VM runs
+thread.spawn(worker)
+i = 0
+while i < 300:
+    s = string.join(["a", "b", "c"], "-") + "!"
+    i = i + 1
+assert s == "a-b-c!"
+
+# Each VM has its own threads and timer wheel
+thread.sleep(20)
+assert string.join(log, "") == "w"
@@ -0,0 +1,78 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 130
+#
+# Regression test for issue #130:
+# Add channels between threads
+#
+
+
+import thread
+
+# The ring keeps the order of the objs sent
+a = thread.newChannel(2)
+thread.send(a, 1)
+thread.send(a, 2)
+assert thread.recv(a) == 1
+thread.send(a, 3)
+assert thread.recv(a) == 2
+assert thread.recv(a) == 3
+
+# The obj received is the obj sent, not a copy
+l = [1]
+thread.send(a, l)
+m = thread.recv(a)
+m[0] = 5
+assert l[0] == 5
+
+# A pipeline: the sensor waits while the ring is full,
+# the filter waits on both sides and the output waits for the filter
+b = thread.newChannel(0)
+
+def sensor():
+    i = 0
+    while i < 20:
+        thread.send(a, i)
+        i += 1
+    thread.send(a, -1)
+
+def filter():
+    x = thread.recv(a)
+    while x >= 0:
+        if x % 2 == 0:
+            thread.send(b, x * 10)
+        x = thread.recv(a)
+    thread.send(b, -1)
+
+thread.spawn(sensor)
+thread.spawn(filter)
+
+n = 0
+total = 0
+x = thread.recv(b)
+while x >= 0:
+    assert x == n * 20
+    n += 1
+    total += x
+    x = thread.recv(b)
+assert n == 10
+assert total == 900
+
+print "Test 130 passed"
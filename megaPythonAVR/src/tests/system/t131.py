@@ -0,0 +1,100 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 131
+#
+# Regression test for issue #131:
+# Add generators
+#
+
+
+import string
+
+
+def count(n):
+    i = 0
+    while i < n:
+        yield i
+        i += 1
+
+# A generator is iterated lazily by a for loop
+r = []
+for x in count(4):
+    r[len(r):] = [x]
+assert len(r) == 4
+assert r[0] == 0
+assert r[3] == 3
+
+# Generators can be chained into a pipeline
+def evens(g):
+    for x in g:
+        if x % 2 == 0:
+            yield x
+
+def scale(g, k):
+    for x in g:
+        yield x * k
+
+total = 0
+for x in scale(evens(count(10)), 3):
+    total += x
+assert total == 60
+
+# A loop can stop early; the rest of the generator never runs
+def noisy():
+    yield 1
+    yield 2
+    assert 0
+
+for x in noisy():
+    if x == 2:
+        break
+
+# A generator that was run to its end stays done
+g = count(2)
+n = 0
+for x in g:
+    n += 1
+for x in g:
+    n += 1
+assert n == 2
+
+# Generators as tasks, each stepped in turn until it returns
+log = []
+
+def task(c, n):
+    i = 0
+    while i < n:
+        log[len(log):] = [c]
+        yield i
+        i += 1
+
+tasks = [task("a", 2), task("b", 3)]
+while len(tasks) > 0:
+    i = 0
+    while i < len(tasks):
+        for x in tasks[i]:
+            i += 1
+            break
+        else:
+            del tasks[i]
+
+assert string.join(log, "") == "ababb"
+
+print "Test 131 passed"
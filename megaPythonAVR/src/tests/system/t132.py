@@ -0,0 +1,58 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 132
+#
+# Regression test for issue #132:
+# Preempt threads when their timeslice is over
+#
+
+
+import thread
+
+flags = [0, 0, 0]
+
+def setter():
+    flags[0] = 1
+
+# A thread runs on until its slice is over, however many bytecodes it runs
+thread.setSlice(255)
+thread.spawn(setter)
+i = 0
+while i < 200:
+    i += 1
+assert flags[0] == 0
+
+# wait() ends the slice at once
+thread.wait()
+assert flags[0] == 1
+
+# Busy threads of the same priority take turns by time
+def spinner():
+    thread.setSlice(1)
+    while flags[2] == 0:
+        flags[1] += 1
+
+thread.setSlice(5)
+thread.spawn(spinner)
+while flags[1] == 0:
+    i += 1
+flags[2] = 1
+
+print "Test 132 passed"
@@ -0,0 +1,162 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 133
+#
+# Regression test for issue #133:
+# Let threads wait on descriptors on the desktop
+#
+"""__NATIVE__
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* Returns a tuple of the two fds in fds */
+static PmReturn_t
+t133_fdPair(int *fds)
+{
+    PmReturn_t retval;
+    pPmObj_t ptup;
+    pPmObj_t pfd;
+    uint8_t objid;
+
+    retval = tuple_new(2, &ptup);
+    PM_RETURN_IF_ERROR(retval);
+    retval = heap_gcPushTempRoot(ptup, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    retval = int_new(fds[0], &pfd);
+    ((pPmTuple_t)ptup)->val[0] = pfd;
+    if (retval == PM_RET_OK)
+    {
+        retval = int_new(fds[1], &pfd);
+        ((pPmTuple_t)ptup)->val[1] = pfd;
+    }
+    heap_gcPopTempRoot(objid);
+    NATIVE_SET_TOS(ptup);
+    return retval;
+}
+"""
+
+import os, sys, thread
+
+
+def pipe():
+    """__NATIVE__
+    int fds[2];
+    PmReturn_t retval;
+
+    if (pipe(fds) != 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    return t133_fdPair(fds);
+    """
+    pass
+
+
+def socketpair():
+    """__NATIVE__
+    int fds[2];
+    PmReturn_t retval;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    return t133_fdPair(fds);
+    """
+    pass
+
+
+def dup2(a, b):
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+
+    if (dup2(((pPmInt_t)NATIVE_GET_LOCAL(0))->val,
+             ((pPmInt_t)NATIVE_GET_LOCAL(1))->val) < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+    }
+    return retval;
+    """
+    pass
+
+
+# A reader of an empty pipe waits, while the other threads run
+p = pipe()
+got = []
+
+def reader():
+    c = os.read(p[0], 1)
+    got[len(got):] = [c]
+
+thread.spawn(reader)
+thread.sleep(20)
+assert len(got) == 0
+os.write(p[1], "h")
+while len(got) == 0:
+    thread.sleep(1)
+assert got[0] == "h"
+
+# Any number of threads can wait on the same descriptor
+thread.spawn(reader)
+thread.spawn(reader)
+thread.sleep(5)
+os.write(p[1], "ab")
+while len(got) < 3:
+    thread.sleep(1)
+assert got[1] + got[2] == "ab"
+
+# A socket pair, both ways: the main thread waits for the echo
+s = socketpair()
+
+def echo():
+    os.write(s[0], os.read(s[0], 10) + "!")
+
+thread.spawn(echo)
+os.write(s[1], "ping")
+assert os.read(s[1], 10) == "ping!"
+
+# A thread busy with no I/O keeps running while another waits
+n = [0]
+
+def counter():
+    while n[0] < 1000:
+        n[0] = n[0] + 1
+    os.write(p[1], "x")
+
+thread.spawn(counter)
+assert os.read(p[0], 1) == "x"
+assert n[0] == 1000
+
+# sys.getb() waits on stdin without stopping the other threads
+dup2(p[0], 0)
+
+def getter():
+    got[0] = sys.getb()
+
+thread.spawn(getter)
+thread.sleep(20)
+assert got[0] == "h"
+os.write(p[1], "A")
+while got[0] == "h":
+    thread.sleep(1)
+assert got[0] == 65
+
+print "Test 133 passed"
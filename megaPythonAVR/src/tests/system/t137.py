@@ -0,0 +1,36 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 137
+#
+# Regression test for issue #138:
+# Add pm_loadImgFile() to map image files at runtime
+#
+
+# t137b comes from the image file the test program mapped
+import t137b
+
+
+assert t137b.x == 42
+assert t137b.s == "from a file"
+assert t137b.double(21) == 42
+c = t137b.Counter()
+c.add(3)
+assert c.add(4) == 7
+
+print "Test 137 passed"
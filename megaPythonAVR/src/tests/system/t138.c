@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * System Test 138
+ *
+ * Regression test for issue #139:
+ * Reload modules from image files
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/15   #139: First
+ */
+
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char usrlib_img[];
+
+
+int main(void)
+{
+    PmReturn_t retval;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* A file loaded again replaces its images; the GC unmaps the old one */
+    retval = pm_loadImgFile((uint8_t *)"t138b.bin");
+    PM_RETURN_IF_ERROR(retval);
+    retval = pm_loadImgFile((uint8_t *)"t138b.bin");
+    PM_RETURN_IF_ERROR(retval);
+    retval = heap_gcRun();
+    PM_RETURN_IF_ERROR(retval);
+    if ((gVmGlobal.pimgfiles == C_NULL)
+        || (gVmGlobal.pimgfiles->next != C_NULL))
+    {
+        return 1;
+    }
+
+    retval = pm_run((uint8_t *)"t138");
+    return (int)retval;
+}
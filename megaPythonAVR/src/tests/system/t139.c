@@ -0,0 +1,96 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ * System Test 139
+ *
+ * Regression test for issue #140:
+ * Heap snapshot and restore
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/17   #140: First
+ */
+
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char stdlib_img[];
+extern unsigned char usrlib_img[];
+
+/** The VM the snapshot is restored into, at another address */
+static PmVm_t vm;
+
+
+int main(void)
+{
+    PmReturn_t retval;
+    uint8_t const *paddr;
+    uint32_t i;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+    retval = pm_run((uint8_t *)"t139a");
+    PM_RETURN_IF_ERROR(retval);
+    retval = pm_snapshot((uint8_t *)"t139.snap", usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* A file that is not a snapshot is not restored */
+    pm_bindVm(&vm);
+    if (pm_restore((uint8_t *)"t139.c", usrlib_img) != PM_RET_EX_VAL)
+    {
+        return 1;
+    }
+
+    /*
+     * Nor is one of other images, and the VM is left as it was; only the
+     * place of the error is set
+     */
+    if ((pm_restore((uint8_t *)"t139.snap", C_NULL) != PM_RET_EX_VAL)
+        || (pm_restore((uint8_t *)"t139.snap", stdlib_img) != PM_RET_EX_VAL))
+    {
+        return 3;
+    }
+    if (gVmGlobal.pimglist != C_NULL)
+    {
+        return 4;
+    }
+    for (i = 0; i < sizeof(PmHeap_t); i++)
+    {
+        if (((uint8_t *)&vm.vm_heap)[i] != 0)
+        {
+            return 4;
+        }
+    }
+
+    retval = pm_restore((uint8_t *)"t139.snap", usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+    retval = pm_run((uint8_t *)"t139b");
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Images in a RAM buffer of the program are not in a snapshot */
+    paddr = usrlib_img;
+    retval = img_findInMem(MEMSPACE_RAM, &paddr);
+    PM_RETURN_IF_ERROR(retval);
+    if (pm_snapshot((uint8_t *)"t139.snap", usrlib_img) != PM_RET_EX_SYS)
+    {
+        return 2;
+    }
+    return 0;
+}
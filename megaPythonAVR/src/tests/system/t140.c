@@ -0,0 +1,101 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ * System Test 140
+ *
+ * Regression test for issue #141:
+ * Fast VM reset for running many scripts in one process
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/19   #141: First
+ */
+
+#include <unistd.h>
+#include "pm.h"
+#include "stdio.h"
+
+
+#define NUM_RUNS 5
+
+
+extern unsigned char usrlib_img[];
+
+/** The state each run starts from */
+static PmVm_t baseline;
+
+
+int main(void)
+{
+    PmReturn_t retval;
+    uint16_t avail;
+    uint16_t n;
+    int fd;
+    int i;
+
+    /* There is nothing to reset to before a baseline is set */
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+    if (pm_reset() != PM_RET_EX_SYS)
+    {
+        return 1;
+    }
+
+    retval = pm_setBaseline(&baseline);
+    PM_RETURN_IF_ERROR(retval);
+    heap_getAvail(&avail);
+
+    /* The lowest free descriptor, to see that a reset closes the run's */
+    fd = dup(0);
+    close(fd);
+
+    /* Each run starts with the same heap and sees none of the last run */
+    for (i = 0; i < NUM_RUNS; i++)
+    {
+        retval = pm_run((uint8_t *)"t140");
+        PM_RETURN_IF_ERROR(retval);
+        retval = pm_reset();
+        PM_RETURN_IF_ERROR(retval);
+        heap_getAvail(&n);
+        if ((n != avail) || (gVmGlobal.threadList->length != 0))
+        {
+            return 2;
+        }
+
+        /* Nor any descriptor of the last run, such as its epoll set */
+        if ((gVmGlobal.ioEpoll != 0) || (dup(0) != fd))
+        {
+            return 3;
+        }
+        close(fd);
+    }
+
+    /* A restored VM has no baseline, the old one is not in the snapshot */
+    retval = pm_snapshot((uint8_t *)"t140.snap", usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+    retval = pm_restore((uint8_t *)"t140.snap", usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+    if ((gVmGlobal.pbaseline != C_NULL) || (pm_reset() != PM_RET_EX_SYS))
+    {
+        return 4;
+    }
+
+    puts("Test 140 passed");
+    return 0;
+}
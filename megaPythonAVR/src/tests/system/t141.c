@@ -0,0 +1,83 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ * System Test 141
+ *
+ * Regression test for issue #142:
+ * Page-cached reads of the memspaces from MEMSPACE_EEPROM on
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/21   #142: First
+ */
+
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char usrlib_img[];
+
+
+int main(void)
+{
+    PmReturn_t retval;
+    uint8_t const *paddr;
+    uint8_t const *pimg;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The images of t141b are read from a file, as from an external memory */
+    retval = plat_openMemspace(MEMSPACE_OTHER0, (uint8_t *)"t141b.bin",
+                               &paddr);
+    PM_RETURN_IF_ERROR(retval);
+    pimg = paddr;
+    retval = img_findInMem(MEMSPACE_OTHER0, &paddr);
+    PM_RETURN_IF_ERROR(retval);
+
+    retval = pm_run((uint8_t *)"t141");
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Most of the bytes were found in pages read before */
+    if ((gVmGlobal.memCache.mc_misses == 0)
+        || (gVmGlobal.memCache.mc_hits < 10 * gVmGlobal.memCache.mc_misses))
+    {
+        return 1;
+    }
+
+    /* A snapshot couldn't find the images again */
+    if (pm_snapshot((uint8_t *)"t141.snap", usrlib_img) != PM_RET_EX_SYS)
+    {
+        return 2;
+    }
+
+    /* The memspace opened with another file reads it, not cached pages */
+    retval = plat_writeFile((uint8_t *)"t141.tmp", 0, (uint8_t *)"Z", 1);
+    PM_RETURN_IF_ERROR(retval);
+    retval = plat_openMemspace(MEMSPACE_OTHER0, (uint8_t *)"t141.tmp",
+                               &paddr);
+    PM_RETURN_IF_ERROR(retval);
+    if ((paddr != pimg) || (mem_getByte(MEMSPACE_OTHER0, &paddr) != 'Z'))
+    {
+        return 3;
+    }
+
+    puts("Test 141 passed");
+    return 0;
+}
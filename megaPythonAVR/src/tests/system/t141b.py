@@ -0,0 +1,47 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 141
+#
+# Regression test for issue #142:
+# Page-cached reads of the memspaces from MEMSPACE_EEPROM on
+#
+# Module read from a file as memspace OTHER0
+#
+
+name = "t141b"
+
+
+def fib(n):
+    a = 0
+    b = 1
+    while n > 0:
+        t = a + b
+        a = b
+        b = t
+        n = n - 1
+    return a
+
+
+def squares(n):
+    d = {}
+    i = 0
+    while i < n:
+        d[i] = i * i
+        i = i + 1
+    return d
@@ -0,0 +1,54 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 142
+#
+# Regression test for issue #143:
+# Compressed code images
+#
+# Module compressed by pmImgCreator.py -z
+#
+
+name = "t142b"
+
+# Matches may overlap the bytes they copy
+filler = "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabc"
+
+
+def add(a, b):
+    result = a + b
+    return result
+
+
+def sub(a, b):
+    result = a - b
+    return result
+
+
+def mul(a, b):
+    result = a * b
+    return result
+
+
+class Counter:
+    def __init__(self):
+        self.count = 0
+
+    def next(self):
+        self.count = self.count + 1
+        return self.count
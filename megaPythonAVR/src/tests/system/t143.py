@@ -0,0 +1,45 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 143
+#
+# Regression test for issue #144:
+# A pool of the strs and ints shared by an image set
+#
+
+import t143b
+
+
+assert t143b.name == "t143b"
+assert t143b.getName() == t143b.name
+assert t143b.limit == 1000
+assert t143b.clip(5) == 5
+assert t143b.clip(5000) == 1000
+assert t143b.scale(2) == 1000
+assert t143b.label(0) == "t143b:item"
+
+# The pooled objs outlive collections
+i = 0
+while i < 300:
+    x = [i, i, i, i]
+    i = i + 1
+item = t143b.Item()
+assert item.getItem() == 1000
+assert t143b.getName() == "t143b"
+
+print "Test 143 passed"
@@ -0,0 +1,177 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 144
+#
+# Regression test for issue #137:
+# ipm gets an image in frames with a CRC each
+#
+"""__NATIVE__
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* In t144.c, which can have the POSIX sleeps */
+extern PmReturn_t t144_writeSlowly(int fd, uint8_t const *pbuf,
+                                   uint16_t len, uint16_t n);
+"""
+
+import ipm, os
+
+
+# Makes a pipe and puts its read end on stdin; returns the write end
+def pipeIn():
+    """__NATIVE__
+    int fds[2];
+    pPmObj_t pfd;
+    PmReturn_t retval;
+
+    if ((pipe(fds) != 0) || (dup2(fds[0], 0) < 0))
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    close(fds[0]);
+    retval = int_new(fds[1], &pfd);
+    NATIVE_SET_TOS(pfd);
+    return retval;
+    """
+    pass
+
+
+# Returns a copy of the code image of the func, as the host would send it
+def imgOf(f):
+    """__NATIVE__
+    pPmCo_t pco;
+    pPmString_t pimg;
+    uint8_t const *paddr;
+    uint16_t size;
+    uint16_t i;
+    PmReturn_t retval;
+
+    /* The image starts with its type and size */
+    pco = ((pPmFunc_t)NATIVE_GET_LOCAL(0))->f_co;
+    paddr = pco->co_codeimgaddr + 1;
+    size = mem_getWord(pco->co_memspace, &paddr);
+
+    retval = string_alloc(size, &pimg);
+    PM_RETURN_IF_ERROR(retval);
+    paddr = pco->co_codeimgaddr;
+    for (i = 0; i < size; i++)
+    {
+        pimg->val[i] = mem_getByte(pco->co_memspace, &paddr);
+    }
+    NATIVE_SET_TOS((pPmObj_t)pimg);
+    return retval;
+    """
+    pass
+
+
+# Writes the string to the fd from another process, n bytes at a time
+# with a pause after each, so the reads get it in small pieces
+def writeSlowly(fd, s, n):
+    """__NATIVE__
+    pPmString_t ps = (pPmString_t)NATIVE_GET_LOCAL(1);
+
+    NATIVE_SET_TOS(PM_NONE);
+    return t144_writeSlowly((int)((pPmInt_t)NATIVE_GET_LOCAL(0))->val,
+                            ps->val, ps->length,
+                            (uint16_t)((pPmInt_t)NATIVE_GET_LOCAL(2))->val);
+    """
+    pass
+
+
+# Waits for the process of writeSlowly() to end
+def reap():
+    """__NATIVE__
+    wait(NULL);
+    NATIVE_SET_TOS(PM_NONE);
+    return PM_RET_OK;
+    """
+    pass
+
+
+# Returns the CRC-16 (CCITT) of the string, as the host makes it
+def crc16(s):
+    crc = 0xFFFF
+    i = 0
+    while i < len(s):
+        crc = crc ^ (ord(s[i]) << 8)
+        j = 0
+        while j < 8:
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+            j = j + 1
+        i = i + 1
+    return crc
+
+
+# Returns a frame of the given type that holds the payload
+def frame(t, payload):
+    n = len(payload)
+    body = chr(n & 0xFF) + chr(n >> 8) + payload
+    crc = crc16(body)
+    return t + body + chr(crc & 0xFF) + chr(crc >> 8)
+
+
+# Returns the frames of the image, n bytes of it in each, and the end frame
+def frames(img, n):
+    s = ""
+    i = 0
+    while i < len(img):
+        s = s + frame("I", img[i:i + n])
+        i = i + n
+    return s + frame("I", "")
+
+
+def sample(a, b):
+    c = a * b + 3
+    if c > 10:
+        return [a, b, c]
+    return "small"
+
+
+w = pipeIn()
+img = imgOf(sample)
+good = frames(img, 16)
+
+# A good image comes back whole
+os.write(w, good)
+assert ipm._getImg([]) == img
+
+# A damaged frame gets None, and the image sent again comes back whole
+bad = good[:19] + chr(ord(good[19]) ^ 1) + good[20:]
+os.write(w, bad + good)
+assert ipm._getImg([]) == None
+assert ipm._getImg([]) == img
+
+# An image too big for the heap gets 0; the rest of it is dropped
+os.write(w, frame("I", img[0] + chr(0xF0) + chr(0xFF) + "abc")
+            + frame("I", "defg") + frame("I", ""))
+assert ipm._getImg([]) == 0
+
+# The frames may arrive in pieces of any size
+writeSlowly(w, good, 3)
+assert ipm._getImg([]) == img
+reap()
+
+# One byte that is not a frame type ends the session; t144.c checks
+# that the next byte was left for it to read
+os.write(w, "QX")
+ipm._getImg([])
@@ -0,0 +1,50 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 145
+#
+# Regression test for issue #110:
+# A module whose body raised is not kept in the module cache
+#
+# Is imported by t145a; its body raises the first time it runs
+#
+
+"""__NATIVE__
+/** Number of times the body of t145b ran */
+static uint8_t t145_runs = 0;
+"""
+
+
+# Counts a run of the body; returns the count
+def countRun():
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pn;
+
+    retval = int_new(++t145_runs, &pn);
+    NATIVE_SET_TOS(pn);
+    return retval;
+    """
+    pass
+
+
+if countRun() == 1:
+    # NameError
+    undefinedName
+
+done = 1
@@ -0,0 +1,121 @@
+/*
+ * PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+ * Copyright 2007 Dean Hall
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * Module Object Unit Tests
+ *
+ * Tests the Module Object implementation.
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/04   First.
+ */
+
+
+#include "CuTest.h"
+#include "pm.h"
+
+
+/**
+ * Tests mod_import():
+ *      retval is OK
+ *      obj type is MOD
+ *      importing the same name again returns the same module
+ */
+void
+ut_mod_import_000(CuTest *tc)
+{
+    pPmObj_t pname;
+    pPmObj_t pmod1;
+    pPmObj_t pmod2;
+    uint8_t const *pcstring = (uint8_t const *)"sys";
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    string_new(&pcstring, &pname);
+
+    retval = mod_import(pname, &pmod1);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, OBJ_GET_TYPE(pmod1) == OBJ_TYPE_MOD);
+
+    retval = mod_import(pname, &pmod2);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertPtrEquals(tc, pmod1, pmod2);
+}
+
+
+/**
+ * Tests mod_import():
+ *      unknown name raises ImportError
+ */
+void
+ut_mod_import_001(CuTest *tc)
+{
+    pPmObj_t pname;
+    pPmObj_t pmod;
+    uint8_t const *pcstring = (uint8_t const *)"nosuchmodule";
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    string_new(&pcstring, &pname);
+
+    retval = mod_import(pname, &pmod);
+    CuAssertTrue(tc, retval == PM_RET_EX_IMPRT);
+}
+
+
+/**
+ * Tests mod_lookup():
+ *      returns NO before the module is imported
+ *      returns OK and the imported module after
+ */
+void
+ut_mod_lookup_000(CuTest *tc)
+{
+    pPmObj_t pname;
+    pPmObj_t pmod;
+    pPmObj_t pcached;
+    uint8_t const *pcstring = (uint8_t const *)"sys";
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    string_new(&pcstring, &pname);
+
+    retval = mod_lookup(pname, &pcached);
+    CuAssertTrue(tc, retval == PM_RET_NO);
+
+    mod_import(pname, &pmod);
+    retval = mod_lookup(pname, &pcached);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertPtrEquals(tc, pmod, pcached);
+}
+
+
+/** Make a suite from all tests in this file */
+CuSuite *getSuite_testModuleObj(void)
+{
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, ut_mod_import_000);
+    SUITE_ADD_TEST(suite, ut_mod_import_001);
+    SUITE_ADD_TEST(suite, ut_mod_lookup_000);
+
+    return suite;
+}
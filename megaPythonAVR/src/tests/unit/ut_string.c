@@ -26,6 +26,8 @@
  * Log
  * ---
  *
+ * 2008/02/12   #124: Test string_getSlice()
+ * 2008/02/10   #123: Test string_concat() and string_join()
  * 2007/03/12   First.
  */
 
@@ -79,6 +81,114 @@ ut_string_newFromChar_000(CuTest *tc)
 }
 
 
+/**
+ * Tests string_concat():
+ *      retval is OK
+ *      the value is both strings, null terminated
+ */
+void
+ut_string_concat_000(CuTest *tc)
+{
+    pPmObj_t pstr1;
+    pPmObj_t pstr2;
+    pPmObj_t pstring;
+    uint8_t const *pcstr1 = (uint8_t const *)"forty";
+    uint8_t const *pcstr2 = (uint8_t const *)"-two";
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    string_new(&pcstr1, &pstr1);
+    string_new(&pcstr2, &pstr2);
+
+    retval = string_concat((pPmString_t)pstr1, (pPmString_t)pstr2, &pstring);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, ((pPmString_t)pstring)->length == 9);
+    CuAssertTrue(tc, sli_strcmp((char const *)((pPmString_t)pstring)->val,
+                                "forty-two") == 0);
+}
+
+
+/**
+ * Tests string_join():
+ *      retval is OK for a list of strings
+ *      the separator is only between the pieces
+ *      a piece that is not a string raises TypeError
+ */
+void
+ut_string_join_000(CuTest *tc)
+{
+    pPmObj_t psep;
+    pPmObj_t ppiece;
+    pPmObj_t plist;
+    pPmObj_t pstring;
+    uint8_t const *pcsep = (uint8_t const *)", ";
+    uint8_t const *pcpiece = (uint8_t const *)"ab";
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    string_new(&pcsep, &psep);
+    string_new(&pcpiece, &ppiece);
+    list_new(&plist);
+    list_append(plist, ppiece);
+    list_append(plist, ppiece);
+    list_append(plist, ppiece);
+
+    retval = string_join(psep, plist, &pstring);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, ((pPmString_t)pstring)->length == 10);
+    CuAssertTrue(tc, sli_strcmp((char const *)((pPmString_t)pstring)->val,
+                                "ab, ab, ab") == 0);
+
+    list_append(plist, PM_ONE);
+    retval = string_join(psep, plist, &pstring);
+    CuAssertTrue(tc, retval == PM_RET_EX_TYPE);
+}
+
+
+/**
+ * Test string_getSlice():
+ *      Pass a string and various indices;
+ *      the slices must have the expected chars, including slices of slices.
+ */
+void
+ut_string_getSlice_000(CuTest *tc)
+{
+    pPmObj_t pstring;
+    pPmObj_t pslice;
+    pPmObj_t pslice2;
+    uint8_t const *pcstr = (uint8_t const *)"The quick brown fox";
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    string_new(&pcstr, &pstring);
+
+    retval = string_getSlice(pstring, 4, 19, 1, &pslice);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, ((pPmString_t)pslice)->length == 15);
+    CuAssertTrue(tc, sli_strncmp((char const *)STRING_GET_CHARS(pslice),
+                                 "quick brown fox", 15) == 0);
+
+    retval = string_getSlice(pslice, -9, -4, 1, &pslice2);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, ((pPmString_t)pslice2)->length == 5);
+    CuAssertTrue(tc, sli_strncmp((char const *)STRING_GET_CHARS(pslice2),
+                                 "brown", 5) == 0);
+
+    retval = string_getSlice(pstring, 0, 100, 1, &pslice);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertPtrEquals(tc, pstring, pslice);
+
+    retval = string_getSlice(pstring, 0, 9, 4, &pslice);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, ((pPmString_t)pslice)->length == 3);
+    CuAssertTrue(tc, sli_strncmp((char const *)STRING_GET_CHARS(pslice),
+                                 "Tqk", 3) == 0);
+
+    retval = string_getSlice(pstring, 0, 1, 0, &pslice);
+    CuAssertTrue(tc, retval == PM_RET_EX_VAL);
+}
+
+
 /** Make a suite from all tests in this file */
 CuSuite *getSuite_testStringObj(void)
 {
@@ -86,6 +196,9 @@ CuSuite *getSuite_testStringObj(void)
 
     SUITE_ADD_TEST(suite, ut_string_new_000);
     SUITE_ADD_TEST(suite, ut_string_newFromChar_000);
+    SUITE_ADD_TEST(suite, ut_string_concat_000);
+    SUITE_ADD_TEST(suite, ut_string_join_000);
+    SUITE_ADD_TEST(suite, ut_string_getSlice_000);
 
     return suite;
 }
@@ -28,6 +28,7 @@
  * Log
  * ---
  *
+ * 2008/03/07   #135: Print the separator with one plat_putBytes()
  * 2007/01/17   #76: Print will differentiate on strings
  * 2007/01/09   #75: Printing support (P.Adelt)
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
@@ -266,8 +267,8 @@ dict_print(pPmObj_t pdict)
     {
         if (index != 0)
         {
-            plat_putByte(',');
-            plat_putByte(' ');
+            retval = plat_putBytes((uint8_t const *)", ", 2);
+            PM_RETURN_IF_ERROR(retval);
         }
         retval = seglist_getItem(keys, index, &pobj1);
         PM_RETURN_IF_ERROR(retval);
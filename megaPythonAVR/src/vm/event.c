@@ -0,0 +1,118 @@
+/*
+ * PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+ * Copyright 2007 David Greenberg
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#undef __FILE_ID__
+#define __FILE_ID__ 0x1A
+
+/**
+ * Event Queue
+ *
+ * Event queue operations.
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/20   #128: First
+ */
+
+/***************************************************************
+ * Includes
+ **************************************************************/
+
+#include "pm.h"
+
+
+/***************************************************************
+ * Macros
+ **************************************************************/
+
+/** Position in the ring buffer of the given index */
+#define EVENT_SLOT(indx) ((indx) & (EVENT_QUEUE_SIZE - 1))
+
+
+/***************************************************************
+ * Functions
+ **************************************************************/
+
+PmReturn_t
+event_post(uint8_t id, int32_t data)
+{
+    uint8_t head = gVmGlobal.eventQueue.eq_head;
+
+    /* Return ValueError if there is no such ID; not raised, see event.h */
+    if (id >= EVENT_NUM_IDS)
+    {
+        return PM_RET_EX_VAL;
+    }
+
+    /* Count the event if the ring is full */
+    if ((uint8_t)(head - gVmGlobal.eventQueue.eq_tail) == EVENT_QUEUE_SIZE)
+    {
+        gVmGlobal.eventQueue.eq_lost[id]++;
+    }
+
+    /* Fill the slot before the consumer can see it */
+    else
+    {
+        gVmGlobal.eventQueue.eq_buf[EVENT_SLOT(head)].ev_id = id;
+        gVmGlobal.eventQueue.eq_buf[EVENT_SLOT(head)].ev_data = data;
+        gVmGlobal.eventQueue.eq_head = (uint8_t)(head + 1);
+    }
+
+    VM_SET_RESCHEDULE(1);
+    return PM_RET_OK;
+}
+
+
+PmReturn_t
+event_dispatch(void)
+{
+    PmReturn_t retval = PM_RET_OK;
+    uint8_t tail = gVmGlobal.eventQueue.eq_tail;
+    uint8_t id;
+    int32_t data;
+
+    /* Take the events in the ring */
+    while (tail != gVmGlobal.eventQueue.eq_head)
+    {
+        id = gVmGlobal.eventQueue.eq_buf[EVENT_SLOT(tail)].ev_id;
+        data = gVmGlobal.eventQueue.eq_buf[EVENT_SLOT(tail)].ev_data;
+
+        /* Free the slot before the callback, which may fail */
+        tail++;
+        gVmGlobal.eventQueue.eq_tail = tail;
+
+        retval = interp_callback(id, data, C_FALSE);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Then those that didn't fit; their data is gone */
+    for (id = 0; id < EVENT_NUM_IDS; id++)
+    {
+        while (gVmGlobal.eventQueue.eq_lostDone[id]
+               != gVmGlobal.eventQueue.eq_lost[id])
+        {
+            gVmGlobal.eventQueue.eq_lostDone[id]++;
+            retval = interp_callback(id, 0, C_TRUE);
+            PM_RETURN_IF_ERROR(retval);
+        }
+    }
+
+    return retval;
+}
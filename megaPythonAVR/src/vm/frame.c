@@ -28,6 +28,8 @@
  * Log
  * ---
  *
+ * 2008/02/26   #131: Add generators
+ * 2008/02/14   #125: Clear the locals of a new frame
  * 2007/01/09   #75: fo_isImport for thread support (P.Adelt)
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
@@ -52,6 +54,7 @@ frame_new(pPmObj_t pfunc, pPmObj_t *r_pobj)
     int16_t fsize = 0;
     int8_t stacksz = (int8_t)0;
     int8_t nlocals = (int8_t)0;
+    uint8_t isgen;
     pPmCo_t pco = C_NULL;
     pPmFrame_t pframe = C_NULL;
     uint8_t const *paddr = C_NULL;
@@ -67,8 +70,9 @@ frame_new(pPmObj_t pfunc, pPmObj_t *r_pobj)
         return retval;
     }
 
-    /* Get sizes needed to calc frame size */
-    paddr = pco->co_codeimgaddr + CI_STACKSIZE_FIELD;
+    /* Get the generator flag and the sizes needed to calc frame size */
+    paddr = pco->co_codeimgaddr + CI_ARGCOUNT_FIELD;
+    isgen = (mem_getByte(pco->co_memspace, &paddr) & CI_GENERATOR_FLAG) != 0;
     stacksz = mem_getByte(pco->co_memspace, &paddr);
 
     /* Now paddr points to CI_NLOCALS_FIELD */
@@ -95,13 +99,39 @@ frame_new(pPmObj_t pfunc, pPmObj_t *r_pobj)
     pframe->fo_globals = ((pPmFunc_t)pfunc)->f_globals;
     pframe->fo_attrs = ((pPmFunc_t)pfunc)->f_attrs;
 
+    /*
+     * Clear the locals; the GC marks them even before they are set,
+     * as in the frame of a thread that is still waiting to run.
+     */
+    sli_memset((uint8_t *)pframe->fo_locals, 0, nlocals * sizeof(pPmObj_t));
+
     /* Empty stack points to one past locals */
     pframe->fo_sp = &(pframe->fo_locals[nlocals]);
 
     /* By default, this is a normal frame, not an import call one */
     pframe->fo_noReturn = 0;
+    pframe->fo_isGen = isgen;
 
     /* Return ptr to frame */
     *r_pobj = (pPmObj_t)pframe;
     return retval;
 }
+
+
+PmReturn_t
+frame_newGenerator(pPmFrame_t pframe, pPmObj_t *r_pobj)
+{
+    PmReturn_t retval;
+    pPmGenerator_t pgen;
+
+    retval = heap_getChunk(sizeof(PmGenerator_t), (uint8_t **)r_pobj);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The frame has not run yet; it returns to whoever runs it */
+    pgen = (pPmGenerator_t)*r_pobj;
+    OBJ_SET_TYPE(pgen, OBJ_TYPE_GEN);
+    pgen->gen_frame = pframe;
+    pframe->fo_back = C_NULL;
+
+    return retval;
+}
@@ -28,6 +28,8 @@
  * Log
  * ---
  *
+ * 2008/02/26   #131: Add generators
+ * 2008/02/14   #125: Note the objs made in one native code session
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
  * 2002/12/15   Frame's memspace set to use one byte.
@@ -44,6 +46,13 @@
  */
 #define NATIVE_MAX_NUM_LOCALS   8
 
+/**
+ * The number of objs made in one native code session that the native frame
+ * keeps note of.  While a session has made no more than this, the GC can
+ * run inside it without leaving the marks of older objs stale.
+ */
+#define NATIVE_NUM_NEW          8
+
 
 /***************************************************************
  * Types
@@ -139,12 +148,33 @@ typedef struct PmFrame_s
     /** Frame can be an special vm-call that shouldn't push its returned value onto the stack */
     uint8_t fo_noReturn:1;
 
+    /** Frame of a generator; it is suspended at each yield */
+    uint8_t fo_isGen:1;
+
     /** Array of local vars and stack (space appended at alloc) */
     pPmObj_t fo_locals[1];
     /* WARNING: Do not put new fields below fo_locals */
 } PmFrame_t,
  *pPmFrame_t;
 
+/**
+ * Generator
+ *
+ * Calling a generator func makes a generator that holds the func's frame.
+ * FOR_ITER runs the frame until it yields the next item, then it is
+ * suspended until the next FOR_ITER.  So a generator costs one frame.
+ */
+typedef struct PmGenerator_s
+{
+    /** Obligatory obj descriptor */
+    PmObjDesc_t od;
+
+    /** Frame of the generator; C_NULL once the generator returned */
+    pPmFrame_t gen_frame;
+} PmGenerator_t,
+ *pPmGenerator_t;
+
+
 /**
  * Native Frame
  *
@@ -176,6 +206,12 @@ typedef struct PmNativeFrame_s
     /** Counter for number of times the GC runs in one native code session */
     uint8_t nf_gcCount;
 
+    /** Number of objs made in this session, past NATIVE_NUM_NEW if more */
+    uint8_t nf_numNew;
+
+    /** The objs made in this session, see heap_gcRun() */
+    pPmObj_t nf_new[NATIVE_NUM_NEW];
+
     /** Number of args passed to the native function */
     uint8_t nf_numlocals;
 
@@ -200,4 +236,13 @@ typedef struct PmNativeFrame_s
  */
 PmReturn_t frame_new(pPmObj_t pfunc, pPmObj_t *r_pobj);
 
+/**
+ * Allocates a generator to hold the frame of a generator func.
+ *
+ * @param   pframe Frame of a generator func, with its args set
+ * @param   r_pobj Return value; the new generator.
+ * @return  Return status.
+ */
+PmReturn_t frame_newGenerator(pPmFrame_t pframe, pPmObj_t *r_pobj);
+
 #endif /* __FRAME_H__ */
@@ -29,6 +29,9 @@
  * Log
  * ---
  *
+ * 2008/02/22   #129: The globals are part of the VM instance
+ * 2008/02/20   #128: Callbacks are kept by event ID, not in a dict
+ * 2008/02/04   #110: Keep the builtins module in the module cache
  * 2007/01/09   #75: Restructured for green threads (P.Adelt)
  * 2006/09/10   #20: Implement assert statement
  * 2006/08/29   #12: Make mem_*() funcs use RAM when target is DESKTOP
@@ -48,15 +51,21 @@
  * Constants
  **************************************************************/
 
-uint8_t const *global_bistr = (uint8_t const *)"__bi";
+/** Name of the builtins module; string_new() moves the pointer it's given */
+#define GLOBAL_BISTR (uint8_t const *)"__bi"
 
 
 /***************************************************************
  * Globals
  **************************************************************/
 
-/** Most PyMite globals all in one convenient place */
-volatile PmVmGlobal_t gVmGlobal;
+/** The default VM, with most PyMite globals all in one convenient place */
+PmVm_t pm_vmDefault;
+
+#if USE_MULTI_VM
+/** Every native thread starts with the default VM */
+__thread pPmVm_t pm_vm = &pm_vmDefault;
+#endif /* USE_MULTI_VM */
 
 
 /***************************************************************
@@ -115,7 +124,7 @@ global_init(void)
     /* Init empty builtins */
     gVmGlobal.builtins = C_NULL;
 
-    /* Empty img info list */
+    /* Empty img info list (the img index was cleared with the struct) */
     gVmGlobal.pimglist = C_NULL;
 
     /* Init native frame */
@@ -128,10 +137,7 @@ global_init(void)
     PM_RETURN_IF_ERROR(retval);
     gVmGlobal.threadList = (pPmList_t)pobj;
 
-    /* Create the callback dictionary */
-    retval = dict_new(&pobj);
-    PM_RETURN_IF_ERROR(retval);
-    gVmGlobal.callbacks = (pPmDict_t)pobj;
+    /* The callbacks and event queue were cleared with the struct */
 
     return retval;
 }
@@ -141,15 +147,17 @@ global_setBuiltins(pPmFunc_t pmod)
 {
     PmReturn_t retval = PM_RET_OK;
     pPmObj_t pkey = C_NULL;
+    uint8_t const *bistr = GLOBAL_BISTR;
 
     if (PM_PBUILTINS == C_NULL)
     {
         /* Need to load builtins first */
-        global_loadBuiltins();
+        retval = global_loadBuiltins();
+        PM_RETURN_IF_ERROR(retval);
     }
 
     /* Put builtins module in the module's attrs dict */
-    retval = string_new(&global_bistr, &pkey);
+    retval = string_new(&bistr, &pkey);
     PM_RETURN_IF_ERROR(retval);
 
     return dict_setItem((pPmObj_t)pmod->f_attrs, pkey, PM_PBUILTINS);
@@ -162,11 +170,12 @@ global_loadBuiltins(void)
     PmReturn_t retval = PM_RET_OK;
     pPmObj_t pkey = C_NULL;
     uint8_t const *nonestr = (uint8_t const *)"None";
+    uint8_t const *bistr = GLOBAL_BISTR;
     pPmObj_t pstr = C_NULL;
     pPmObj_t pbimod;
 
     /* Import the builtins */
-    retval = string_new(&global_bistr, &pstr);
+    retval = string_new(&bistr, &pstr);
     PM_RETURN_IF_ERROR(retval);
     retval = mod_import(pstr, &pbimod);
     PM_RETURN_IF_ERROR(retval);
@@ -186,9 +195,7 @@ global_loadBuiltins(void)
     retval = dict_setItem(PM_PBUILTINS, pkey, PM_NONE);
     PM_RETURN_IF_ERROR(retval);
 
-    /* Deallocate builtins module */
-    retval = heap_freeChunk((pPmObj_t)pbimod);
-
+    /* The builtins module stays in the module cache; do not free it */
     return retval;
 }
 
@@ -28,6 +28,20 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: Add the pool of the images being loaded
+ * 2008/03/21   #142: Add the memspace page cache
+ * 2008/03/19   #141: Add the baseline of pm_reset()
+ * 2008/03/15   #139: Add the list of mapped image files
+ * 2008/03/09   #136: Add the string of the code image being loaded
+ * 2008/03/05   #134: Keep the tick the running thread started at
+ * 2008/03/03   #133: Add the descriptor waits of the desktop
+ * 2008/03/01   #132: Keep the end of the running thread's timeslice
+ * 2008/02/22   #129: Gather all VM state in a VM instance, PM_VM
+ * 2008/02/20   #128: Add the event queue, callbacks are kept by event ID
+ * 2008/02/16   #126: Add the timer wheel
+ * 2008/02/14   #125: Add the ready queues
+ * 2008/02/12   #124: Add the single-char strings
+ * 2008/02/04   #110: Add image index
  * 2008/01/19   Included locking structure
  * 2007/01/09   #75: Restructured for green threads (P.Adelt)
  * 2006/09/10   #20: Implement assert statement
@@ -40,6 +54,20 @@
  * Constants
  **************************************************************/
 
+/**
+ * When nonzero, several VMs can run in one process, each on its own
+ * native thread.  The state of the VM a native thread runs is found
+ * through a thread-local pointer, see pm_bindVm().  When zero, there is
+ * one VM whose state is at a fixed address, as before.
+ */
+#ifndef USE_MULTI_VM
+#ifdef TARGET_DESKTOP
+#define USE_MULTI_VM 1
+#else
+#define USE_MULTI_VM 0
+#endif
+#endif
+
 /** The global root PmGlobals Dict object */
 #define PM_PBUILTINS    (pPmObj_t)(gVmGlobal.builtins)
 
@@ -127,6 +155,21 @@ typedef struct PmVmGlobal_s
     /** Ptr to stack of code image info. */
     pPmImgInfo_t pimglist;
 
+    /** Hashed index of the code image info structs in pimglist */
+    pPmImgInfo_t imgindex[IMG_INDEX_SIZE];
+
+    /**
+     * String that holds the code image being loaded from RAM, or C_NULL.
+     * Each code obj loaded from it keeps it, so the GC can mark it.
+     */
+    pPmObj_t pimgstr;
+
+    /**
+     * Pool of the image set an image is being loaded from, or C_NULL.
+     * Set only while images are loaded, see obj_loadFromImg().
+     */
+    pPmTuple_t pimgpool;
+
     /** The single native frame.  Static alloc so it won't be GC'd */
     PmNativeFrame_t nativeframe;
 
@@ -139,17 +182,78 @@ typedef struct PmVmGlobal_s
     /** Line number for when an error occurs */
     uint16_t errLineNum;
 
-    /** Thread list */
+    /** Thread list; every live thread, whatever its state */
     pPmList_t threadList;
 
     /** Ptr to current thread */
     pPmThread_t pthread;
 
+    /** First thread of the ready queue of each priority */
+    pPmThread_t readyHead[THREAD_NUM_PRIORITIES];
+
+    /** Last thread of the ready queue of each priority */
+    pPmThread_t readyTail[THREAD_NUM_PRIORITIES];
+
+    /** Bit n is set when the ready queue of priority n is not empty */
+    uint8_t readyMask;
+
+    /** Sleeping threads, listed in the slot of their wake tick */
+    pPmThread_t timerWheel[THREAD_TIMER_SLOTS];
+
+    /** Last tick whose timer wheel slot was looked at */
+    uint32_t timerTick;
+
     /** Flag to trigger rescheduling or lock in atomic mode (prevents rescheduling) */
     uint8_t schedule;
 
-    /** Dict for callbacks for interrupts and things */
-    pPmDict_t callbacks;
+#if USE_STRING_CACHE
+    /** String obj cache: a list of all string objects */
+    pPmString_t pstrcache;
+#endif /* USE_STRING_CACHE */
+
+    /** Method cache, see class_getMethod() */
+    PmMethodCacheEntry_t methodCache[CLASS_METHOD_CACHE_SIZE];
+
+    /** Value of pm_timerMsTicks at which the running thread's slice ends */
+    uint32_t sliceEnd;
+
+#if USE_THREAD_STATS
+    /** Value of pm_timerMsTicks when the running thread started running */
+    uint32_t runTick;
+#endif /* USE_THREAD_STATS */
+
+    /** Callback funcs by event ID, C_NULL where none is registered */
+    pPmFunc_t callbacks[EVENT_NUM_IDS];
+
+    /** Events posted by interrupts, waiting to be dispatched */
+    PmEventQueue_t eventQueue;
+
+#if USE_STRING_CHARS
+    /** Single-char strings by char; made on first use, never freed */
+    pPmString_t pcharstrs[256];
+#endif /* USE_STRING_CHARS */
+
+#if USE_MEM_CACHE
+    /** Pages of the memspaces read with plat_memRead() */
+    PmMemCache_t memCache;
+#endif /* USE_MEM_CACHE */
+
+    /** Copy of the VM that pm_reset() returns to; C_NULL if none */
+    struct PmVm_s *pbaseline;
+
+    /** Size of the start of the heap that holds the baseline's chunks */
+    uint16_t baselineUsed;
+
+#ifdef TARGET_DESKTOP
+    /** epoll fd plus one of the descriptors threads wait on; 0 until used */
+    int ioEpoll;
+
+    /** Number of threads waiting on descriptors */
+    uint16_t ioWaits;
+
+    /** Mapped image files; not marked by the GC, see img_sweepFiles() */
+    pPmImgFile_t pimgfiles;
+#endif /* TARGET_DESKTOP */
 } PmVmGlobal_t,
  *pPmVmGlobal_t;
 
@@ -158,7 +262,41 @@ typedef struct PmVmGlobal_s
  * Globals
  **************************************************************/
 
-extern volatile PmVmGlobal_t gVmGlobal;
+/**
+ * VM instance
+ *
+ * Holds all the state of one VM.  Each VM has its own heap,
+ * so objs are never shared between VMs.  Code that uses a VM must be
+ * compiled with the same HEAP_SIZE as the VM.
+ */
+typedef struct PmVm_s
+{
+    /** Globals; first, so their offsets don't depend on HEAP_SIZE */
+    volatile PmVmGlobal_t vm_global;
+
+    /** Heap */
+    PmHeap_t vm_heap;
+} PmVm_t,
+ *pPmVm_t;
+
+
+/***************************************************************
+ * Globals
+ **************************************************************/
+
+/** The VM used by a native thread that hasn't bound another */
+extern PmVm_t pm_vmDefault;
+
+#if USE_MULTI_VM
+/** The VM of the current native thread */
+extern __thread pPmVm_t pm_vm;
+#define PM_VM           (pm_vm)
+#else
+#define PM_VM           (&pm_vmDefault)
+#endif /* USE_MULTI_VM */
+
+/** The globals of the current VM */
+#define gVmGlobal       (PM_VM->vm_global)
 
 
 /***************************************************************
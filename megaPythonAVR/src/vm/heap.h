@@ -28,6 +28,13 @@
  * Log
  * ---
  *
+ * 2008/03/23   #143: Add heap_gcGetAuto()
+ * 2008/03/19   #141: Add heap_getUsed()
+ * 2008/03/17   #140: Add heap_relocate() for VM snapshots
+ * 2008/02/22   #129: Move the heap types here for the VM instance
+ * 2008/02/14   #125: Add heap_gcEndNative()
+ * 2008/02/10   #123: Add temporary roots for objs held only by C code,
+ *              add heap_gcIsMarked()
  * 2006/11/15   #53: Fix Win32/x86 build break
  * 2006/09/10   #20: Implement assert statement
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
@@ -37,6 +44,36 @@
  */
 
 
+/***************************************************************
+ * Constants
+ **************************************************************/
+
+/** Number of objs C code can keep in the temporary roots at once */
+#ifndef HEAP_NUM_TEMP_ROOTS
+#define HEAP_NUM_TEMP_ROOTS 8
+#endif
+
+/**
+ * When nonzero, the state of a VM can be saved to a file and restored
+ * in a new process, see pm_snapshot().
+ */
+#ifndef USE_HEAP_SNAPSHOT
+#ifdef TARGET_DESKTOP
+#define USE_HEAP_SNAPSHOT 1
+#else
+#define USE_HEAP_SNAPSHOT 0
+#endif
+#endif
+
+/**
+ * Static initial size of the heap.
+ * A value should be provided by the makefile
+ */
+#ifndef HEAP_SIZE
+#error HEAP_SIZE not defined by the build environment
+#endif
+
+
 /***************************************************************
  * Macros
  **************************************************************/
@@ -50,6 +87,74 @@
 #endif
 
 
+/***************************************************************
+ * Types
+ **************************************************************/
+
+/**
+ * The following is a diagram of the heap descriptor at the head of the chunk:
+ *
+ *                MSb          LSb
+ *                7 6 5 4 3 2 1 0
+ *      pchunk-> +-+-+-+-+-+-+-+-+
+ *               |     S[9:2]    |     S := Size of the chunk (2 LSbs dropped)
+ *               +-+-+-----------+     F := Chunk free bit (not in use)
+ *               |F|R| S[15:10]  |     R := Bit reserved for future use
+ *               +-+-+-----------+
+ *               |     P(L)      |     P := hd_prev: Pointer to previous node
+ *               |     P(H)      |     N := hd_next: Pointer to next node
+ *               |     N(L)      |
+ *               |     N(H)      |     Theoretical min size == 6
+ *               +---------------+     Effective min size == 8
+ *               | unused space  |     (12 on 32-bit MCUs)
+ *               ...           ...
+ *               | end chunk     |
+ *               +---------------+
+ */
+typedef struct PmHeapChunk_s
+{
+    /** Heap descriptor */
+    uint16_t hd;
+
+    /** Ptr to prev heap chunk */
+    struct PmHeapChunk_s *prev;
+
+    /** Ptr to next heap chunk */
+    struct PmHeapChunk_s *next;
+} PmHeapDesc_t,
+ *pPmHeapDesc_t;
+
+typedef struct PmHeap_s
+{
+    /*
+     * WARNING: Leave 'base' field at the top of struct to increase chance
+     * of alignment when compiler doesn't recognize the aligned attribute
+     * which is specific to GCC
+     */
+    /** Global declaration of heap. */
+    uint8_t base[HEAP_SIZE];
+
+    /** Ptr to list of free chunks; sorted smallest to largest. */
+    pPmHeapDesc_t pfreelist;
+
+    /** The amount of heap space available in free list */
+    uint16_t avail;
+
+    /** Garbage collection mark value */
+    uint8_t gcval;
+
+    /** Boolean to indicate if GC should run automatically */
+    uint8_t auto_gc;
+
+    /** Objs that are only referenced by C code; marked as roots */
+    pPmObj_t temp_roots[HEAP_NUM_TEMP_ROOTS];
+
+    /** Number of objs in temp_roots */
+    uint8_t temp_root_index;
+} PmHeap_t,
+ *pPmHeap_t;
+
+
 /***************************************************************
  * Prototypes
  **************************************************************/
@@ -88,6 +193,15 @@ PmReturn_t heap_freeChunk(pPmObj_t ptr);
  */
 PmReturn_t heap_getAvail(uint16_t *r_avail);
 
+/**
+ * Returns the size of the start of the heap that holds all the chunks
+ * in use.  The rest is a free chunk, of which only the descriptor is
+ * in the size; its contents need not be kept.
+ *
+ * @return  Number of bytes from the start of the heap
+ */
+uint16_t heap_getUsed(void);
+
 /**
  * Runs the mark-sweep garbage collector
  *
@@ -95,6 +209,46 @@ PmReturn_t heap_getAvail(uint16_t *r_avail);
  */
 PmReturn_t heap_gcRun(void);
 
+/**
+ * Returns true if the running collection has marked the obj.
+ *
+ * For caches that must not keep objs alive; between marking and sweeping,
+ * they drop the objs that are about to be freed.
+ *
+ * @param   pobj Obj that is still allocated
+ * @return  C_TRUE if the obj will survive the collection
+ */
+uint8_t heap_gcIsMarked(pPmObj_t pobj);
+
+/**
+ * Keeps an obj alive through garbage collections until it is popped.
+ *
+ * For objs that C code allocated and is still filling in, before they are
+ * reachable from anything the GC marks (such as a list that is allocated
+ * and then grown).
+ *
+ * @param   pobj Obj to keep
+ * @param   r_objid Return arg; id to give heap_gcPopTempRoot()
+ * @return  Return code; MemoryError if the temporary roots are full
+ */
+PmReturn_t heap_gcPushTempRoot(pPmObj_t pobj, uint8_t *r_objid);
+
+/**
+ * Releases the temporary root with the given id and any pushed after it.
+ *
+ * @param   objid Id returned by heap_gcPushTempRoot()
+ */
+void heap_gcPopTempRoot(uint8_t objid);
+
+/**
+ * Ends a session of native code.
+ *
+ * The objs it made were marked to survive a collection while it ran.
+ * They are reachable (or garbage) now, so the noted ones are unmarked;
+ * a later collection inside native code may not be able to clear marks.
+ */
+void heap_gcEndNative(void);
+
 /**
  * Enables (if true) or disables automatic garbage collection
  *
@@ -103,9 +257,32 @@ PmReturn_t heap_gcRun(void);
  */
 PmReturn_t heap_gcSetAuto(uint8_t bool);
 
+/**
+ * Returns true if automatic garbage collection is enabled
+ *
+ * @return  The value last given to heap_gcSetAuto(), C_TRUE at first
+ */
+uint8_t heap_gcGetAuto(void);
+
 /**
  * Prints out debugging information about the heap
  */
 void heap_gcPrintFreelist(void);
 
+#if USE_HEAP_SNAPSHOT
+/**
+ * Moves the pointers of the current VM, whose bytes were copied from
+ * a VM at another address.  Pointers into the old VM move with it;
+ * all others point into the code images of the program, which may
+ * have moved too.  The VM must have been at rest when it was copied:
+ * no thread running native code or waiting on a descriptor.
+ *
+ * @param   poldvm Address of the VM the bytes were copied from
+ * @param   poldimg Address some code image had in the old VM's process
+ * @param   pnewimg Address the same code image has now
+ */
+void heap_relocate(uint8_t const *poldvm,
+                   uint8_t const *poldimg, uint8_t const *pnewimg);
+#endif /* USE_HEAP_SNAPSHOT */
+
 #endif /* __HEAP_H__ */
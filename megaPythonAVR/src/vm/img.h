@@ -29,11 +29,42 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: An image set may lead with a pool of shared objs
+ * 2008/03/23   #143: Images may be compressed, add IMG_IS_IMAGE()
+ * 2008/03/15   #139: Images from a file replace older ones of the same
+ *              names, the file is unmapped once no image in it is used
+ * 2008/02/04   #110: Hashed image index and per-image module cache
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
  * 2002/05/17   First.
  */
 
+/***************************************************************
+ * Constants
+ **************************************************************/
+
+/**
+ * Number of buckets in the image index (gVmGlobal.imgindex).
+ * Must be a power of two.  Each bucket costs one pointer of RAM.
+ */
+#ifndef IMG_INDEX_SIZE
+#define IMG_INDEX_SIZE 8
+#endif
+
+
+/***************************************************************
+ * Macros
+ **************************************************************/
+
+/** Returns the image index bucket number for the given name string */
+#define IMG_INDEX_BUCKET(pstr) \
+            (string_hash(pstr) & (IMG_INDEX_SIZE - 1))
+
+/** Returns true if the type byte starts an image, compressed or not */
+#define IMG_IS_IMAGE(type) \
+            (((type) == OBJ_TYPE_CIM) || ((type) == OBJ_TYPE_ZIM))
+
+
 /***************************************************************
  * Types
  **************************************************************/
@@ -42,9 +73,9 @@
  * Image information struct.
  *
  * This struct holds the location information of a code image.
- * The VM maintains one linked list of these structs
- * as the sole list to search when a named code object
- * is to be loaded.
+ * The VM maintains one linked list of these structs (which keeps
+ * them reachable for the GC) and a hashed index of the same structs
+ * which is searched when a named code object is to be loaded.
  */
 typedef struct PmImgInfo_s
 {
@@ -62,10 +93,49 @@ typedef struct PmImgInfo_s
     
     /** Ptr to next image ID struct */
     struct PmImgInfo_s *next;
+
+    /** Ptr to next image ID struct in the same image index bucket */
+    struct PmImgInfo_s *ii_hnext;
+
+    /**
+     * Module obj made from this image, C_NULL until first imported.
+     * Acts as the VM's sys.modules: a module is made only once.
+     */
+    pPmObj_t ii_module;
+
+    /** Pool of the image set the image is in, or C_NULL if it has none */
+    pPmTuple_t ii_pool;
 } PmImgInfo_t,
  *pPmImgInfo_t;
 
 
+#ifdef TARGET_DESKTOP
+/**
+ * Image file struct.
+ *
+ * Holds the place of a file of images mapped by img_findInFile().
+ * The VM keeps a list of these structs which the GC does not mark;
+ * the code objs and image infos whose images are in the file mark it.
+ * img_sweepFiles() unmaps the file when nothing marked it.
+ */
+typedef struct PmImgFile_s
+{
+    /** Object descriptor */
+    PmObjDesc_t od;
+
+    /** Address of the file's bytes */
+    uint8_t const *if_addr;
+
+    /** Length of the file */
+    uint32_t if_len;
+
+    /** Ptr to next image file struct */
+    struct PmImgFile_s *next;
+} PmImgFile_t,
+ *pPmImgFile_t;
+#endif /* TARGET_DESKTOP */
+
+
 /***************************************************************
  * Prototypes
  **************************************************************/
@@ -76,6 +146,7 @@ typedef struct PmImgInfo_s
  * Find consecutive code images in the given memory space
  * starting at the given address.  Store (name, address)
  * info for use when interpreter needs to load a module.
+ * A pool of the objs the images share may come before them.
  *
  * @param   memspace the memory space to search.
  * @param   paddr ptr to address value to start search.
@@ -83,6 +154,54 @@ typedef struct PmImgInfo_s
  */
 PmReturn_t img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr);
 
+/**
+ * Finds the image info struct of the image with the given name.
+ *
+ * Only the image index bucket for the name is searched.
+ * When more than one image has the same name, the one that
+ * img_findInMem() indexed most recently is returned.
+ *
+ * @param   pname String obj holding the name of the image
+ * @param   r_pii Return parm, ptr to the image info struct
+ * @return  PM_RET_OK if found, PM_RET_NO if no image has that name
+ */
+PmReturn_t img_lookup(pPmString_t pname, pPmImgInfo_t *r_pii);
+
+/**
+ * Removes the images of the same name that were indexed before
+ * the given one from the image list and index.  A module made from
+ * a removed image lives on while something refers to it.
+ *
+ * @param   pii The image info struct to keep
+ */
+void img_dropOlder(pPmImgInfo_t pii);
+
+#ifdef TARGET_DESKTOP
+/**
+ * Maps a file of images and indexes them; they replace the images
+ * of the same names.  See pm_loadImgFile().
+ *
+ * @param   fn Name of the image file
+ * @return  Return status
+ */
+PmReturn_t img_findInFile(uint8_t const *fn);
+
+/**
+ * Returns the image file struct of the mapped file that holds the
+ * address, or C_NULL if no mapped file holds it.
+ *
+ * @param   paddr Address in MEMSPACE_PROG
+ * @return  Image file struct or C_NULL
+ */
+pPmObj_t img_getFile(uint8_t const *paddr);
+
+/**
+ * Unmaps the image files the GC did not mark and forgets them.
+ * Called by heap_gcRun() between marking and sweeping.
+ */
+void img_sweepFiles(void);
+#endif /* TARGET_DESKTOP */
+
 /**
  * Loads a string obj from the names tuple at the given index.
  *
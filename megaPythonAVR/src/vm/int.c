@@ -28,6 +28,7 @@
  * Log
  * ---
  *
+ * 2008/03/07   #135: Print the digits with one plat_putBytes()
  * 2007/01/09   #75: Printing support (P.Adelt)
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
@@ -153,7 +154,6 @@ int_print(pPmObj_t pint)
     /* 2^31-1 has 10 decimal digits, plus sign and zero byte */
     uint8_t tBuffer[10 + 1 + 1];
     uint8_t bytesWritten;
-    uint8_t k;
     PmReturn_t retval = PM_RET_OK;
 
     C_ASSERT(pint != C_NULL);
@@ -181,50 +181,46 @@ int_print(pPmObj_t pint)
     C_ASSERT(bytesWritten != 0);
     C_ASSERT(bytesWritten < sizeof(tBuffer));
 
-    for (k = (uint8_t)0; k < bytesWritten; k++)
-    {
-        retval = plat_putByte(tBuffer[k]);
-        PM_RETURN_IF_ERROR(retval);
-    }
-    return PM_RET_OK;
+    return plat_putBytes(tBuffer, bytesWritten);
+}
+
+
+/* Puts the two hex digits of the byte in the buffer */
+void
+int_hexByte(uint8_t b, uint8_t *pbuf)
+{
+    pbuf[0] = (b >> 4) + '0';
+    if (pbuf[0] > '9')
+        pbuf[0] += ('a' - '0' - 10);
+
+    pbuf[1] = (b & (uint8_t)0x0F) + '0';
+    if (pbuf[1] > '9')
+        pbuf[1] += ('a' - '0' - (uint8_t)10);
 }
 
 
 PmReturn_t
 int_printHexByte(uint8_t b)
 {
-    uint8_t nibble;
-    PmReturn_t retval;
+    uint8_t buf[2];
 
-    nibble = (b >> 4) + '0';
-    if (nibble > '9')
-        nibble += ('a' - '0' - 10);
-    retval = plat_putByte(nibble);
-    PM_RETURN_IF_ERROR(retval);
-
-    nibble = (b & (uint8_t)0x0F) + '0';
-    if (nibble > '9')
-        nibble += ('a' - '0' - (uint8_t)10);
-    retval = plat_putByte(nibble);
-    return retval;
+    int_hexByte(b, buf);
+    return plat_putBytes(buf, 2);
 }
 
 
 PmReturn_t
 _int_printHex(int32_t n)
 {
-    PmReturn_t retval;
+    uint8_t buf[8];
 
     /* Print the hex value, most significant byte first */
-    retval = int_printHexByte((n >> (uint8_t)24) & (uint8_t)0xFF);
-    PM_RETURN_IF_ERROR(retval);
-    retval = int_printHexByte((n >> (uint8_t)16) & (uint8_t)0xFF);
-    PM_RETURN_IF_ERROR(retval);
-    retval = int_printHexByte((n >> (uint8_t)8) & (uint8_t)0xFF);
-    PM_RETURN_IF_ERROR(retval);
-    retval = int_printHexByte(n & (uint8_t)0xFF);
+    int_hexByte((n >> (uint8_t)24) & (uint8_t)0xFF, &buf[0]);
+    int_hexByte((n >> (uint8_t)16) & (uint8_t)0xFF, &buf[2]);
+    int_hexByte((n >> (uint8_t)8) & (uint8_t)0xFF, &buf[4]);
+    int_hexByte(n & (uint8_t)0xFF, &buf[6]);
 
-    return retval;
+    return plat_putBytes(buf, 8);
 }
 
 
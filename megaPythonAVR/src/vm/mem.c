@@ -30,6 +30,8 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: Read the memspaces from MEMSPACE_EEPROM on a page
+ *              at a time through a page cache, add mem_flushCache()
  * 2006/08/31   #9: Fix BINARY_SUBSCR for case stringobj[intobj]
  * 2006/08/29   #12: Make mem_*() funcs use RAM when target is DESKTOP
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
@@ -45,10 +47,96 @@
 #include "pm.h"
 
 
+/***************************************************************
+ * Macros
+ **************************************************************/
+
+#if USE_MEM_CACHE
+/** Page cache of the current VM */
+#define mem_cache ((pPmMemCache_t)&gVmGlobal.memCache)
+
+/** Offset of the address in its page */
+#define MEM_PAGE_OFFSET(paddr) \
+    ((uint16_t)((unsigned long)(paddr) & (MEM_PAGE_SIZE - 1)))
+#endif /* USE_MEM_CACHE */
+
+
 /***************************************************************
  * Functions
  **************************************************************/
 
+#if USE_MEM_CACHE
+/* Returns the page that holds the address, reading it on a miss */
+static pPmMemPage_t
+mem_getPage(PmMemSpace_t memspace, uint8_t const *paddr)
+{
+    pPmMemCache_t pcache = mem_cache;
+    pPmMemPage_t ppage;
+    uint8_t const *pstart = paddr - MEM_PAGE_OFFSET(paddr);
+    uint8_t i;
+
+    /* Most reads are in the page read last */
+    ppage = &pcache->mc_pages[pcache->mc_last];
+    if ((ppage->mp_addr == pstart) && (ppage->mp_memspace == memspace))
+    {
+        pcache->mc_hits++;
+        return ppage;
+    }
+
+    for (i = 0; i < MEM_CACHE_PAGES; i++)
+    {
+        ppage = &pcache->mc_pages[i];
+        if ((ppage->mp_addr == pstart) && (ppage->mp_memspace == memspace))
+        {
+            pcache->mc_hits++;
+            pcache->mc_last = i;
+            return ppage;
+        }
+    }
+
+    /* Fill the pages in turn */
+    pcache->mc_misses++;
+    i = pcache->mc_next;
+    pcache->mc_next = (uint8_t)((i + 1) % MEM_CACHE_PAGES);
+    pcache->mc_last = i;
+    ppage = &pcache->mc_pages[i];
+    ppage->mp_addr = pstart;
+    ppage->mp_memspace = memspace;
+    plat_memRead(memspace, pstart, ppage->mp_bytes, MEM_PAGE_SIZE);
+    return ppage;
+}
+
+
+uint8_t
+mem_getCachedByte(PmMemSpace_t memspace, uint8_t const **paddr)
+{
+    uint8_t b;
+
+    b = mem_getPage(memspace, *paddr)->mp_bytes[MEM_PAGE_OFFSET(*paddr)];
+    *paddr += 1;
+    return b;
+}
+
+
+void
+mem_flushCache(PmMemSpace_t memspace)
+{
+    pPmMemCache_t pcache = mem_cache;
+    uint8_t i;
+
+    /* Make its pages like the empty ones, which no read matches */
+    for (i = 0; i < MEM_CACHE_PAGES; i++)
+    {
+        if (pcache->mc_pages[i].mp_memspace == memspace)
+        {
+            pcache->mc_pages[i].mp_addr = C_NULL;
+            pcache->mc_pages[i].mp_memspace = MEMSPACE_RAM;
+        }
+    }
+}
+#endif /* USE_MEM_CACHE */
+
+
 uint16_t
 mem_getWord(PmMemSpace_t memspace, uint8_t const **paddr)
 {
@@ -84,6 +172,32 @@ mem_copy(PmMemSpace_t memspace,
         return;
     }
 
+#if USE_MEM_CACHE
+    /* Copy memory from a cached memspace a page at a time */
+    else if (memspace >= MEMSPACE_EEPROM)
+    {
+        pPmMemPage_t ppage;
+        uint16_t offset;
+        uint16_t n;
+
+        while (count > 0)
+        {
+            ppage = mem_getPage(memspace, *psrc);
+            offset = MEM_PAGE_OFFSET(*psrc);
+            n = MEM_PAGE_SIZE - offset;
+            if (n > count)
+            {
+                n = count;
+            }
+            sli_memcpy(*pdest, &ppage->mp_bytes[offset], n);
+            *psrc += n;
+            *pdest += n;
+            count -= n;
+        }
+        return;
+    }
+#endif /* USE_MEM_CACHE */
+
     /* Copy memory from non-RAM to RAM */
     else
     {
@@ -28,6 +28,8 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: Add the page cache of the memspaces read by
+ *              plat_memRead(), and mem_flushCache()
  * 2006/08/31   #9: Fix BINARY_SUBSCR for case stringobj[intobj]
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
@@ -35,6 +37,34 @@
  */
 
 
+/***************************************************************
+ * Constants
+ **************************************************************/
+
+/**
+ * When nonzero, bytes of the memspaces from MEMSPACE_EEPROM on are read
+ * a page at a time with plat_memRead() and kept in a page cache.
+ * PORT: the platform must implement plat_memRead().
+ */
+#ifndef USE_MEM_CACHE
+#ifdef TARGET_DESKTOP
+#define USE_MEM_CACHE 1
+#else
+#define USE_MEM_CACHE 0
+#endif
+#endif
+
+/** Number of pages in the cache */
+#ifndef MEM_CACHE_PAGES
+#define MEM_CACHE_PAGES 4
+#endif
+
+/** Number of bytes in a page; must be a power of 2 */
+#ifndef MEM_PAGE_SIZE
+#define MEM_PAGE_SIZE 64
+#endif
+
+
 /***************************************************************
  * Types
  **************************************************************/
@@ -56,6 +86,42 @@ typedef enum PmMemSpace_e
     MEMSPACE_OTHER3
 } PmMemSpace_t, *pPmMemSpace_t;
 
+#if USE_MEM_CACHE
+/** Page of the memspace cache */
+typedef struct PmMemPage_s
+{
+    /** Address of the page's first byte; C_NULL if the page is empty */
+    uint8_t const *mp_addr;
+
+    /** Memspace of the page */
+    PmMemSpace_t mp_memspace;
+
+    /** The page's bytes */
+    uint8_t mp_bytes[MEM_PAGE_SIZE];
+} PmMemPage_t,
+ *pPmMemPage_t;
+
+/** Page cache of the memspaces that are read with plat_memRead() */
+typedef struct PmMemCache_s
+{
+    /** The pages */
+    PmMemPage_t mc_pages[MEM_CACHE_PAGES];
+
+    /** Index of the page found last, which is looked at first */
+    uint8_t mc_last;
+
+    /** Index of the page to fill on the next miss */
+    uint8_t mc_next;
+
+    /** Number of times a page was found in the cache */
+    uint32_t mc_hits;
+
+    /** Number of times a page was read with plat_memRead() */
+    uint32_t mc_misses;
+} PmMemCache_t,
+ *pPmMemCache_t;
+#endif /* USE_MEM_CACHE */
+
 
 /***************************************************************
  * Prototypes
@@ -72,7 +138,36 @@ typedef enum PmMemSpace_e
  * @return  byte from memory.
  *          paddr - points to the next byte
  */
+#if USE_MEM_CACHE
+#define mem_getByte(memspace, paddr) \
+    (((memspace) < MEMSPACE_EEPROM) \
+     ? plat_memGetByte((memspace), (paddr)) \
+     : mem_getCachedByte((memspace), (paddr)))
+#else
 #define mem_getByte(memspace, paddr) plat_memGetByte((memspace), (paddr))
+#endif /* USE_MEM_CACHE */
+
+#if USE_MEM_CACHE
+/**
+ * Returns the byte at the given address in a memspace that is cached,
+ * reading its page with plat_memRead() if the page is not in the cache.
+ * Use mem_getByte(), which calls this for the cached memspaces.
+ *
+ * @param   memspace memory space, MEMSPACE_EEPROM or after
+ * @param   paddr ptr to address
+ * @return  byte from memory.
+ *          paddr - points to the next byte
+ */
+uint8_t mem_getCachedByte(PmMemSpace_t memspace, uint8_t const **paddr);
+
+/**
+ * Drops the current VM's cached pages of the memspace, so its bytes are
+ * read again.  Call it when what the memspace holds has changed.
+ *
+ * @param   memspace memory space, MEMSPACE_EEPROM or after
+ */
+void mem_flushCache(PmMemSpace_t memspace);
+#endif /* USE_MEM_CACHE */
 
 /**
  * Returns the 2-byte word at the given address in memspace.
@@ -27,6 +27,7 @@
  *
  * Log:
  *
+ * 2008/02/04   #110: Add module cache, mod_lookup() and mod_forget()
  * 2002/05/04   First.
  */
 
@@ -49,11 +50,21 @@
  */
 PmReturn_t mod_new(pPmObj_t pco, pPmObj_t *pmod);
 
+/**
+ * Gets the module of the given name if it was already imported.
+ * @param   pstr String obj containing name of module.
+ * @param   return parameter; ptr to the cached module
+ * @return  PM_RET_OK if the module was imported before,
+ *          PM_RET_NO if it has not been (or there is no such image)
+ */
+PmReturn_t mod_lookup(pPmObj_t pstr, pPmObj_t *pmod);
+
 /**
  * Imports a module of the given name.
- * Searches for an image with a matching name.
- * A code obj is created for the code image.
- * A module obj is created for the code obj.
+ * Searches the image index for an image with a matching name.
+ * If the module was already imported, that same module obj is returned.
+ * Otherwise, a code obj is created for the code image,
+ * a module obj is created for the code obj and the module is cached.
  *
  * @param   pstr String obj containing name of code obj to load.
  * @param   return parameter; ptr to imported module
@@ -61,4 +72,13 @@ PmReturn_t mod_new(pPmObj_t pco, pPmObj_t *pmod);
  */
 PmReturn_t mod_import(pPmObj_t pstr, pPmObj_t *pmod);
 
+/**
+ * Drops the module from the cache, so the next import of its name
+ * makes and runs a new one.  Used when the module's body raised,
+ * since the module is cached before its body runs.
+ *
+ * @param   pmod Ptr to the module obj
+ */
+void mod_forget(pPmObj_t pmod);
+
 #endif /* __MODULE_H__ */
@@ -26,6 +26,10 @@
  * Log
  * ---
  *
+ * 2008/03/09   #136: Add plat_getBytes()
+ * 2008/03/07   #135: Add plat_putBytes() and plat_flush()
+ * 2008/03/03   #133: Add plat_pollIo()
+ * 2008/02/16   #126: Add plat_idle()
  * 2007/04/29   #114: Create platform file for ARM
  */
 
@@ -127,6 +131,24 @@ plat_getByte(uint8_t *b)
 }
 
 
+/* Gets all len bytes, one at a time from stdin */
+PmReturn_t
+plat_getBytes(uint8_t *buf, uint16_t len, uint16_t *r_len)
+{
+    PmReturn_t retval = PM_RET_OK;
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        retval = plat_getByte(&buf[i]);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    *r_len = len;
+    return retval;
+}
+
+
 /* ARM7 target shall use stdio for I/O routines */
 PmReturn_t
 plat_putByte(uint8_t b)
@@ -146,6 +168,31 @@ plat_putByte(uint8_t b)
 }
 
 
+/* ARM7 target shall use stdio for I/O routines */
+PmReturn_t
+plat_putBytes(uint8_t const *buf, uint16_t len)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    if (fwrite(buf, 1, len, stdout) != len)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    fflush(stdout);
+
+    return retval;
+}
+
+
+/* Each put flushes stdout, so nothing is held back */
+PmReturn_t
+plat_flush(void)
+{
+    return PM_RET_OK;
+}
+
+
 PmReturn_t
 plat_getMsTicks(uint32_t *r_ticks)
 {
@@ -156,6 +203,21 @@ plat_getMsTicks(uint32_t *r_ticks)
 }
 
 
+/* Stop the processor clock; the next interrupt starts it again */
+void
+plat_idle(void)
+{
+    AT91C_BASE_PMC->PMC_SCDR = AT91C_PMC_PCK;
+}
+
+
+/* Threads don't wait for I/O here, so none is made ready */
+void
+plat_pollIo(void)
+{
+}
+
+
 void 
 plat_reportError(PmReturn_t result)
 {
@@ -23,6 +23,17 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: Add plat_memRead(), and plat_openMemspace() for
+ *              the desktop
+ * 2008/03/19   #141: Add plat_closeIo() for the desktop
+ * 2008/03/17   #140: Add plat_readFile() and plat_writeFile() for the
+ *              desktop
+ * 2008/03/15   #139: Add plat_unmapFile() for the desktop
+ * 2008/03/13   #138: Add plat_mapFile() for the desktop
+ * 2008/03/09   #136: Add plat_getBytes() and, for the desktop, plat_inReady()
+ * 2008/03/07   #135: Add plat_putBytes() and plat_flush()
+ * 2008/03/03   #133: Add plat_pollIo() and, for the desktop, plat_waitFd()
+ * 2008/02/16   #126: Add plat_idle()
  * 2007/01/10   #75: Added time tick service for desktop (POSIX) and AVR.
  * 2006/12/26   #65: Create plat module with put and get routines
  */
@@ -57,6 +68,21 @@ PmReturn_t plat_init(void);
  */
 uint8_t plat_memGetByte(PmMemSpace_t memspace, uint8_t const **paddr);
 
+/**
+ * Reads len bytes from the address in memspace, in as few transactions
+ * as the memory allows.  Bytes that can't be read are 0.
+ *
+ * PORT:    needed when USE_MEM_CACHE is nonzero; the cache reads pages
+ *          of the memspaces from MEMSPACE_EEPROM on with it.
+ *
+ * @param   memspace memory space/type
+ * @param   paddr address of the first byte
+ * @param   pbuf buffer in RAM for the bytes
+ * @param   len number of bytes to read
+ */
+void plat_memRead(PmMemSpace_t memspace, uint8_t const *paddr,
+                  uint8_t *pbuf, uint16_t len);
+
 /**
  * Receives one byte from the default connection,
  * usually UART0 on a target device or stdio on the desktop
@@ -64,6 +90,18 @@ uint8_t plat_memGetByte(PmMemSpace_t memspace, uint8_t const **paddr);
 PmReturn_t plat_getByte(uint8_t *b);
 
 
+/**
+ * Receives up to len bytes from the default connection into buf.
+ * Waits for the first byte, then gets as many as have arrived; some
+ * platforms always get all len.
+ *
+ * @param buf   Buffer for the bytes
+ * @param len   Most bytes to get, at least 1
+ * @param r_len Return by reference; the number of bytes got
+ */
+PmReturn_t plat_getBytes(uint8_t *buf, uint16_t len, uint16_t *r_len);
+
+
 /**
  * Sends one byte out on the default connection,
  * usually UART0 on a target device or stdio on the desktop
@@ -71,12 +109,144 @@ PmReturn_t plat_getByte(uint8_t *b);
 PmReturn_t plat_putByte(uint8_t b);
 
 
+/**
+ * Sends the given bytes out on the default connection.
+ * Output may be buffered until a newline or plat_flush().
+ *
+ * @param buf   Bytes to send
+ * @param len   Number of bytes to send
+ */
+PmReturn_t plat_putBytes(uint8_t const *buf, uint16_t len);
+
+
+/**
+ * Sends any output that is still buffered.  Called when the VM idles,
+ * before it waits for input and when the root module ends.
+ */
+PmReturn_t plat_flush(void);
+
+
 /**
  * Gets the number of timer ticks that have passed since system start.
  */
 PmReturn_t plat_getMsTicks(uint32_t *r_ticks);
 
 
+/**
+ * Waits, using little power if the platform can, until the next interrupt.
+ * Called by the interpreter while no thread is ready to run.
+ */
+void plat_idle(void);
+
+
+/**
+ * Makes ready the threads whose I/O waits are over.
+ * Called by the interpreter at each reschedule.
+ * Platforms on which threads don't wait for I/O do nothing.
+ */
+void plat_pollIo(void);
+
+
+#ifdef TARGET_DESKTOP
+/**
+ * Sees if the descriptor can be read (or written) without blocking.
+ * If not, blocks the running thread until it can be and returns
+ * PM_RET_NO; the native then returns and its caller tries again
+ * once the thread runs.
+ *
+ * @param fd            Descriptor; stdin, a pipe, socket or the like
+ * @param forWrite      Nonzero to wait until it can be written
+ * @return PM_RET_OK if ready, PM_RET_NO if the thread waits
+ */
+PmReturn_t plat_waitFd(int fd, uint8_t forWrite);
+
+
+/**
+ * Gives the number of bytes read from stdin that are buffered and not
+ * got yet; plat_getBytes() gets that many without reading stdin.
+ *
+ * @return Number of buffered bytes, 0 if it has to read stdin
+ */
+uint16_t plat_inReady(void);
+
+
+/**
+ * Drops the I/O waits of the VM's threads: closes the descriptors they
+ * wait on and the VM's epoll set.  For a VM whose threads are about to
+ * be discarded, as by pm_reset().
+ */
+void plat_closeIo(void);
+
+
+/**
+ * Maps the whole file into memory to be read.  It stays mapped until
+ * plat_unmapFile().
+ *
+ * @param fn            Name of the file
+ * @param r_paddr       Return by reference; address of the file's bytes
+ * @param r_len         Return by reference; length of the file
+ * @return PM_RET_EX_IO if the file can't be opened or mapped or is empty
+ */
+PmReturn_t plat_mapFile(uint8_t const *fn, uint8_t const **r_paddr,
+                        uint32_t *r_len);
+
+
+/**
+ * Unmaps a file mapped by plat_mapFile().
+ *
+ * @param paddr         Address of the file's bytes
+ * @param len           Length of the file
+ */
+void plat_unmapFile(uint8_t const *paddr, uint32_t len);
+
+
+/**
+ * Reads bytes from the file.
+ *
+ * @param fn            Name of the file
+ * @param offset        Offset in the file of the first byte to read
+ * @param pbuf          Buffer for the bytes
+ * @param len           Number of bytes to read
+ * @return PM_RET_EX_IO unless all len bytes were read
+ */
+PmReturn_t plat_readFile(uint8_t const *fn, uint32_t offset,
+                         uint8_t *pbuf, uint32_t len);
+
+
+/**
+ * Writes bytes to the file.  Writing at offset 0 makes the file anew.
+ *
+ * @param fn            Name of the file
+ * @param offset        Offset in the file of the first byte to write
+ * @param pbuf          Bytes to write
+ * @param len           Number of bytes to write
+ * @return PM_RET_EX_IO unless all len bytes were written
+ */
+PmReturn_t plat_writeFile(uint8_t const *fn, uint32_t offset,
+                          uint8_t const *pbuf, uint32_t len);
+
+
+/**
+ * Makes a file the contents of a memspace from MEMSPACE_EEPROM on,
+ * to try code on an external memory that is read a transaction at a
+ * time: each plat_memGetByte() or plat_memRead() of the memspace is a
+ * read of the file.  Images in it are indexed with img_findInMem().
+ * The memspace is the same for all VMs.  Opening it drops the pages of
+ * it in the current VM's cache; other VMs that read it before must call
+ * mem_flushCache(), or they keep the bytes of the file it had before.
+ *
+ * @param memspace      Memspace, MEMSPACE_EEPROM or after
+ * @param fn            Name of the file
+ * @param r_paddr       Return by reference; address of the file's first
+ *                      byte in the memspace
+ * @return PM_RET_EX_VAL if the memspace can't be simulated,
+ *         PM_RET_EX_IO if the file can't be opened
+ */
+PmReturn_t plat_openMemspace(PmMemSpace_t memspace, uint8_t const *fn,
+                             uint8_t const **r_paddr);
+#endif /* TARGET_DESKTOP */
+
+
 /**
  * Reports an exception or other error that caused the thread to quit
  */
@@ -28,6 +28,7 @@
  * Log
  * ---
  *
+ * 2008/02/12   #124: Fix index bound of strings, read chars of views
  * 2006/11/29   #59: Improve bytecode UNPACK_SEQUENCE
  */
 
@@ -149,14 +150,14 @@ seq_getSubscript(pPmObj_t pobj, int16_t index, pPmObj_t *r_pobj)
             }
 
             /* Raise IndexError if index is out of bounds */
-            if ((index < 0) || (index > ((pPmString_t)pobj)->length))
+            if ((index < 0) || (index >= ((pPmString_t)pobj)->length))
             {
                 PM_RAISE(retval, PM_RET_EX_INDX);
                 break;
             }
 
             /* Get the character from the string */
-            c = ((pPmString_t)pobj)->val[index];
+            c = STRING_GET_CHARS(pobj)[index];
 
             /* Create a new string from the character */
             retval = string_newFromChar(c, r_pobj);
@@ -35,6 +35,7 @@
  *
  * Log:
  *
+ * 2008/02/10   #123: sli_memset() wraps memset(), not memcpy()
  * 2002/05/16   First.
  */
 
@@ -85,7 +86,7 @@
 #include <string.h>
 #define sli_memcmp(p, q, n)     memcmp((p), (q), (n))
 #define sli_memcpy(to, from, n) memcpy((to), (from), (n))
-#define sli_memset(dest, from, n) memcpy((dest), (from), (n))
+#define sli_memset(dest, val, n) memset((dest), (val), (n))
 #define sli_strcmp(s1, s2)      strcmp((s1),(s2))
 #define sli_strcpy(s1, s2)      strcpy((s1),(s2))
 #define sli_strlen(s)           strlen(s)
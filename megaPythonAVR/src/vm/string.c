@@ -28,6 +28,14 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: The same string obj compares the same at once
+ * 2008/03/11   #137: string_alloc() refuses a length that wraps the size
+ * 2008/03/07   #135: Print runs of chars with one plat_putBytes()
+ * 2008/02/22   #129: The string cache is kept per VM
+ * 2008/02/12   #124: Add slice views and the single-char strings
+ * 2008/02/10   #123: Add string_concat() and string_join(),
+ *              add string_cacheSweep()
+ * 2008/02/04   #110: Add string_hash() for the image index
  * 2007/04/21   #46: Finalize design of string objects
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
  * 2007/01/10   #75: Printing support (P.Adelt)
@@ -51,8 +59,8 @@
  **************************************************************/
 
 #if USE_STRING_CACHE
-/** String obj cachche: a list of all string objects. */
-static pPmString_t pstrcache = C_NULL;
+/** String obj cache of the current VM */
+#define pstrcache (gVmGlobal.pstrcache)
 #endif /* USE_STRING_CACHE */
 
 
@@ -102,6 +110,9 @@ string_create(PmMemSpace_t memspace,
     /* Fill the string obj */
     OBJ_SET_TYPE(pstr, OBJ_TYPE_STR);
     pstr->length = len;
+#if USE_STRING_VIEWS
+    pstr->parent = C_NULL;
+#endif /* USE_STRING_VIEWS */
 
     /* Copy C-string into String obj */
     pdst = (uint8_t *)&(pstr->val);
@@ -141,10 +152,62 @@ string_create(PmMemSpace_t memspace,
 }
 
 
+/*
+ * The string is not put in the string cache; it is freed by the GC
+ * like any other obj once it is no longer reachable.
+ */
+PmReturn_t
+string_alloc(uint16_t len, pPmString_t *r_pstr)
+{
+    PmReturn_t retval;
+    pPmString_t pstr;
+    uint8_t *pchunk;
+
+    /* Raise MemoryError if the chunk's size would wrap around */
+    if (len > (uint16_t)(0xFFFF - sizeof(PmString_t)))
+    {
+        PM_RAISE(retval, PM_RET_EX_MEM);
+        return retval;
+    }
+
+    retval = heap_getChunk(sizeof(PmString_t) + len, &pchunk);
+    PM_RETURN_IF_ERROR(retval);
+    pstr = (pPmString_t)pchunk;
+
+    OBJ_SET_TYPE(pstr, OBJ_TYPE_STR);
+    pstr->length = len;
+#if USE_STRING_CACHE
+    pstr->next = C_NULL;
+#endif /* USE_STRING_CACHE */
+#if USE_STRING_VIEWS
+    pstr->parent = C_NULL;
+#endif /* USE_STRING_VIEWS */
+    pstr->val[len] = '\0';
+
+    *r_pstr = pstr;
+    return PM_RET_OK;
+}
+
+
 PmReturn_t
 string_newFromChar(uint8_t const c, pPmObj_t *r_pstring)
 {
     PmReturn_t retval;
+#if USE_STRING_CHARS
+    pPmString_t pstr;
+
+    /* Make the char's string the first time it is needed */
+    if (gVmGlobal.pcharstrs[c] == C_NULL)
+    {
+        retval = string_alloc(1, &pstr);
+        PM_RETURN_IF_ERROR(retval);
+        pstr->val[0] = c;
+        gVmGlobal.pcharstrs[c] = pstr;
+    }
+
+    *r_pstring = (pPmObj_t)gVmGlobal.pcharstrs[c];
+    return PM_RET_OK;
+#else
     uint8_t cstr[2];
     uint8_t const *pcstr;
 
@@ -161,12 +224,19 @@ string_newFromChar(uint8_t const c, pPmObj_t *r_pstring)
     }
 
     return retval;
+#endif /* USE_STRING_CHARS */
 }
 
 
 int8_t
 string_compare(pPmString_t pstr1, pPmString_t pstr2)
 {
+    /* Names shared through the cache or an image pool are one obj */
+    if (pstr1 == pstr2)
+    {
+        return C_SAME;
+    }
+
     /* Return false if lengths are not equal */
     if (pstr1->length != pstr2->length)
     {
@@ -174,19 +244,253 @@ string_compare(pPmString_t pstr1, pPmString_t pstr2)
     }
 
     /* Compare the strings' contents */
-    return sli_strncmp((const unsigned char *)&(pstr1->val),
-                       (const unsigned char *)&(pstr2->val),
+    return sli_strncmp((const unsigned char *)STRING_GET_CHARS(pstr1),
+                       (const unsigned char *)STRING_GET_CHARS(pstr2),
                        pstr1->length) == 0 ? C_SAME : C_DIFFER;
 }
 
 
+PmReturn_t
+string_concat(pPmString_t pstr1, pPmString_t pstr2, pPmObj_t *r_pstring)
+{
+    PmReturn_t retval;
+    pPmString_t pstr;
+    uint16_t len;
+
+    /* Raise MemoryError if the length does not fit in a string */
+    len = pstr1->length + pstr2->length;
+    if (len < pstr1->length)
+    {
+        PM_RAISE(retval, PM_RET_EX_MEM);
+        return retval;
+    }
+
+    retval = string_alloc(len, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+
+    sli_memcpy(pstr->val, STRING_GET_CHARS(pstr1), pstr1->length);
+    sli_memcpy(&pstr->val[pstr1->length], STRING_GET_CHARS(pstr2),
+               pstr2->length);
+
+    *r_pstring = (pPmObj_t)pstr;
+    return PM_RET_OK;
+}
+
+
+/*
+ * The pieces are walked twice: once to check them and add up the length,
+ * then again to copy them into the one String obj that is allocated.
+ * The sequence itself is what collects the pieces while they are made,
+ * so assembling a string of n pieces costs n appends and one join.
+ */
+PmReturn_t
+string_join(pPmObj_t psep, pPmObj_t pseq, pPmObj_t *r_pstring)
+{
+    PmReturn_t retval;
+    pPmString_t pstr;
+    pPmString_t psepstr = (pPmString_t)psep;
+    pPmObj_t pitem;
+    uint8_t *pdst;
+    uint16_t len = 0;
+    uint16_t piecelen;
+    int16_t n;
+    int16_t i;
+
+    /* Raise TypeError if the separator is not a string */
+    if (OBJ_GET_TYPE(psep) != OBJ_TYPE_STR)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* Raise TypeError if the pieces are not in a tuple or list */
+    if ((OBJ_GET_TYPE(pseq) != OBJ_TYPE_TUP)
+        && (OBJ_GET_TYPE(pseq) != OBJ_TYPE_LST))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+    retval = seq_getLength(pseq, &n);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Add up the length, raise TypeError if a piece is not a string */
+    for (i = 0; i < n; i++)
+    {
+        retval = seq_getSubscript(pseq, i, &pitem);
+        PM_RETURN_IF_ERROR(retval);
+        if (OBJ_GET_TYPE(pitem) != OBJ_TYPE_STR)
+        {
+            PM_RAISE(retval, PM_RET_EX_TYPE);
+            return retval;
+        }
+
+        piecelen = ((pPmString_t)pitem)->length;
+        if (i > 0)
+        {
+            piecelen += psepstr->length;
+        }
+
+        /* Raise MemoryError if the length does not fit in a string */
+        if ((uint16_t)(len + piecelen) < len)
+        {
+            PM_RAISE(retval, PM_RET_EX_MEM);
+            return retval;
+        }
+        len += piecelen;
+    }
+
+    retval = string_alloc(len, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Copy the pieces with the separator between them */
+    pdst = pstr->val;
+    for (i = 0; i < n; i++)
+    {
+        if (i > 0)
+        {
+            sli_memcpy(pdst, STRING_GET_CHARS(psepstr), psepstr->length);
+            pdst += psepstr->length;
+        }
+        retval = seq_getSubscript(pseq, i, &pitem);
+        PM_RETURN_IF_ERROR(retval);
+        sli_memcpy(pdst, STRING_GET_CHARS(pitem),
+                   ((pPmString_t)pitem)->length);
+        pdst += ((pPmString_t)pitem)->length;
+    }
+
+    *r_pstring = (pPmObj_t)pstr;
+    return PM_RET_OK;
+}
+
+
+/*
+ * Indices are adjusted like CPython's PySlice_GetIndicesEx() does.
+ * A view is made only when it is no bigger than a copy would be,
+ * since it keeps the whole parent alive.
+ */
+PmReturn_t
+string_getSlice(pPmObj_t pstr, int16_t start, int16_t end, int16_t step,
+                pPmObj_t *r_pstring)
+{
+    PmReturn_t retval = PM_RET_OK;
+    pPmString_t pnew;
+    uint8_t *pchars;
+    int16_t length = ((pPmString_t)pstr)->length;
+    int16_t n;
+    int16_t i;
+#if USE_STRING_VIEWS
+    pPmStringView_t pview;
+#endif /* USE_STRING_VIEWS */
+
+    C_ASSERT(OBJ_GET_TYPE(pstr) == OBJ_TYPE_STR);
+
+    /* Raise ValueError if the step is zero */
+    if (step == 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    /* Count negative indices from the end, then clip them to the string */
+    if (start < 0)
+    {
+        start += length;
+    }
+    if (end < 0)
+    {
+        end += length;
+    }
+    if (step > 0)
+    {
+        start = (start < 0) ? 0 : ((start > length) ? length : start);
+        end = (end < 0) ? 0 : ((end > length) ? length : end);
+        n = (end > start) ? ((end - start - 1) / step + 1) : 0;
+    }
+    else
+    {
+        start = (start < 0) ? -1 : ((start >= length) ? length - 1 : start);
+        end = (end < 0) ? -1 : ((end >= length) ? length - 1 : end);
+        n = (start > end) ? ((start - end - 1) / -step + 1) : 0;
+    }
+
+    /* The whole string is itself, since strings are immutable */
+    if ((n == length) && (step == 1))
+    {
+        *r_pstring = pstr;
+        return retval;
+    }
+
+    /* A single char is the char's string */
+    if (n == 1)
+    {
+        return string_newFromChar(STRING_GET_CHARS(pstr)[start], r_pstring);
+    }
+
+#if USE_STRING_VIEWS
+    /* Consecutive chars become a view of the (parent's) chars */
+    if ((step == 1) && (sizeof(PmStringView_t) < sizeof(PmString_t) + n))
+    {
+        retval = heap_getChunk(sizeof(PmStringView_t), (uint8_t **)&pview);
+        PM_RETURN_IF_ERROR(retval);
+        OBJ_SET_TYPE(pview, OBJ_TYPE_STR);
+        pview->length = n;
+#if USE_STRING_CACHE
+        pview->next = C_NULL;
+#endif /* USE_STRING_CACHE */
+        if (((pPmString_t)pstr)->parent == C_NULL)
+        {
+            pview->parent = (pPmString_t)pstr;
+            pview->offset = start;
+        }
+        else
+        {
+            pview->parent = ((pPmString_t)pstr)->parent;
+            pview->offset = ((pPmStringView_t)pstr)->offset + start;
+        }
+        *r_pstring = (pPmObj_t)pview;
+        return retval;
+    }
+#endif /* USE_STRING_VIEWS */
+
+    /* Otherwise copy the chars */
+    retval = string_alloc(n, &pnew);
+    PM_RETURN_IF_ERROR(retval);
+    pchars = STRING_GET_CHARS(pstr);
+    for (i = 0; i < n; i++)
+    {
+        pnew->val[i] = pchars[start + i * step];
+    }
+
+    *r_pstring = (pPmObj_t)pnew;
+    return retval;
+}
+
+
+uint16_t
+string_hash(pPmString_t pstr)
+{
+    uint8_t *pchars = STRING_GET_CHARS(pstr);
+    uint16_t hash = 0;
+    uint16_t i;
+
+    /* Shift-add hash; cheap on 8-bit targets and spreads short names well */
+    for (i = 0; i < pstr->length; i++)
+    {
+        hash = (hash << 5) + hash + pchars[i];
+    }
+    return hash;
+}
+
+
 #ifdef HAVE_PRINT
 PmReturn_t
 string_print(pPmObj_t pstr, uint8_t marshall)
 {
     uint16_t i;
+    uint16_t start;
     uint8_t ch;
-    uint8_t nibble;
+    uint8_t const *pchars;
+    uint8_t esc[4];
     PmReturn_t retval = PM_RET_OK;
 
     C_ASSERT(pstr != C_NULL);
@@ -204,39 +508,41 @@ string_print(pPmObj_t pstr, uint8_t marshall)
         PM_RETURN_IF_ERROR(retval);
     }
 
+    /* Output the chars between escapes a run at a time */
+    pchars = STRING_GET_CHARS(pstr);
+    start = 0;
     for (i = 0; i < (((pPmString_t)pstr)->length); i++)
     {
-        ch = ((pPmString_t)pstr)->val[i];
+        ch = pchars[i];
         if (ch == '\\')
         {
-            /* Output an additional backslash to escape it. */
+            /* Output an additional backslash to escape it */
+            retval = plat_putBytes(&pchars[start], i - start);
+            PM_RETURN_IF_ERROR(retval);
             retval = plat_putByte('\\');
             PM_RETURN_IF_ERROR(retval);
+
+            /* The backslash itself starts the next run */
+            start = i;
         }
 
         /* If the marshalled char is not printable, print its hex escape code */
-        if (marshall && (ch < (uint8_t)32 || ch >= (uint8_t)128))
+        else if (marshall && (ch < (uint8_t)32 || ch >= (uint8_t)128))
         {
-            plat_putByte('\\');
-            plat_putByte('x');
-
-            nibble = (ch >> (uint8_t)4) + '0';
-            if (nibble > '9')
-                nibble += ('a' - '0' - (uint8_t)10);
-            plat_putByte(nibble);
-
-            nibble = (ch & (uint8_t)0x0F) + '0';
-            if (nibble > '9')
-                nibble += ('a' - '0' - (uint8_t)10);
-            plat_putByte(nibble);
-        }
-        else
-        {
-            /* Simply output character */
-            retval = plat_putByte(ch);
+            retval = plat_putBytes(&pchars[start], i - start);
             PM_RETURN_IF_ERROR(retval);
+
+            esc[0] = '\\';
+            esc[1] = 'x';
+            int_hexByte(ch, &esc[2]);
+            retval = plat_putBytes(esc, 4);
+            PM_RETURN_IF_ERROR(retval);
+            start = i + 1;
         }
     }
+    retval = plat_putBytes(&pchars[start], i - start);
+    PM_RETURN_IF_ERROR(retval);
+
     if (marshall)
     {
         retval = plat_putByte('\'');
@@ -255,3 +561,24 @@ string_cacheInit(void)
 #endif
     return PM_RET_OK;
 }
+
+
+void
+string_cacheSweep(void)
+{
+#if USE_STRING_CACHE
+    pPmString_t volatile *ppstr = &pstrcache;
+
+    while (*ppstr != C_NULL)
+    {
+        if (heap_gcIsMarked((pPmObj_t)*ppstr))
+        {
+            ppstr = &(*ppstr)->next;
+        }
+        else
+        {
+            *ppstr = (*ppstr)->next;
+        }
+    }
+#endif /* USE_STRING_CACHE */
+}
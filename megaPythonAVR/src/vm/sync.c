@@ -0,0 +1,423 @@
+/*
+ * PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+ * Copyright 2007 David Greenberg
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#undef __FILE_ID__
+#define __FILE_ID__ 0x19
+
+/**
+ * Sync Object Type
+ *
+ * Locks, semaphores, conditions and channels for threads.
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/24   #130: Add channels
+ * 2008/02/18   #127: First
+ */
+
+/***************************************************************
+ * Includes
+ **************************************************************/
+
+#include "pm.h"
+
+
+/***************************************************************
+ * Functions
+ **************************************************************/
+
+PmReturn_t
+sync_new(uint8_t kind, int16_t count, pPmSync_t plock, pPmObj_t *r_pobj)
+{
+    PmReturn_t retval = PM_RET_OK;
+    pPmSync_t psync = C_NULL;
+
+    /* Allocate a sync obj */
+    retval = heap_getChunk(sizeof(PmSync_t), (uint8_t **)r_pobj);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Set sync type, empty the wait queue */
+    psync = (pPmSync_t)*r_pobj;
+    OBJ_SET_TYPE(psync, OBJ_TYPE_SYN);
+    psync->kind = kind;
+    psync->count = count;
+    psync->owner = C_NULL;
+    psync->waitHead = C_NULL;
+    psync->plock = plock;
+
+    return retval;
+}
+
+
+/*
+ * Blocks a thread in the wait queue of the sync obj,
+ * behind the waiting threads of the same or a higher priority.
+ */
+static void
+sync_enqueue(pPmSync_t psync, pPmThread_t pthread)
+{
+    pPmThread_t *ppthread = &psync->waitHead;
+
+    while ((*ppthread != C_NULL)
+           && ((*ppthread)->priority >= pthread->priority))
+    {
+        ppthread = &(*ppthread)->next;
+    }
+    pthread->next = *ppthread;
+    *ppthread = pthread;
+
+    pthread->waitSync = psync;
+    pthread->state = THREAD_STATE_BLOCKED;
+}
+
+
+/* Removes a thread from the wait queue it is in */
+static void
+sync_dequeue(pPmThread_t pthread)
+{
+    pPmThread_t *ppthread = &pthread->waitSync->waitHead;
+
+    while (*ppthread != pthread)
+    {
+        ppthread = &(*ppthread)->next;
+    }
+    *ppthread = pthread->next;
+
+    pthread->next = C_NULL;
+    pthread->waitSync = C_NULL;
+}
+
+
+/* Blocks the current thread on the sync obj, for at most ms if not negative */
+static void
+sync_block(pPmSync_t psync, int32_t ms)
+{
+    pPmThread_t pthread = gVmGlobal.pthread;
+
+    sync_enqueue(psync, pthread);
+    if (ms > 0)
+    {
+        thread_sleep(pthread, (uint32_t)ms);
+    }
+    VM_SET_RESCHEDULE(1);
+}
+
+
+/*
+ * Releases a lock or semaphore.  The first waiter gets it at once,
+ * so the releasing thread can't take it back before the waiter runs.
+ */
+static void
+sync_signal(pPmSync_t psync)
+{
+    pPmThread_t pthread = psync->waitHead;
+
+    if (pthread == C_NULL)
+    {
+        psync->count++;
+        psync->owner = C_NULL;
+        return;
+    }
+
+    sync_dequeue(pthread);
+    thread_cancelSleep(pthread);
+    psync->owner = pthread;
+    thread_makeReady(pthread);
+}
+
+
+/* Gives the lock to a thread that was waiting on its condition */
+static void
+sync_relock(pPmSync_t plock, pPmThread_t pthread)
+{
+    if (plock->count > 0)
+    {
+        plock->count--;
+        plock->owner = pthread;
+        thread_makeReady(pthread);
+    }
+    else
+    {
+        sync_enqueue(plock, pthread);
+    }
+}
+
+
+/* Raises ValueError if the current thread doesn't hold the lock */
+static PmReturn_t
+sync_checkOwner(pPmSync_t plock)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    if ((plock->count != 0) || (plock->owner != gVmGlobal.pthread))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+    }
+    return retval;
+}
+
+
+PmReturn_t
+sync_acquire(pPmSync_t psync, int32_t ms)
+{
+    C_ASSERT(psync->kind <= SYNC_KIND_SEM);
+
+    /* Uncontended */
+    if (psync->count > 0)
+    {
+        psync->count--;
+        psync->owner = gVmGlobal.pthread;
+        return PM_RET_OK;
+    }
+
+    if (ms == 0)
+    {
+        return PM_RET_NO;
+    }
+
+    sync_block(psync, ms);
+    return PM_RET_OK;
+}
+
+
+PmReturn_t
+sync_release(pPmSync_t psync)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    C_ASSERT(psync->kind <= SYNC_KIND_SEM);
+
+    if (psync->kind == SYNC_KIND_LOCK)
+    {
+        retval = sync_checkOwner(psync);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Raise ValueError if the semaphore count would overflow */
+    else if (psync->count == 0x7FFF)
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    sync_signal(psync);
+    return retval;
+}
+
+
+PmReturn_t
+sync_wait(pPmSync_t pcond, int32_t ms)
+{
+    PmReturn_t retval;
+
+    C_ASSERT(pcond->kind == SYNC_KIND_COND);
+
+    retval = sync_checkOwner(pcond->plock);
+    PM_RETURN_IF_ERROR(retval);
+
+    sync_signal(pcond->plock);
+    sync_block(pcond, ms);
+    return retval;
+}
+
+
+PmReturn_t
+sync_notify(pPmSync_t pcond, uint8_t all)
+{
+    PmReturn_t retval;
+    pPmThread_t pthread;
+
+    C_ASSERT(pcond->kind == SYNC_KIND_COND);
+
+    retval = sync_checkOwner(pcond->plock);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Move the waiters (or the first) to the lock's wait queue */
+    while ((pthread = pcond->waitHead) != C_NULL)
+    {
+        sync_dequeue(pthread);
+        thread_cancelSleep(pthread);
+        sync_relock(pcond->plock, pthread);
+        if (!all)
+        {
+            break;
+        }
+    }
+    return retval;
+}
+
+
+PmReturn_t
+sync_newChannel(uint8_t size, pPmObj_t *r_pobj)
+{
+    PmReturn_t retval;
+    pPmChannel_t pchan;
+    uint16_t chunksize = sizeof(PmChannel_t);
+    uint8_t i;
+
+    /* The ring is allocated with the channel, never again */
+    if (size > 1)
+    {
+        chunksize += (size - 1) * sizeof(pPmObj_t);
+    }
+    retval = heap_getChunk(chunksize, (uint8_t **)r_pobj);
+    PM_RETURN_IF_ERROR(retval);
+
+    pchan = (pPmChannel_t)*r_pobj;
+    OBJ_SET_TYPE(pchan, OBJ_TYPE_SYN);
+    pchan->ch_sync.kind = SYNC_KIND_CHAN;
+    pchan->ch_sync.count = 0;
+    pchan->ch_sync.owner = C_NULL;
+    pchan->ch_sync.waitHead = C_NULL;
+    pchan->ch_sync.plock = C_NULL;
+    pchan->ch_size = size;
+    pchan->ch_head = 0;
+    pchan->ch_sending = C_FALSE;
+    for (i = 0; i < size; i++)
+    {
+        pchan->ch_ring[i] = C_NULL;
+    }
+
+    return retval;
+}
+
+
+/* Puts an obj at the tail of the channel's ring, which has room for it */
+static void
+sync_putRing(pPmChannel_t pchan, pPmObj_t pobj)
+{
+    uint16_t indx = pchan->ch_head + pchan->ch_sync.count;
+
+    if (indx >= pchan->ch_size)
+    {
+        indx -= pchan->ch_size;
+    }
+    pchan->ch_ring[indx] = pobj;
+    pchan->ch_sync.count++;
+}
+
+
+PmReturn_t
+sync_send(pPmChannel_t pchan, pPmObj_t pobj)
+{
+    pPmThread_t pthread = pchan->ch_sync.waitHead;
+
+    C_ASSERT(pchan->ch_sync.kind == SYNC_KIND_CHAN);
+
+    /* A waiting receiver gets the obj as the result of its recv() */
+    if ((pthread != C_NULL) && !pchan->ch_sending)
+    {
+        sync_dequeue(pthread);
+        pthread->pframe->fo_sp[-1] = pobj;
+        thread_makeReady(pthread);
+        return PM_RET_OK;
+    }
+
+    if (pchan->ch_sync.count < pchan->ch_size)
+    {
+        sync_putRing(pchan, pobj);
+        return PM_RET_OK;
+    }
+
+    /* Full; the obj waits on this thread's stack */
+    pchan->ch_sending = C_TRUE;
+    sync_block(&pchan->ch_sync, -1);
+    return PM_RET_NO;
+}
+
+
+PmReturn_t
+sync_recv(pPmChannel_t pchan, pPmObj_t *r_pobj)
+{
+    pPmThread_t pthread = pchan->ch_sync.waitHead;
+
+    C_ASSERT(pchan->ch_sync.kind == SYNC_KIND_CHAN);
+
+    if (pthread != C_NULL)
+    {
+        /* Waiting receivers mean there's nothing to take */
+        if (!pchan->ch_sending)
+        {
+            pthread = C_NULL;
+        }
+
+        /* The first waiting sender's send() is done */
+        else
+        {
+            sync_dequeue(pthread);
+            thread_makeReady(pthread);
+        }
+    }
+
+    if (pchan->ch_sync.count > 0)
+    {
+        *r_pobj = pchan->ch_ring[pchan->ch_head];
+        pchan->ch_ring[pchan->ch_head] = C_NULL;
+        pchan->ch_head++;
+        if (pchan->ch_head == pchan->ch_size)
+        {
+            pchan->ch_head = 0;
+        }
+        pchan->ch_sync.count--;
+
+        /* The sender's obj takes the place that was freed */
+        if (pthread != C_NULL)
+        {
+            sync_putRing(pchan, pthread->pframe->fo_sp[-1]);
+            pthread->pframe->fo_sp[-1] = PM_NONE;
+        }
+        return PM_RET_OK;
+    }
+
+    /* A channel of size 0 hands the obj over from the sender's stack */
+    if (pthread != C_NULL)
+    {
+        *r_pobj = pthread->pframe->fo_sp[-1];
+        pthread->pframe->fo_sp[-1] = PM_NONE;
+        return PM_RET_OK;
+    }
+
+    /* Empty; the sender replaces the None result */
+    *r_pobj = PM_NONE;
+    pchan->ch_sending = C_FALSE;
+    sync_block(&pchan->ch_sync, -1);
+    return PM_RET_NO;
+}
+
+
+void
+sync_timeout(pPmThread_t pthread)
+{
+    pPmSync_t psync = pthread->waitSync;
+
+    sync_dequeue(pthread);
+
+    /* The native that blocked returned True; it's False after all */
+    pthread->pframe->fo_sp[-1] = PM_FALSE;
+
+    if (psync->kind == SYNC_KIND_COND)
+    {
+        sync_relock(psync->plock, pthread);
+    }
+    else
+    {
+        thread_makeReady(pthread);
+    }
+}
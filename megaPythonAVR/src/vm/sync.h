@@ -0,0 +1,229 @@
+/*
+ * PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+ * Copyright 2007 David Greenberg
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __SYNC_H__
+#define __SYNC_H__
+
+/**
+ * Sync Object Type
+ *
+ * Locks, semaphores, conditions and channels for threads.
+ *
+ * A thread that must wait is taken off the ready queues and put in the
+ * wait queue of the sync obj, so only the waiting thread stops.
+ * Acquiring a free lock or semaphore allocates nothing.
+ *
+ * A channel passes obj references from thread to thread through a ring
+ * of fixed size that is allocated with the channel, so a message is
+ * neither copied nor allocated.  A thread that sends to a full channel,
+ * or receives from an empty one, waits in the channel's wait queue.
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/24   #130: Add channels
+ * 2008/02/18   #127: First
+ */
+
+/***************************************************************
+ * Constants
+ **************************************************************/
+
+/** Kinds of sync obj */
+#define SYNC_KIND_LOCK  0
+#define SYNC_KIND_SEM   1
+#define SYNC_KIND_COND  2
+#define SYNC_KIND_CHAN  3
+
+/** Most objs a channel can hold */
+#define SYNC_CHANNEL_MAX_SIZE 255
+
+
+/***************************************************************
+ * Types
+ **************************************************************/
+
+/**
+ * Sync obj
+ *
+ * A lock is a semaphore with a count of one that knows its owner.
+ * A condition has no count; it uses the lock it was made with.
+ */
+typedef struct PmSync_s
+{
+    /** Object descriptor */
+    PmObjDesc_t od;
+
+    /** Kind of sync obj (SYNC_KIND_*) */
+    uint8_t kind;
+
+    /** Number of acquires that can be done without waiting */
+    int16_t count;
+
+    /** Thread that holds the lock, C_NULL if none */
+    pPmThread_t owner;
+
+    /** Waiting threads, highest priority first, linked by their next */
+    pPmThread_t waitHead;
+
+    /** Lock of a condition */
+    struct PmSync_s *plock;
+} PmSync_t,
+ *pPmSync_t;
+
+/**
+ * Channel obj
+ *
+ * The count of the sync obj is the number of objs in the ring.
+ * The waiting threads are all senders or all receivers.  A waiting
+ * sender's obj is the result of its send() until a receiver takes it;
+ * a waiting receiver's result is replaced by the obj it is sent.
+ */
+typedef struct PmChannel_s
+{
+    /** Sync obj of kind SYNC_KIND_CHAN */
+    PmSync_t ch_sync;
+
+    /** Number of objs the ring holds */
+    uint8_t ch_size;
+
+    /** Index of the oldest obj in the ring */
+    uint8_t ch_head;
+
+    /** Nonzero if the waiting threads are senders */
+    uint8_t ch_sending;
+
+    /** The ring; ch_size entries follow in the same chunk */
+    pPmObj_t ch_ring[1];
+} PmChannel_t,
+ *pPmChannel_t;
+
+
+/***************************************************************
+ * Prototypes
+ **************************************************************/
+
+/**
+ * Allocates a new Sync object.
+ *
+ * @param   kind Kind of sync obj (SYNC_KIND_*)
+ * @param   count Initial count of a semaphore (1 for a lock)
+ * @param   plock Lock of a condition, C_NULL otherwise
+ * @param   r_pobj Return; addr of ptr to obj
+ * @return  Return status
+ */
+PmReturn_t sync_new(uint8_t kind, int16_t count, pPmSync_t plock,
+                    pPmObj_t *r_pobj);
+
+/**
+ * Acquires a lock or semaphore for the current thread.
+ *
+ * If it can't be acquired at once, the thread is blocked in the wait
+ * queue and a reschedule is requested.  Release hands the lock or
+ * semaphore straight to the first waiter, so by the time the thread runs
+ * again it holds it, unless the wait timed out.  The result of the
+ * native that called this is then replaced by False.
+ *
+ * @param   psync Lock or semaphore
+ * @param   ms Milliseconds to wait at most; negative waits forever
+ * @return  PM_RET_OK if acquired or waiting,
+ *          PM_RET_NO if ms is 0 and it could not be acquired at once
+ */
+PmReturn_t sync_acquire(pPmSync_t psync, int32_t ms);
+
+/**
+ * Releases a lock or semaphore, waking the first thread waiting for it.
+ *
+ * @param   psync Lock or semaphore
+ * @return  Return status; ValueError if the lock is not held
+ *          by the current thread
+ */
+PmReturn_t sync_release(pPmSync_t psync);
+
+/**
+ * Releases the lock of a condition and blocks the current thread
+ * until the condition is notified or the time is up.
+ * Either way the thread holds the lock again when it next runs.
+ * On a timeout the result of the native that called this is
+ * replaced by False.
+ *
+ * @param   pcond Condition
+ * @param   ms Milliseconds to wait at most; 0 or negative waits forever
+ * @return  Return status; ValueError if the lock is not held
+ *          by the current thread
+ */
+PmReturn_t sync_wait(pPmSync_t pcond, int32_t ms);
+
+/**
+ * Wakes one or all of the threads waiting on a condition.
+ * The woken threads wait for the lock, which the caller holds.
+ *
+ * @param   pcond Condition
+ * @param   all Nonzero to wake all waiting threads
+ * @return  Return status; ValueError if the lock is not held
+ *          by the current thread
+ */
+PmReturn_t sync_notify(pPmSync_t pcond, uint8_t all);
+
+/**
+ * Allocates a new channel with its ring.
+ *
+ * @param   size Number of objs the channel holds before a sender waits;
+ *          0 makes each send wait for its receiver
+ * @param   r_pobj Return; addr of ptr to obj
+ * @return  Return status
+ */
+PmReturn_t sync_newChannel(uint8_t size, pPmObj_t *r_pobj);
+
+/**
+ * Sends an obj on a channel.
+ *
+ * A waiting receiver gets the obj at once; otherwise it is put in the
+ * ring.  If the ring is full, the current thread is blocked and
+ * a reschedule is requested.  The native that called this must then
+ * return the obj itself, which keeps it on the thread's stack until
+ * a receiver takes it and replaces the result by None.
+ *
+ * @param   pchan Channel
+ * @param   pobj Obj to send
+ * @return  PM_RET_OK if sent, PM_RET_NO if the thread is waiting
+ */
+PmReturn_t sync_send(pPmChannel_t pchan, pPmObj_t pobj);
+
+/**
+ * Receives the oldest obj of a channel.
+ *
+ * If there is none, the current thread is blocked and a reschedule
+ * is requested.  The native that called this returns None, which
+ * the sender replaces by the obj it sends.
+ *
+ * @param   pchan Channel
+ * @param   r_pobj Return; the obj received, or None if waiting
+ * @return  PM_RET_OK if received, PM_RET_NO if the thread is waiting
+ */
+PmReturn_t sync_recv(pPmChannel_t pchan, pPmObj_t *r_pobj);
+
+/**
+ * Ends the wait of a thread whose time ran out in the timer wheel.
+ *
+ * @param   pthread Thread waiting in a sync obj's wait queue
+ */
+void sync_timeout(pPmThread_t pthread);
+
+#endif /* __SYNC_H__ */
@@ -28,6 +28,12 @@
  * Log
  * ---
  *
+ * 2008/03/05   #134: Keep the run stats of each thread
+ * 2008/03/03   #133: A new thread waits on no descriptor
+ * 2008/03/01   #132: A new thread gets the default timeslice
+ * 2008/02/18   #127: Add timed waits on sync objs
+ * 2008/02/16   #126: Add the timer wheel for sleeping threads
+ * 2008/02/14   #125: Add priorities and the ready queues
  * 2007/01/03   #75: First (P.Adelt)
  */
 
@@ -38,6 +44,17 @@
 #include "pm.h"
 
 
+/***************************************************************
+ * Globals
+ **************************************************************/
+
+/** Index of the highest set bit of each nibble value (0 for 0) */
+static uint8_t const thread_nibbleHighBit[16] =
+{
+    0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+};
+
+
 /***************************************************************
  * Functions
  **************************************************************/
@@ -66,6 +83,220 @@ thread_new(pPmObj_t pframe, pPmObj_t *r_pobj)
     OBJ_SET_TYPE(pthread, OBJ_TYPE_THR);
     pthread->pframe = (pPmFrame_t)pframe;
     pthread->interpctrl = INTERP_CTRL_CONT;
+    pthread->next = C_NULL;
+    pthread->priority = THREAD_PRIORITY_DEFAULT;
+    pthread->state = THREAD_STATE_BLOCKED;
+    pthread->timerNext = C_NULL;
+    pthread->wakeTick = 0;
+    pthread->waitSync = C_NULL;
+    pthread->sliceMs = THREAD_SLICE_MS;
+#ifdef TARGET_DESKTOP
+    pthread->waitFd = -1;
+#endif /* TARGET_DESKTOP */
+#if USE_THREAD_STATS
+    pthread->bcCount = 0;
+    pthread->runMs = 0;
+    pthread->readyTick = 0;
+    pthread->preempts = 0;
+    sli_memset((uint8_t *)pthread->latency, 0, sizeof(pthread->latency));
+#endif /* USE_THREAD_STATS */
 
     return retval;
 }
+
+
+void
+thread_makeReady(pPmThread_t pthread)
+{
+    uint8_t prio = pthread->priority;
+
+    /* Append to the queue of its priority */
+    pthread->next = C_NULL;
+    pthread->state = THREAD_STATE_READY;
+#if USE_THREAD_STATS
+    pthread->readyTick = pm_timerMsTicks;
+#endif /* USE_THREAD_STATS */
+    if (gVmGlobal.readyHead[prio] == C_NULL)
+    {
+        gVmGlobal.readyHead[prio] = pthread;
+    }
+    else
+    {
+        gVmGlobal.readyTail[prio]->next = pthread;
+    }
+    gVmGlobal.readyTail[prio] = pthread;
+    gVmGlobal.readyMask |= (uint8_t)(1 << prio);
+
+    /* A higher priority thread preempts the current one */
+    if ((gVmGlobal.pthread != C_NULL)
+        && (prio > gVmGlobal.pthread->priority))
+    {
+        VM_SET_RESCHEDULE(1);
+    }
+}
+
+
+pPmThread_t
+thread_takeReady(void)
+{
+    pPmThread_t pthread;
+    uint8_t mask = gVmGlobal.readyMask;
+    uint8_t prio;
+
+    if (mask == 0)
+    {
+        return C_NULL;
+    }
+
+    /* Find the highest priority with a ready thread */
+    if ((mask >> 4) != 0)
+    {
+        prio = 4 + thread_nibbleHighBit[mask >> 4];
+    }
+    else
+    {
+        prio = thread_nibbleHighBit[mask];
+    }
+
+    /* Take the thread from the head of that queue */
+    pthread = gVmGlobal.readyHead[prio];
+    gVmGlobal.readyHead[prio] = pthread->next;
+    if (pthread->next == C_NULL)
+    {
+        gVmGlobal.readyTail[prio] = C_NULL;
+        gVmGlobal.readyMask &= (uint8_t)~(1 << prio);
+    }
+    pthread->next = C_NULL;
+
+    return pthread;
+}
+
+
+void
+thread_sleep(pPmThread_t pthread, uint32_t ms)
+{
+    uint8_t slot;
+
+    /* The slot of the current tick may have been looked at already */
+    if (ms == 0)
+    {
+        ms = 1;
+    }
+
+    pthread->state = THREAD_STATE_BLOCKED;
+    pthread->wakeTick = pm_timerMsTicks + ms;
+
+    /* Put it at the front of its slot's list */
+    slot = THREAD_TIMER_SLOT(pthread->wakeTick);
+    pthread->timerNext = gVmGlobal.timerWheel[slot];
+    gVmGlobal.timerWheel[slot] = pthread;
+}
+
+
+void
+thread_cancelSleep(pPmThread_t pthread)
+{
+    pPmThread_t volatile *ppthread;
+
+    ppthread = &gVmGlobal.timerWheel[THREAD_TIMER_SLOT(pthread->wakeTick)];
+    while (*ppthread != C_NULL)
+    {
+        if (*ppthread == pthread)
+        {
+            *ppthread = pthread->timerNext;
+            pthread->timerNext = C_NULL;
+            return;
+        }
+        ppthread = &(*ppthread)->timerNext;
+    }
+}
+
+
+void
+thread_wakeSleepers(void)
+{
+    pPmThread_t volatile *ppthread;
+    pPmThread_t pthread;
+    uint32_t now = pm_timerMsTicks;
+    uint32_t tick = gVmGlobal.timerTick;
+    uint8_t n;
+
+    /* Look at the slots of the ticks that passed; each slot at most once */
+    if ((now - tick) >= THREAD_TIMER_SLOTS)
+    {
+        n = THREAD_TIMER_SLOTS;
+    }
+    else
+    {
+        n = (uint8_t)(now - tick);
+    }
+
+    for (; n > 0; n--)
+    {
+        tick++;
+
+        /* Wake the threads in the slot whose time has come */
+        ppthread = &gVmGlobal.timerWheel[THREAD_TIMER_SLOT(tick)];
+        while (*ppthread != C_NULL)
+        {
+            pthread = *ppthread;
+            if ((int32_t)(now - pthread->wakeTick) >= 0)
+            {
+                *ppthread = pthread->timerNext;
+                pthread->timerNext = C_NULL;
+                if (pthread->waitSync != C_NULL)
+                {
+                    sync_timeout(pthread);
+                }
+                else
+                {
+                    thread_makeReady(pthread);
+                }
+            }
+            else
+            {
+                ppthread = &pthread->timerNext;
+            }
+        }
+    }
+
+    gVmGlobal.timerTick = now;
+}
+
+
+#if USE_THREAD_STATS
+void
+thread_countSwitch(pPmThread_t pold, pPmThread_t pnew)
+{
+    uint32_t now = pm_timerMsTicks;
+    uint32_t wait;
+    uint8_t i;
+
+    if (pold != C_NULL)
+    {
+        pold->runMs += now - gVmGlobal.runTick;
+
+        /* A thread that could have run on was preempted */
+        if (pold->state == THREAD_STATE_READY)
+        {
+            pold->preempts++;
+        }
+    }
+
+    if (pnew != C_NULL)
+    {
+        /* The bucket is the number of bits of the wait, at most the last */
+        wait = now - pnew->readyTick;
+        for (i = 0; (wait != 0) && (i < (THREAD_LATENCY_BUCKETS - 1)); i++)
+        {
+            wait >>= 1;
+        }
+        if (pnew->latency[i] != 0xFFFF)
+        {
+            pnew->latency[i]++;
+        }
+    }
+
+    gVmGlobal.runTick = now;
+}
+#endif /* USE_THREAD_STATS */
@@ -28,6 +28,12 @@
  * Log
  * ---
  *
+ * 2008/03/05   #134: Add the run stats of each thread
+ * 2008/03/03   #133: Add the descriptor a desktop thread waits on
+ * 2008/03/01   #132: Add the timeslice of each thread
+ * 2008/02/18   #127: Add the sync obj a thread waits on
+ * 2008/02/16   #126: Add the timer wheel for sleeping threads
+ * 2008/02/14   #125: Add priorities and the ready queues
  * 2007/01/03   #75: First (P.Adelt)
  */
 
@@ -41,8 +47,74 @@
  * Constants
  **************************************************************/
 
- /** Frequency in Hz to switch threads */
-#define THREAD_RESCHEDULE_FREQUENCY    10
+/**
+ * Default timeslice in ms.  A thread is preempted when its slice is over
+ * and another thread of the same priority is ready.
+ */
+#ifndef THREAD_SLICE_MS
+#define THREAD_SLICE_MS 10
+#endif
+
+/**
+ * Number of thread priorities; 0 is the lowest.
+ * At most 8, since the ready queues are tracked by the bits of one byte.
+ */
+#define THREAD_NUM_PRIORITIES   8
+
+/** Priority of threads made by spawn() and the root module */
+#define THREAD_PRIORITY_DEFAULT 2
+
+/** Priority of the threads that run interrupt callbacks */
+#define THREAD_PRIORITY_CALLBACK 6
+
+/**
+ * Number of slots in the timer wheel of sleeping threads.
+ * Must be a power of two.  A sleeping thread is kept in the slot
+ * of its wake tick (in ms), so each ms the VM looks at one slot.
+ */
+#ifndef THREAD_TIMER_SLOTS
+#define THREAD_TIMER_SLOTS 8
+#endif
+
+/**
+ * Set to nonzero to keep the run stats of each thread: the bytecodes
+ * and ms it ran, how often it was preempted and how long it waited
+ * to run once ready.  See sys.threadstats().
+ */
+#ifndef USE_THREAD_STATS
+#define USE_THREAD_STATS 1
+#endif
+
+/**
+ * Number of buckets of the ready-to-run wait of a thread.  Bucket 0
+ * counts waits of 0 ms, bucket n those of 2^(n-1) to 2^n - 1 ms and the
+ * last bucket all longer ones.
+ */
+#define THREAD_LATENCY_BUCKETS 8
+
+
+/***************************************************************
+ * Macros
+ **************************************************************/
+
+/** Returns nonzero if a thread of the given or a higher priority is ready */
+#define THREAD_IS_READY_FROM(prio) ((gVmGlobal.readyMask >> (prio)) != 0)
+
+/** Returns the timer wheel slot of the given tick */
+#define THREAD_TIMER_SLOT(tick) ((uint8_t)(tick) & (THREAD_TIMER_SLOTS - 1))
+
+/** Returns nonzero if the running thread's slice is over */
+#define THREAD_IS_SLICE_OVER() \
+    ((int32_t)(pm_timerMsTicks - gVmGlobal.sliceEnd) >= 0)
+
+/** Ends the running thread's slice, so the next ready thread runs */
+#define THREAD_END_SLICE() \
+    do \
+    { \
+        gVmGlobal.sliceEnd = pm_timerMsTicks; \
+        VM_SET_RESCHEDULE(1); \
+    } \
+    while (0)
 
 /***************************************************************
  * Types
@@ -68,6 +140,19 @@ typedef enum PmInterpCtrl_e
         /* all positive values indicate "continue interpreting" */
 } PmInterpCtrl_t, *pPmInterpCtrl_t;
 
+/**
+ * Thread states
+ *
+ * A thread that is not ready or running is blocked and is not in any
+ * ready queue, so it costs the scheduler nothing.
+ */
+typedef enum PmThreadState_e
+{
+    THREAD_STATE_READY = 0,     /**< In a ready queue */
+    THREAD_STATE_RUNNING,       /**< The current thread */
+    THREAD_STATE_BLOCKED        /**< Waiting; in no ready queue */
+} PmThreadState_t;
+
 /**
  * Thread obj
  *
@@ -80,6 +165,49 @@ typedef struct PmThread_s
     /** current frame pointer */
     pPmFrame_t pframe;
 
+    /** Next thread in the same queue (ready queue or otherwise) */
+    struct PmThread_s *next;
+
+    /** Priority, 0 to THREAD_NUM_PRIORITIES - 1; higher runs first */
+    uint8_t priority;
+
+    /** Scheduling state (PmThreadState_t) */
+    uint8_t state;
+
+    /** Timeslice in ms, 1 to 255 */
+    uint8_t sliceMs;
+
+    /** Next thread in the same timer wheel slot */
+    struct PmThread_s *timerNext;
+
+    /** Value of pm_timerMsTicks at which a sleeping thread wakes */
+    uint32_t wakeTick;
+
+    /** Sync obj in whose wait queue the thread is, C_NULL if none */
+    struct PmSync_s *waitSync;
+
+#ifdef TARGET_DESKTOP
+    /** Copy of the descriptor the thread waits on, -1 if none (#133) */
+    int waitFd;
+#endif /* TARGET_DESKTOP */
+
+#if USE_THREAD_STATS
+    /** Bytecodes run, up to the last backward jump or call (#134) */
+    uint32_t bcCount;
+
+    /** Ms ticks spent running */
+    uint32_t runMs;
+
+    /** Value of pm_timerMsTicks when the thread was last made ready */
+    uint32_t readyTick;
+
+    /** Times the thread was put back in its ready queue for another */
+    uint16_t preempts;
+
+    /** Waits from ready to running by log2 of their ms; saturating */
+    uint16_t latency[THREAD_LATENCY_BUCKETS];
+#endif /* USE_THREAD_STATS */
+
     /**
      * Interpreter loop control value
      *
@@ -105,4 +233,55 @@ typedef struct PmThread_s
  */
 PmReturn_t thread_new(pPmObj_t pframe, pPmObj_t *r_pobj);
 
+/**
+ * Puts a thread at the end of the ready queue of its priority.
+ * Requests a reschedule if the thread should preempt the current one.
+ *
+ * @param pthread Thread to make ready; must not be in a queue
+ */
+void thread_makeReady(pPmThread_t pthread);
+
+/**
+ * Takes the thread at the head of the highest priority ready queue
+ * that is not empty.  Takes constant time however many threads exist.
+ *
+ * @return The thread, or C_NULL if no thread is ready
+ */
+pPmThread_t thread_takeReady(void);
+
+/**
+ * Blocks a thread and puts it in the timer wheel to be made ready
+ * after the given time.  A sleep of 0 ms lasts until the next tick.
+ *
+ * @param pthread Thread to put to sleep; must not be in a queue
+ * @param ms Milliseconds to sleep
+ */
+void thread_sleep(pPmThread_t pthread, uint32_t ms);
+
+/**
+ * Takes a thread out of the timer wheel, if it is in it.
+ *
+ * @param pthread Thread whose wait ended before its time ran out
+ */
+void thread_cancelSleep(pPmThread_t pthread);
+
+/**
+ * Makes ready the sleeping threads whose wake tick has come.
+ * A thread that waited on a sync obj is handed to sync_timeout().
+ * Looks only at the wheel slots of the ticks since the last call.
+ */
+void thread_wakeSleepers(void);
+
+#if USE_THREAD_STATS
+/**
+ * Counts a change of the running thread in the run stats: charges the
+ * ms since the last change to the old thread and the wait since it was
+ * made ready to the new one.
+ *
+ * @param pold Thread that ran, C_NULL if none
+ * @param pnew Thread to run, C_NULL if none
+ */
+void thread_countSwitch(pPmThread_t pold, pPmThread_t pnew);
+#endif /* USE_THREAD_STATS */
+
 #endif /*THREAD_H_ */
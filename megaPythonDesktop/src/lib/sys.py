@@ -27,6 +27,12 @@
 # LOG
 # ---
 #
+# 2008/03/09    #136: Add read(); its string is made before the bytes are
+#               got into it, sized to those buffered if there are any
+# 2008/03/07    #135: puts() sends the string at once, add flush()
+# 2008/03/05    #134: Add threadstats()
+# 2008/03/03    #133: getb() lets other threads run while stdin is empty
+# 2008/02/20    #128: registerCallback() takes an event ID
 # 2007/02/03    #89: Move plat module functions into sys module
 # 2006/12/26   *#65: Create plat module with put and get routines
 # 2007/02/03    #88: Create library function to return heap stats
@@ -34,7 +40,6 @@
 # 2006/08/21    Adapt native libs to use the changed func calls
 # 2002/09/07    Created.
 #
-
 #### TODO
 # modules = None #set ptr to dict w/native func
 # platform string or device id, rand
@@ -80,10 +85,10 @@ def exit(val):
 
 
 #
-# Get a byte from the platform's default I/O
-# Returns the byte in the LSB of the returned integer
+# Get a byte from the platform's default I/O, or None if the thread
+# has to wait for one first (then it waits before it runs again)
 #
-def getb():
+def _getb():
     """__NATIVE__
     uint8_t b;
     pPmObj_t pb;
@@ -96,6 +101,17 @@ def getb():
         return retval;
     }
 
+#ifdef TARGET_DESKTOP
+    /* #133: Wait for stdin (fd 0) without stopping the other threads */
+    retval = plat_waitFd(0, 0);
+    if (retval == PM_RET_NO)
+    {
+        NATIVE_SET_TOS(PM_NONE);
+        return PM_RET_OK;
+    }
+    PM_RETURN_IF_ERROR(retval);
+#endif /* TARGET_DESKTOP */
+
     retval = plat_getByte(&b);
     PM_RETURN_IF_ERROR(retval);
 
@@ -106,6 +122,102 @@ def getb():
     pass
 
 
+#
+# Get a byte from the platform's default I/O
+# Returns the byte in the LSB of the returned integer
+#
+def getb():
+    b = _getb()
+    while b == None:
+        b = _getb()
+    return b
+
+
+#
+# Gets up to n bytes that have arrived on the platform's default I/O,
+# or returns None if the thread has to wait for them first
+#
+def _read(n):
+    """__NATIVE__
+    pPmObj_t pn;
+    pPmString_t pstr;
+    int32_t len;
+    uint16_t got;
+    PmReturn_t retval;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not an int, raise TypeError */
+    pn = NATIVE_GET_LOCAL(0);
+    if (OBJ_GET_TYPE(pn) != OBJ_TYPE_INT)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If the count is not positive, raise ValueError */
+    len = ((pPmInt_t)pn)->val;
+    if (len <= 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+    if (len > 0xFFFF)
+    {
+        len = 0xFFFF;
+    }
+
+#ifdef TARGET_DESKTOP
+    /* #136: Wait for stdin (fd 0) without stopping the other threads */
+    retval = plat_waitFd(0, 0);
+    if (retval == PM_RET_NO)
+    {
+        NATIVE_SET_TOS(PM_NONE);
+        return PM_RET_OK;
+    }
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Get no more than is buffered, if anything is */
+    got = plat_inReady();
+    if ((got != 0) && (got < len))
+    {
+        len = got;
+    }
+#endif /* TARGET_DESKTOP */
+
+    /*
+     * Make the string before getting the bytes, so none are lost if
+     * there's no room for it; it is cut to the bytes got
+     */
+    retval = string_alloc((uint16_t)len, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+    retval = plat_getBytes(pstr->val, (uint16_t)len, &got);
+    PM_RETURN_IF_ERROR(retval);
+    pstr->length = got;
+    pstr->val[got] = 0;
+
+    NATIVE_SET_TOS((pPmObj_t)pstr);
+    return retval;
+    """
+    pass
+
+
+#
+# Returns a string of up to n bytes from the platform's default I/O,
+# at least one; a thread waits while none have arrived
+#
+def read(n):
+    s = _read(n)
+    while s == None:
+        s = _read(n)
+    return s
+
+
 #
 # Returns a tuple containing the amout of heap available and the maximum
 #
@@ -186,8 +298,53 @@ def putb(b):
 # Sends a string to the default I/O
 #
 def puts(s):
-    for c in s: 
-        putb(ord(c))
+    """__NATIVE__
+    pPmObj_t ps;
+    PmReturn_t retval;
+
+    ps = NATIVE_GET_LOCAL(0);
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not a string, raise TypeError */
+    if (OBJ_GET_TYPE(ps) != OBJ_TYPE_STR)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = plat_putBytes(STRING_GET_CHARS(ps), ((pPmString_t)ps)->length);
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
+
+
+#
+# Sends the output that is still buffered; it is otherwise sent at each
+# newline, while the VM idles or waits for input and when it ends
+#
+def flush():
+    """__NATIVE__
+    PmReturn_t retval;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = plat_flush();
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
 
 #
 # Returns the number of milliseconds since the PyMite VM was initialized (or just some other number of ms that's always increasing)
@@ -227,6 +384,93 @@ def time():
     pass
 
 
+#
+# Returns the run stats of the live threads, a list with a tuple per
+# thread: (priority, bytecodes run, ms run, times preempted, waits).
+# Waits is a tuple counting the waits from ready to running: the first
+# item counts those of 0 ms, item n those of 2**(n-1) to 2**n - 1 ms and
+# the last all longer ones; each stops at 65535.  The bytecodes of the
+# calling thread are counted up to its last backward jump or call before
+# this one.
+# Try print sys.threadstats() from ipm.
+#
+def threadstats():
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+#if USE_THREAD_STATS
+    pPmObj_t plist;
+    pPmObj_t ptup;
+    pPmObj_t pwaits;
+    pPmObj_t pn;
+    pPmThread_t pthread;
+    uint32_t runMs;
+    int16_t i;
+    uint8_t j;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = list_new(&plist);
+    PM_RETURN_IF_ERROR(retval);
+
+    for (i = 0; i < gVmGlobal.threadList->length; i++)
+    {
+        retval = list_getItem((pPmObj_t)gVmGlobal.threadList, i,
+                              (pPmObj_t *)&pthread);
+        PM_RETURN_IF_ERROR(retval);
+
+        /* The running thread has also run since it last started */
+        runMs = pthread->runMs;
+        if (pthread == gVmGlobal.pthread)
+        {
+            runMs += pm_timerMsTicks - gVmGlobal.runTick;
+        }
+
+        /* Make the thread's tuple */
+        retval = tuple_new(5, &ptup);
+        PM_RETURN_IF_ERROR(retval);
+        retval = int_new(pthread->priority, &pn);
+        PM_RETURN_IF_ERROR(retval);
+        ((pPmTuple_t)ptup)->val[0] = pn;
+        retval = int_new((int32_t)pthread->bcCount, &pn);
+        PM_RETURN_IF_ERROR(retval);
+        ((pPmTuple_t)ptup)->val[1] = pn;
+        retval = int_new((int32_t)runMs, &pn);
+        PM_RETURN_IF_ERROR(retval);
+        ((pPmTuple_t)ptup)->val[2] = pn;
+        retval = int_new(pthread->preempts, &pn);
+        PM_RETURN_IF_ERROR(retval);
+        ((pPmTuple_t)ptup)->val[3] = pn;
+
+        /* And the tuple of its waits */
+        retval = tuple_new(THREAD_LATENCY_BUCKETS, &pwaits);
+        PM_RETURN_IF_ERROR(retval);
+        ((pPmTuple_t)ptup)->val[4] = pwaits;
+        for (j = 0; j < THREAD_LATENCY_BUCKETS; j++)
+        {
+            retval = int_new(pthread->latency[j], &pn);
+            PM_RETURN_IF_ERROR(retval);
+            ((pPmTuple_t)pwaits)->val[j] = pn;
+        }
+
+        retval = list_append(plist, ptup);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    NATIVE_SET_TOS(plist);
+#else
+    /* The stats are not kept, raise SystemError */
+    PM_RAISE(retval, PM_RET_EX_SYS);
+#endif /* USE_THREAD_STATS */
+    return retval;
+    """
+    pass
+
+
 #
 # Uses native code to print out vm state without allocating anything
 #
@@ -241,13 +485,17 @@ def print_vm_state():
     pass
 
 #
-# Registers a callback in the callback dict
+# Registers the function to call for events of the given ID, 0 to 7.
+# Events are posted by interrupt handlers with event_post(); the function
+# runs in a new thread and gets the event's data if it takes an arg.
+# The data of an event that overflowed the event queue is lost; the
+# function then gets None.
 #
-def registerCallback(name, func):
+def registerCallback(id, func):
     """__NATIVE__
-    pPmObj_t paddr;
+    pPmObj_t pid;
     pPmObj_t pfunc;
-    PmReturn_t retval;
+    PmReturn_t retval = PM_RET_OK;
 
     /* If wrong number of args, raise TypeError */
     if (NATIVE_GET_NUM_ARGS() != 2)
@@ -256,15 +504,23 @@ def registerCallback(name, func):
         return retval;
     }
 
-    paddr = NATIVE_GET_LOCAL(0);
+    pid = NATIVE_GET_LOCAL(0);
 
     /* If first arg is not an int, raise TypeError */
-    if (OBJ_GET_TYPE(paddr) != OBJ_TYPE_INT)
+    if (OBJ_GET_TYPE(pid) != OBJ_TYPE_INT)
     {
         PM_RAISE(retval, PM_RET_EX_TYPE);
         return retval;
     }
 
+    /* If there is no such event ID, raise ValueError */
+    if ((((pPmInt_t)pid)->val < 0)
+        || (((pPmInt_t)pid)->val >= EVENT_NUM_IDS))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
     pfunc = NATIVE_GET_LOCAL(1);
 
     /* If second arg is not a function, raise TypeError */
@@ -274,7 +530,7 @@ def registerCallback(name, func):
         return retval;
     }
 
-    retval = dict_setItem((pPmObj_t)gVmGlobal.callbacks, paddr, pfunc);
+    gVmGlobal.callbacks[((pPmInt_t)pid)->val] = (pPmFunc_t)pfunc;
     return retval;
     """
     pass
@@ -26,26 +26,55 @@
 #
 # LOG
 # ---
+# 2008/03/01    #132: Add setSlice(); wait() ends the thread's slice
+# 2008/02/24    #130: Add channels
+# 2008/02/18    #127: Add locks, semaphores and conditions
+# 2008/02/16    #126: Add sleep()
+# 2008/02/14    #125: Add thread priorities
 # 2007/01/17    Created.
 #
 
 #### FUNCS
 
 #
-# Runs the given function in a thread sharing the current global namespace
+# Runs the given function in a thread sharing the current global namespace.
+# The optional second arg is the thread's priority, 0 to 7 (default 2);
+# a thread runs only while no thread of higher priority is ready.
 #
-def spawn(f):
+def spawn(f, p):
     """__NATIVE__
     PmReturn_t retval;
     pPmObj_t pf;
+    pPmObj_t pp;
+    uint8_t prio = THREAD_PRIORITY_DEFAULT;
 
     /* If wrong number of args, raise TypeError */
-    if (NATIVE_GET_NUM_ARGS() != 1)
+    if ((NATIVE_GET_NUM_ARGS() < 1) || (NATIVE_GET_NUM_ARGS() > 2))
     {
         PM_RAISE(retval, PM_RET_EX_TYPE);
         return retval;
     }
 
+    /* If priority is not an int, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() == 2)
+    {
+        pp = NATIVE_GET_LOCAL(1);
+        if (OBJ_GET_TYPE(pp) != OBJ_TYPE_INT)
+        {
+            PM_RAISE(retval, PM_RET_EX_TYPE);
+            return retval;
+        }
+
+        /* If priority is out of range, raise ValueError */
+        if ((((pPmInt_t)pp)->val < 0)
+            || (((pPmInt_t)pp)->val >= THREAD_NUM_PRIORITIES))
+        {
+            PM_RAISE(retval, PM_RET_EX_VAL);
+            return retval;
+        }
+        prio = (uint8_t)((pPmInt_t)pp)->val;
+    }
+
     /* If arg is not a function, raise TypeError */
     pf = NATIVE_GET_LOCAL(0);
     if (OBJ_GET_TYPE(pf) != OBJ_TYPE_FXN
@@ -55,7 +84,83 @@ def spawn(f):
         return retval;
     }
 
-    retval = interp_addThread((pPmFunc_t)pf);
+    retval = interp_addThreadPrio((pPmFunc_t)pf, prio);
+    return retval;
+    """
+    pass
+
+#
+# Sets the priority of the current thread, 0 to 7
+#
+def setPriority(p):
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+    pPmObj_t pp;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not an int, raise TypeError */
+    pp = NATIVE_GET_LOCAL(0);
+    if (OBJ_GET_TYPE(pp) != OBJ_TYPE_INT)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If priority is out of range, raise ValueError */
+    if ((((pPmInt_t)pp)->val < 0)
+        || (((pPmInt_t)pp)->val >= THREAD_NUM_PRIORITIES))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    /* Reschedule, since a ready thread may now outrank this one */
+    gVmGlobal.pthread->priority = (uint8_t)((pPmInt_t)pp)->val;
+    VM_SET_RESCHEDULE(1);
+    return retval;
+    """
+    pass
+
+#
+# Sets the timeslice of the current thread, 1 to 255 ms.  When its slice
+# is over, the thread lets the other ready threads of its priority run.
+#
+def setSlice(ms):
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+    pPmObj_t pms;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not an int, raise TypeError */
+    pms = NATIVE_GET_LOCAL(0);
+    if (OBJ_GET_TYPE(pms) != OBJ_TYPE_INT)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If the slice is out of range, raise ValueError */
+    if ((((pPmInt_t)pms)->val < 1) || (((pPmInt_t)pms)->val > 255))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    /* The slice in progress ends as the new slice would */
+    gVmGlobal.pthread->sliceMs = (uint8_t)((pPmInt_t)pms)->val;
+    gVmGlobal.sliceEnd = pm_timerMsTicks + gVmGlobal.pthread->sliceMs;
     return retval;
     """
     pass
@@ -65,12 +170,411 @@ def spawn(f):
 #
 def wait():
     """__NATIVE__
-    /* Set the reschedule flag to true */
-    VM_SET_RESCHEDULE(1);
+    /* End the slice, so the next ready thread runs */
+    THREAD_END_SLICE();
+    return PM_RET_OK;
+    """
+    pass
+
+#
+# Blocks the current thread for the given number of milliseconds.
+# Other threads run meanwhile; if none is ready, the VM idles.
+#
+def sleep(ms):
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+    pPmObj_t pms;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not an int, raise TypeError */
+    pms = NATIVE_GET_LOCAL(0);
+    if (OBJ_GET_TYPE(pms) != OBJ_TYPE_INT)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* Park the thread in the timer wheel, unless it only yields */
+    if (((pPmInt_t)pms)->val > 0)
+    {
+        thread_sleep(gVmGlobal.pthread, (uint32_t)((pPmInt_t)pms)->val);
+    }
+    THREAD_END_SLICE();
+    return retval;
+    """
+    pass
+
+#
+# Makes a lock.  A thread that can't acquire it waits without stopping
+# any other thread.
+#
+def newLock():
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pl;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = sync_new(SYNC_KIND_LOCK, 1, C_NULL, &pl);
+    PM_RETURN_IF_ERROR(retval);
+    NATIVE_SET_TOS(pl);
+    return retval;
+    """
+    pass
+
+#
+# Makes a semaphore with the given count, 0 to 32767
+#
+def newSemaphore(n):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pn;
+    pPmObj_t ps;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not an int, raise TypeError */
+    pn = NATIVE_GET_LOCAL(0);
+    if (OBJ_GET_TYPE(pn) != OBJ_TYPE_INT)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If count is out of range, raise ValueError */
+    if ((((pPmInt_t)pn)->val < 0) || (((pPmInt_t)pn)->val > 0x7FFF))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    retval = sync_new(SYNC_KIND_SEM, (int16_t)((pPmInt_t)pn)->val, C_NULL,
+                      &ps);
+    PM_RETURN_IF_ERROR(retval);
+    NATIVE_SET_TOS(ps);
+    return retval;
+    """
+    pass
+
+#
+# Makes a condition that uses the given lock
+#
+def newCondition(l):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pl;
+    pPmObj_t pc;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not a lock, raise TypeError */
+    pl = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(pl) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)pl)->kind != SYNC_KIND_LOCK))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    retval = sync_new(SYNC_KIND_COND, 0, (pPmSync_t)pl, &pc);
+    PM_RETURN_IF_ERROR(retval);
+    NATIVE_SET_TOS(pc);
+    return retval;
+    """
+    pass
+
+#
+# Acquires a lock or semaphore, waiting for it if need be.
+# The optional second arg is the most ms to wait; 0 doesn't wait
+# and a negative number waits forever (the default).
+# Returns True if acquired, False if the time ran out.
+#
+def acquire(s, ms):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t ps;
+    pPmObj_t pms;
+    int32_t ms = -1;
+
+    /* If wrong number of args, raise TypeError */
+    if ((NATIVE_GET_NUM_ARGS() < 1) || (NATIVE_GET_NUM_ARGS() > 2))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If time is not an int, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() == 2)
+    {
+        pms = NATIVE_GET_LOCAL(1);
+        if (OBJ_GET_TYPE(pms) != OBJ_TYPE_INT)
+        {
+            PM_RAISE(retval, PM_RET_EX_TYPE);
+            return retval;
+        }
+        ms = ((pPmInt_t)pms)->val;
+    }
+
+    /* If arg is not a lock or semaphore, raise TypeError */
+    ps = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(ps) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)ps)->kind > SYNC_KIND_SEM))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* A timed out wait changes the result to False later */
+    retval = sync_acquire((pPmSync_t)ps, ms);
+    NATIVE_SET_TOS((retval == PM_RET_NO) ? PM_FALSE : PM_TRUE);
     return PM_RET_OK;
     """
     pass
 
+#
+# Releases a lock or semaphore.  Raises ValueError if the lock
+# is not held by the current thread.
+#
+def release(s):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t ps;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not a lock or semaphore, raise TypeError */
+    ps = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(ps) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)ps)->kind > SYNC_KIND_SEM))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    return sync_release((pPmSync_t)ps);
+    """
+    pass
+
+#
+# Waits until the condition is notified.  The condition's lock must be
+# held; it is released during the wait and held again afterwards.
+# The optional second arg is the most ms to wait (default forever).
+# Returns True if notified, False if the time ran out.
+#
+def waitCond(c, ms):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pc;
+    pPmObj_t pms;
+    int32_t ms = -1;
+
+    /* If wrong number of args, raise TypeError */
+    if ((NATIVE_GET_NUM_ARGS() < 1) || (NATIVE_GET_NUM_ARGS() > 2))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If time is not an int, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() == 2)
+    {
+        pms = NATIVE_GET_LOCAL(1);
+        if (OBJ_GET_TYPE(pms) != OBJ_TYPE_INT)
+        {
+            PM_RAISE(retval, PM_RET_EX_TYPE);
+            return retval;
+        }
+        ms = ((pPmInt_t)pms)->val;
+    }
+
+    /* If arg is not a condition, raise TypeError */
+    pc = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(pc) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)pc)->kind != SYNC_KIND_COND))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* A timed out wait changes the result to False later */
+    retval = sync_wait((pPmSync_t)pc, ms);
+    NATIVE_SET_TOS(PM_TRUE);
+    return retval;
+    """
+    pass
+
+#
+# Wakes a thread waiting on the condition, or all of them if the
+# optional second arg is true.  The condition's lock must be held.
+#
+def notify(c, all):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pc;
+    uint8_t all = 0;
+
+    /* If wrong number of args, raise TypeError */
+    if ((NATIVE_GET_NUM_ARGS() < 1) || (NATIVE_GET_NUM_ARGS() > 2))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* A true second arg wakes them all */
+    if (NATIVE_GET_NUM_ARGS() == 2)
+    {
+        all = !obj_isFalse(NATIVE_GET_LOCAL(1));
+    }
+
+    /* If arg is not a condition, raise TypeError */
+    pc = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(pc) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)pc)->kind != SYNC_KIND_COND))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    return sync_notify((pPmSync_t)pc, all);
+    """
+    pass
+
+#
+# Makes a channel that holds up to n objs (0 to 255) before a sender waits.
+# A channel of size 0 makes each sender wait for its receiver.
+#
+def newChannel(n):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pn;
+    pPmObj_t pc;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not an int, raise TypeError */
+    pn = NATIVE_GET_LOCAL(0);
+    if (OBJ_GET_TYPE(pn) != OBJ_TYPE_INT)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If size is out of range, raise ValueError */
+    if ((((pPmInt_t)pn)->val < 0)
+        || (((pPmInt_t)pn)->val > SYNC_CHANNEL_MAX_SIZE))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    retval = sync_newChannel((uint8_t)((pPmInt_t)pn)->val, &pc);
+    PM_RETURN_IF_ERROR(retval);
+    NATIVE_SET_TOS(pc);
+    return retval;
+    """
+    pass
+
+#
+# Sends an obj on a channel, waiting while the channel is full.
+# The obj itself is passed, not a copy of it.
+#
+def send(c, obj):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pc;
+    pPmObj_t pobj;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 2)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not a channel, raise TypeError */
+    pc = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(pc) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)pc)->kind != SYNC_KIND_CHAN))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* A waiting sender keeps the obj as its result until it is taken */
+    pobj = NATIVE_GET_LOCAL(1);
+    retval = sync_send((pPmChannel_t)pc, pobj);
+    NATIVE_SET_TOS((retval == PM_RET_NO) ? pobj : PM_NONE);
+    return (retval == PM_RET_NO) ? PM_RET_OK : retval;
+    """
+    pass
+
+#
+# Returns the oldest obj sent on a channel, waiting while it is empty.
+#
+def recv(c):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pc;
+    pPmObj_t pobj = C_NULL;
+
+    /* If wrong number of args, raise TypeError */
+    if (NATIVE_GET_NUM_ARGS() != 1)
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* If arg is not a channel, raise TypeError */
+    pc = NATIVE_GET_LOCAL(0);
+    if ((OBJ_GET_TYPE(pc) != OBJ_TYPE_SYN)
+        || (((pPmSync_t)pc)->kind != SYNC_KIND_CHAN))
+    {
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* A waiting receiver's None is replaced by the obj sent to it */
+    retval = sync_recv((pPmChannel_t)pc, &pobj);
+    NATIVE_SET_TOS(pobj);
+    return (retval == PM_RET_NO) ? PM_RET_OK : retval;
+    """
+    pass
+
+#
+# Stops the preemption of the current thread, stopping every other
+# thread until unlock() is called.  Prefer a lock from newLock().
+#
 def lock():
     """__NATIVE__
     /* Set the atomic flag to true */
@@ -79,6 +583,9 @@ def lock():
     """
     pass
 
+#
+# Lets the current thread be preempted again
+#
 def unlock():
     """__NATIVE__
     /* Set the atmoic flag to false */
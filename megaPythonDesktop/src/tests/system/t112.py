@@ -0,0 +1,73 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 112
+#
+# Regression test for issue #112:
+# Add LOAD_METHOD and CALL_METHOD bytecodes
+#
+
+class Counter:
+    def __init__(self):
+        self.n = 0
+
+    def add(self, i):
+        self.n = self.n + i
+        return self.n
+
+    def get(self):
+        return self.n
+
+def double(i):
+    return 2 * i
+
+
+# Plain method calls, also from inside a loop so the cached entry is used
+c = Counter()
+i = 0
+while i < 5:
+    c.add(i)
+    i = i + 1
+assert c.get() == 10
+
+# A method call as an argument of a method call
+assert c.add(c.add(1)) == 22
+
+# A function in an instance attr is not a method
+c.f = double
+assert c.f(4) == 8
+
+# A new class attr replaces the cached method
+def add3(self, i):
+    self.n = self.n + 3 * i
+    return self.n
+Counter.add = add3
+assert c.add(1) == 25
+
+# An instance attr hides the class's method
+d = Counter()
+d.get = double
+assert d.get(7) == 14
+assert c.get() == 25
+
+# A bound method loaded with LOAD_ATTR still works
+m = c.get
+assert m() == 25
+
+print "Test 112 passed"
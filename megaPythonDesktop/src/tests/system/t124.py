@@ -0,0 +1,77 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 124
+#
+# Regression test for issue #124:
+# Add string slices that share the chars of their string
+#
+
+s = "The quick brown fox jumps over the lazy dog"
+
+# Slices of each kind
+assert s[4:9] == "quick"
+assert s[40:] == "dog"
+assert s[:3] == "The"
+assert s[:] == s
+assert s[-3:] == "dog"
+assert s[4:-34] == "quick"
+assert s[100:] == ""
+assert s[5:5] == ""
+assert s[0:9:4] == "Tqk"
+
+# A slice of a slice
+t = s[10:30]
+assert t == "brown fox jumps over"
+assert t[6:9] == "fox"
+assert t[6:9][1:] == "ox"
+
+# Subscripts and single chars
+assert s[0] == "T"
+assert s[-1] == "g"
+assert s[4:5] == "q"
+assert ord(t[0]) == 98
+assert "x" in t
+
+# Iterating stops at the last char
+n = 0
+for c in t:
+    n = n + 1
+assert n == 20
+
+# Slices work as dict keys and are concatenated like other strings
+d = {}
+d[s[16:19]] = 1
+assert d["fox"] == 1
+assert s[4:10] + s[16:19] == "quick fox"
+
+# Slices outlive their string and survive the GC
+u = "$GPRMC,123519,A,4807.038,N*47"
+w = u[7:13]
+u = 0
+i = 0
+while i < 300:
+    v = ("abcdefghijklmnop" + "q")[3:12]
+    f = v[2:5]
+    i = i + 1
+assert w == "123519"
+assert v == "defghijkl"
+assert f == "fgh"
+
+print "Test 124 passed"
@@ -0,0 +1,62 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 125
+#
+# Regression test for issue #125:
+# Schedule threads by priority
+#
+
+import string
+import thread
+
+log = []
+
+def note(s):
+    log[len(log):] = [s]
+
+def high():
+    note("h")
+
+def mid():
+    note("m")
+
+def low():
+    i = 0
+    while i < 200:
+        i = i + 1
+    note("l")
+
+# A lower priority thread does not run while this one is ready
+thread.spawn(low, 1)
+i = 0
+while i < 200:
+    i = i + 1
+assert string.join(log, "") == ""
+
+# A higher priority thread preempts this one at once
+thread.spawn(high, 5)
+assert string.join(log, "") == "h"
+
+# Once this thread drops below them, the others run in priority order
+thread.spawn(mid)
+thread.setPriority(0)
+assert string.join(log, "") == "hml"
+
+print "Test 125 passed"
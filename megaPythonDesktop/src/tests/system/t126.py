@@ -0,0 +1,58 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+
+#
+# System Test 126
+#
+# Regression test for issue #126:
+# Sleep threads on the timer wheel
+#
+
+
+import string
+import sys
+import thread
+
+log = []
+
+def note(s):
+    log[len(log):] = [s]
+
+def slow():
+    thread.sleep(30)
+    note("s")
+
+def fast():
+    thread.sleep(10)
+    note("f")
+
+# A sleep lasts at least as long as asked
+t = sys.time()
+thread.sleep(50)
+assert sys.time() - t >= 50
+
+# Sleepers wake in the order of their wake times, not of their spawns
+thread.spawn(slow)
+thread.spawn(fast)
+assert string.join(log, "") == ""
+
+# Both run while this thread sleeps past them
+thread.sleep(60)
+assert string.join(log, "") == "fs"
+
+print "Test 126 passed"
@@ -0,0 +1,89 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * System Test 129
+ *
+ * Regression test for issue #129:
+ * Run several VMs in one process
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/22   #129: First
+ */
+
+#include <pthread.h>
+#include "pm.h"
+#include "stdio.h"
+
+
+#define NUM_VMS 2
+
+
+extern unsigned char usrlib_img[];
+
+/** The VMs; each is run by its own native thread */
+static PmVm_t vms[NUM_VMS];
+
+/** Result of each VM */
+static PmReturn_t results[NUM_VMS];
+
+
+static void *
+runVm(void *parg)
+{
+    int i = *(int *)parg;
+    PmReturn_t retval;
+
+    pm_bindVm(&vms[i]);
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    if (retval == PM_RET_OK)
+    {
+        retval = pm_run((uint8_t *)"t129");
+    }
+    results[i] = retval;
+    return C_NULL;
+}
+
+
+int main(void)
+{
+    pthread_t threads[NUM_VMS];
+    int ids[NUM_VMS];
+    int i;
+
+    for (i = 0; i < NUM_VMS; i++)
+    {
+        ids[i] = i;
+        pthread_create(&threads[i], C_NULL, runVm, &ids[i]);
+    }
+
+    for (i = 0; i < NUM_VMS; i++)
+    {
+        pthread_join(threads[i], C_NULL);
+        if (results[i] != PM_RET_OK)
+        {
+            printf("VM %d error 0x%02X at file 0x%02X line %d\n", i,
+                   results[i], vms[i].vm_global.errFileId,
+                   vms[i].vm_global.errLineNum);
+            return (int)results[i];
+        }
+    }
+
+    puts("Test 129 passed");
+    return 0;
+}
@@ -0,0 +1,62 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 134
+#
+# Regression test for issue #134:
+# Keep the run stats of each thread
+#
+
+import sys, thread
+
+# Only the main thread: it ran after one wait
+s = sys.threadstats()
+assert len(s) == 1
+t = s[0]
+assert t[0] == 2
+assert len(t[4]) == 8
+assert sum(t[4]) == 1
+
+# Two busy threads with 1 ms slices take turns
+done = [0]
+
+def spin():
+    thread.setSlice(1)
+    t = sys.time() + 30
+    while sys.time() < t:
+        pass
+    done[0] = done[0] + 1
+
+thread.spawn(spin)
+thread.spawn(spin)
+thread.sleep(15)
+s = sys.threadstats()
+assert len(s) == 3
+assert s[0][1] > t[1]
+for t in s[1:]:
+    assert t[1] > 0
+    assert t[2] > 0
+    assert t[3] > 0
+    assert sum(t[4]) - t[4][0] > 0
+
+# The stats go with the threads
+while done[0] < 2:
+    thread.sleep(1)
+assert len(sys.threadstats()) == 1
+
+print "Test 134 passed"
@@ -0,0 +1,122 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 135
+#
+# Regression test for issue #135:
+# Buffer the output, print runs of bytes at once
+#
+"""__NATIVE__
+#include <unistd.h>
+#include <fcntl.h>
+
+/* The pipe the output goes to, and the stdout it replaced */
+static int t135_fds[2];
+static int t135_stdout = -1;
+"""
+
+import sys
+
+
+#
+# Sends stdout to a pipe that got() reads
+#
+def capture():
+    """__NATIVE__
+    PmReturn_t retval = PM_RET_OK;
+
+    fflush(stdout);
+    t135_stdout = dup(1);
+    if ((t135_stdout < 0)
+        || (pipe(t135_fds) != 0)
+        || (fcntl(t135_fds[0], F_SETFL, O_NONBLOCK) != 0)
+        || (dup2(t135_fds[1], 1) < 0))
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
+
+
+#
+# Returns the bytes that have been written to stdout since the last call
+#
+def got():
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmString_t pstr;
+    uint8_t buf[64];
+    ssize_t n;
+
+    n = read(t135_fds[0], buf, sizeof(buf));
+    if (n < 0)
+    {
+        n = 0;
+    }
+    retval = string_alloc((uint16_t)n, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+    sli_memcpy(pstr->val, buf, (uint16_t)n);
+    NATIVE_SET_TOS((pPmObj_t)pstr);
+    return retval;
+    """
+    pass
+
+
+#
+# Sends stdout back where it went before capture()
+#
+def release():
+    """__NATIVE__
+    fflush(stdout);
+    dup2(t135_stdout, 1);
+    close(t135_stdout);
+    close(t135_fds[0]);
+    close(t135_fds[1]);
+    NATIVE_SET_TOS(PM_NONE);
+    return PM_RET_OK;
+    """
+    pass
+
+
+capture()
+
+# Output is held until a newline or flush()
+sys.puts("abc")
+assert got() == ""
+sys.flush()
+assert got() == "abc"
+sys.putb(0x41)
+assert got() == ""
+sys.puts("B\nC")
+assert got() == "AB\nC"
+
+# Strings are printed in runs between their escapes
+print "x", 12, -3
+assert got() == "x12-3\n"
+print "a\\b"
+assert got() == "a\\\\b\n"
+print ["a\x01b", (1, 2), {"k": None}], None
+assert got() == "['a\\x01b', (1, 2), {'k':None}]\n"
+print [[]]
+assert got() == "[[]]\n"
+
+release()
+print "Test 135 passed"
@@ -0,0 +1,80 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 136
+#
+# Regression test for issue #136:
+# Read stdin into a buffer, add sys.read()
+#
+"""__NATIVE__
+#include <unistd.h>
+"""
+
+import os, sys, thread
+
+
+# Makes a pipe and puts its read end on stdin; returns the write end
+def pipeIn():
+    """__NATIVE__
+    int fds[2];
+    pPmObj_t pfd;
+    PmReturn_t retval;
+
+    if ((pipe(fds) != 0) || (dup2(fds[0], 0) < 0))
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    close(fds[0]);
+    retval = int_new(fds[1], &pfd);
+    NATIVE_SET_TOS(pfd);
+    return retval;
+    """
+    pass
+
+
+w = pipeIn()
+
+# Reads get what has arrived, up to the count
+os.write(w, "hello world")
+assert sys.read(5) == "hello"
+assert sys.getb() == 32
+assert sys.read(100) == "world"
+
+# A reader waits while the other threads run
+got = [""]
+
+def reader():
+    got[0] = sys.read(3)
+
+thread.spawn(reader)
+thread.sleep(20)
+assert got[0] == ""
+os.write(w, "abc")
+while got[0] == "":
+    thread.sleep(1)
+assert got[0] == "abc"
+
+# Reads larger than the buffer get all that arrived at once
+s = ""
+for i in range(30):
+    s = s + "0123456789"
+os.write(w, s)
+assert sys.read(300) == s
+
+print "Test 136 passed"
@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * System Test 137
+ *
+ * Regression test for issue #138:
+ * Add pm_loadImgFile() to map image files at runtime
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/13   #138: First
+ */
+
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char usrlib_img[];
+
+
+int main(void)
+{
+    PmReturn_t retval;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Files that can't be mapped or hold no images are refused */
+    if ((pm_loadImgFile((uint8_t *)"t137none.bin") != PM_RET_EX_IO)
+        || (pm_loadImgFile((uint8_t *)"t137.c") != PM_RET_EX_TYPE))
+    {
+        return 1;
+    }
+
+    /* t137b.bin is made from t137b.py by "pmImgCreator.py -b -u" */
+    retval = pm_loadImgFile((uint8_t *)"t137b.bin");
+    PM_RETURN_IF_ERROR(retval);
+
+    retval = pm_run((uint8_t *)"t137");
+    return (int)retval;
+}
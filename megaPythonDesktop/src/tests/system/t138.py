@@ -0,0 +1,76 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 138
+#
+# Regression test for issue #139:
+# Reload modules from image files
+#
+"""__NATIVE__
+#include <fcntl.h>
+#include <unistd.h>
+"""
+
+import os
+import t138b
+
+
+# Writes a file of the given name and removes it
+def touch(fn):
+    """__NATIVE__
+    int fd;
+    PmReturn_t retval = PM_RET_OK;
+
+    fd = open((char *)STRING_GET_CHARS(NATIVE_GET_LOCAL(0)),
+              O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if ((fd < 0) || (close(fd) != 0)
+        || (unlink((char *)STRING_GET_CHARS(NATIVE_GET_LOCAL(0))) != 0))
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
+
+
+old = t138b
+assert old.count() == 1
+assert old.count() == 2
+
+# Imports after a reload get a new module from the file
+os.loadImg("t138b.bin")
+import t138b
+assert t138b.count() == 1
+
+# The module imported before keeps running its code from the old file,
+# which the GC leaves mapped
+i = 0
+while i < 300:
+    x = [i, i, i, i]
+    i = i + 1
+assert old.count() == 3
+assert t138b.count() == 2
+
+# A watch descriptor can be read once a file in the dir is written
+w = os.watch(".")
+touch("t138.tmp")
+assert len(os.read(w, 255)) >= 16
+
+print "Test 138 passed"
@@ -0,0 +1,69 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 139
+#
+# Regression test for issue #140:
+# Heap snapshot and restore
+#
+# Warms up the VM that is saved
+#
+
+
+# Adds the obj to the builtins, which outlive the module
+def keep(name, obj):
+    """__NATIVE__
+    PmReturn_t retval;
+
+    retval = dict_setItem(PM_PBUILTINS, NATIVE_GET_LOCAL(0),
+                          NATIVE_GET_LOCAL(1));
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
+
+
+class Counter:
+    def __init__(self):
+        self.n = 0
+
+    def next(self):
+        self.n = self.n + 1
+        return self.n
+
+
+def squares(n):
+    d = {}
+    i = 0
+    while i < n:
+        d[i] = i * i
+        i = i + 1
+    return d
+
+
+# Leave garbage behind, so the saved heap has holes in it
+i = 0
+while i < 200:
+    x = [i, (i, i), "warm"]
+    i = i + 1
+
+c = Counter()
+c.next()
+keep("warmCounter", c)
+keep("warmSquares", squares(50))
+keep("warmNames", ["alpha", "beta", "gamma"])
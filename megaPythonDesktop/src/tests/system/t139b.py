@@ -0,0 +1,42 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 139
+#
+# Regression test for issue #140:
+# Heap snapshot and restore
+#
+# Runs in the VM restored from the snapshot
+#
+
+
+# The objs kept by t139a came through the snapshot
+assert warmCounter.n == 1
+assert warmCounter.next() == 2
+assert len(warmSquares) == 50
+assert warmSquares[7] == 49
+assert warmNames[2] == "gamma"
+
+# The restored heap still allocates and collects
+i = 0
+while i < 300:
+    x = [i, i, i, i]
+    i = i + 1
+assert warmCounter.next() == 3
+
+print "Test 139 passed"
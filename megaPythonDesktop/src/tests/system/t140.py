@@ -0,0 +1,126 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 140
+#
+# Regression test for issue #141:
+# Fast VM reset for running many scripts in one process
+#
+"""__NATIVE__
+#include <unistd.h>
+"""
+
+import os, thread
+
+
+# Returns True if the builtins have the name
+def isKept(name):
+    """__NATIVE__
+    PmReturn_t retval;
+    pPmObj_t pval;
+
+    retval = dict_getItem(PM_PBUILTINS, NATIVE_GET_LOCAL(0), &pval);
+    NATIVE_SET_TOS((retval == PM_RET_OK) ? PM_TRUE : PM_FALSE);
+    return PM_RET_OK;
+    """
+    pass
+
+
+# Adds the obj to the builtins, which outlive the module
+def keep(name, obj):
+    """__NATIVE__
+    PmReturn_t retval;
+
+    retval = dict_setItem(PM_PBUILTINS, NATIVE_GET_LOCAL(0),
+                          NATIVE_GET_LOCAL(1));
+    NATIVE_SET_TOS(PM_NONE);
+    return retval;
+    """
+    pass
+
+
+# Returns a tuple of the read and write fds of a new pipe
+def pipe():
+    """__NATIVE__
+    int fds[2];
+    PmReturn_t retval;
+    pPmObj_t ptup;
+    pPmObj_t pfd;
+    uint8_t objid;
+
+    if (pipe(fds) != 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    retval = tuple_new(2, &ptup);
+    PM_RETURN_IF_ERROR(retval);
+    retval = heap_gcPushTempRoot(ptup, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    retval = int_new(fds[0], &pfd);
+    ((pPmTuple_t)ptup)->val[0] = pfd;
+    if (retval == PM_RET_OK)
+    {
+        retval = int_new(fds[1], &pfd);
+        ((pPmTuple_t)ptup)->val[1] = pfd;
+    }
+    heap_gcPopTempRoot(objid);
+    NATIVE_SET_TOS(ptup);
+    return retval;
+    """
+    pass
+
+
+# Closes the fd
+def close(fd):
+    """__NATIVE__
+    close(((pPmInt_t)NATIVE_GET_LOCAL(0))->val);
+    NATIVE_SET_TOS(PM_NONE);
+    return PM_RET_OK;
+    """
+    pass
+
+
+# The last run's objs are gone
+assert not isKept("leftover")
+keep("leftover", [1, 2, 3])
+assert isKept("leftover")
+
+# Fill the heap past what the baseline used
+i = 0
+d = {}
+while i < 30:
+    d[i] = [i, (i, i)]
+    i = i + 1
+assert len(d) == 30
+
+# A thread waits on a descriptor, which makes the VM's epoll set
+p = pipe()
+got = []
+
+def reader():
+    got[len(got):] = [os.read(p[0], 1)]
+
+thread.spawn(reader)
+thread.sleep(5)
+os.write(p[1], "r")
+while len(got) == 0:
+    thread.sleep(1)
+assert got[0] == "r"
+close(p[0])
+close(p[1])
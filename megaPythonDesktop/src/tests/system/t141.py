@@ -0,0 +1,33 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 141
+#
+# Regression test for issue #142:
+# Page-cached reads of the memspaces from MEMSPACE_EEPROM on
+#
+
+import t141b
+
+
+# The module's code and consts come from the memspace
+assert t141b.name == "t141b"
+assert t141b.fib(15) == 610
+d = t141b.squares(20)
+assert d[19] == 361
+assert t141b.fib(10) == 55
@@ -0,0 +1,44 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 142
+#
+# Regression test for issue #143:
+# Compressed code images
+#
+
+import t142b
+
+
+assert t142b.name == "t142b"
+assert t142b.filler == "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabc"
+assert t142b.add(3, 4) == 7
+assert t142b.sub(3, 4) == -1
+assert t142b.mul(3, 4) == 12
+
+# The expanded image outlives collections while its code is used
+i = 0
+while i < 300:
+    x = [i, i, i, i]
+    i = i + 1
+c = t142b.Counter()
+assert c.next() == 1
+assert c.next() == 2
+assert t142b.add(t142b.mul(2, 5), 1) == 11
+
+print "Test 142 passed"
@@ -0,0 +1,71 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ * System Test 143
+ *
+ * Regression test for issue #144:
+ * A pool of the strs and ints shared by an image set
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/25   #144: First
+ */
+
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char usrlib_img[];
+
+
+int main(void)
+{
+    PmReturn_t retval;
+    uint8_t const *pname = (uint8_t const *)"t143b";
+    pPmObj_t pstr;
+    pPmImgInfo_t pii;
+    uint8_t type;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The image file of t143b was made by pmImgCreator.py -p */
+    retval = plat_readFile((uint8_t *)"t143b.bin", 0, &type, 1);
+    PM_RETURN_IF_ERROR(retval);
+    if (type != OBJ_TYPE_PIM)
+    {
+        return 1;
+    }
+
+    retval = pm_loadImgFile((uint8_t *)"t143b.bin");
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Its name is in the pool, and the image keeps the pool */
+    retval = string_new(&pname, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+    retval = img_lookup((pPmString_t)pstr, &pii);
+    PM_RETURN_IF_ERROR(retval);
+    if ((pii->ii_pool == C_NULL) || (pii->ii_pool->length == 0))
+    {
+        return 2;
+    }
+
+    retval = pm_run((uint8_t *)"t143");
+    return (int)retval;
+}
@@ -0,0 +1,54 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 143
+#
+# Regression test for issue #144:
+# A pool of the strs and ints shared by an image set
+#
+# Module put in an image file by pmImgCreator.py -p
+#
+
+name = "t143b"
+limit = 1000
+
+
+def getName():
+    return "t143b"
+
+
+def clip(n):
+    if n > 1000:
+        return 1000
+    return n
+
+
+def scale(n):
+    return clip(n * 1000)
+
+
+def label(n):
+    return "t143b" + ":" + "item"
+
+
+class Item:
+    def __init__(self):
+        self.item = 1000
+
+    def getItem(self):
+        return self.item
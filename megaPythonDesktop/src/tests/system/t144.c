@@ -0,0 +1,105 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+/**
+ * System Test 144
+ *
+ * Regression test for issue #137:
+ * ipm gets an image in frames with a CRC each
+ *
+ * Log
+ * ---
+ *
+ * 2008/03/11   #137: First
+ */
+
+/* -ansi hides the POSIX sleeps; see plat/desktop.c */
+#ifdef __STRICT_ANSI__
+#undef __STRICT_ANSI__
+#include <time.h>
+#define __STRICT_ANSI__
+#else
+#include <time.h>
+#endif
+#include <unistd.h>
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char usrlib_img[];
+
+
+/*
+ * Writes the bytes to the fd from a new process, n at a time with a ms
+ * after each, so the reads of the VM get them in small pieces
+ */
+PmReturn_t
+t144_writeSlowly(int fd, uint8_t const *pbuf, uint16_t len, uint16_t n)
+{
+    struct timespec pause;
+    uint16_t i;
+
+    switch (fork())
+    {
+        case -1:
+            return PM_RET_EX_IO;
+
+        case 0:
+            pause.tv_sec = 0;
+            pause.tv_nsec = 1000000;
+            for (i = 0; i < len; i += n)
+            {
+                if (write(fd, &pbuf[i], (i + n < len) ? n : len - i) < 0)
+                {
+                    _exit(1);
+                }
+                nanosleep(&pause, NULL);
+            }
+            _exit(0);
+
+        default:
+            return PM_RET_OK;
+    }
+}
+
+
+int main(void)
+{
+    PmReturn_t retval;
+    uint8_t b;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The module ends with the end of the ipm session */
+    retval = pm_run((uint8_t *)"t144");
+    if (retval != PM_RET_EX_STOP)
+    {
+        return (retval == PM_RET_OK) ? 1 : (int)retval;
+    }
+
+    /* Which took only its one byte */
+    retval = plat_getByte(&b);
+    PM_RETURN_IF_ERROR(retval);
+    if (b != 'X')
+    {
+        return 2;
+    }
+
+    puts("Test 144 passed");
+    return 0;
+}
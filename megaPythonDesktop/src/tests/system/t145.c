@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+
+/**
+ * System Test 145
+ *
+ * Regression test for issue #110:
+ * A module whose body raised is not kept in the module cache
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/04   #110: First
+ */
+
+#include "pm.h"
+#include "stdio.h"
+
+
+extern unsigned char usrlib_img[];
+
+
+int main(void)
+{
+    PmReturn_t retval;
+
+    retval = pm_init(MEMSPACE_PROG, usrlib_img);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The first time, the body of t145b raises NameError */
+    retval = pm_run((uint8_t *)"t145a");
+    if (retval != PM_RET_EX_NAME)
+    {
+        return 1;
+    }
+
+    /* So importing it again runs its body again */
+    retval = pm_run((uint8_t *)"t145a");
+    PM_RETURN_IF_ERROR(retval);
+
+    puts("Test 145 passed");
+    return 0;
+}
@@ -0,0 +1,179 @@
+# PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+# Copyright 2002 Dean Hall
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+#
+# System Test 146
+#
+# Regression test for issue #144:
+# ipm gets a large image in parts, which it refers to as to a pool
+#
+"""__NATIVE__
+#include <unistd.h>
+"""
+
+import ipm, os
+
+
+# Makes a pipe and puts its read end on stdin; returns the write end
+def pipeIn():
+    """__NATIVE__
+    int fds[2];
+    pPmObj_t pfd;
+    PmReturn_t retval;
+
+    if ((pipe(fds) != 0) || (dup2(fds[0], 0) < 0))
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    close(fds[0]);
+    retval = int_new(fds[1], &pfd);
+    NATIVE_SET_TOS(pfd);
+    return retval;
+    """
+    pass
+
+
+# Returns a copy of the code image of the func, as the host would send it;
+# given a start and a length, only that piece of it (less at its end)
+def imgOf(f):
+    """__NATIVE__
+    pPmCo_t pco;
+    pPmString_t pimg;
+    uint8_t const *paddr;
+    uint16_t size;
+    uint16_t start = 0;
+    uint16_t i;
+    PmReturn_t retval;
+
+    /* The image starts with its type and size */
+    pco = ((pPmFunc_t)NATIVE_GET_LOCAL(0))->f_co;
+    paddr = pco->co_codeimgaddr + 1;
+    size = mem_getWord(pco->co_memspace, &paddr);
+
+    if (NATIVE_GET_NUM_ARGS() == 3)
+    {
+        start = (uint16_t)((pPmInt_t)NATIVE_GET_LOCAL(1))->val;
+        start = (start < size) ? start : size;
+        size -= start;
+        i = (uint16_t)((pPmInt_t)NATIVE_GET_LOCAL(2))->val;
+        size = (i < size) ? i : size;
+    }
+
+    retval = string_alloc(size, &pimg);
+    PM_RETURN_IF_ERROR(retval);
+    paddr = pco->co_codeimgaddr + start;
+    for (i = 0; i < size; i++)
+    {
+        pimg->val[i] = mem_getByte(pco->co_memspace, &paddr);
+    }
+    NATIVE_SET_TOS((pPmObj_t)pimg);
+    return retval;
+    """
+    pass
+
+
+# Returns the CRC-16 (CCITT) of the string, as the host makes it
+def crc16(s):
+    crc = 0xFFFF
+    i = 0
+    while i < len(s):
+        crc = crc ^ (ord(s[i]) << 8)
+        j = 0
+        while j < 8:
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+            j = j + 1
+        i = i + 1
+    return crc
+
+
+# Returns a frame of the given type that holds the payload
+def frame(t, payload):
+    n = len(payload)
+    body = chr(n & 0xFF) + chr(n >> 8) + payload
+    crc = crc16(body)
+    return t + body + chr(crc & 0xFF) + chr(crc >> 8)
+
+
+# Returns the frames of the image, n bytes of it in each, and the end frame
+def frames(t, img, n):
+    s = ""
+    i = 0
+    while i < len(img):
+        s = s + frame(t, img[i:i + n])
+        i = i + n
+    return s + frame(t, "")
+
+
+# Sends the code image of the func as a part, a piece at a time so the
+# image is never whole in this heap; returns its size
+def sendPart(f):
+    n = 0
+    s = imgOf(f, 0, 256)
+    while len(s) > 0:
+        os.write(w, frame("P", s))
+        n = n + len(s)
+        s = imgOf(f, n, 256)
+    os.write(w, frame("P", ""))
+    return n
+
+
+# Makes a code img whose consts refer to n parts; it makes a func of the last
+def refsImg(n):
+    consts = chr(0x04) + chr(n)
+    i = 0
+    while i < n:
+        consts = consts + chr(0x1F) + chr(i)
+        i = i + 1
+    code = chr(100) + chr(n - 1) + chr(0) + chr(132) + chr(0) + chr(0) \
+           + chr(83)
+    size = 6 + 2 + len(consts) + len(code)
+    return chr(0x0A) + chr(size & 0xFF) + chr(size >> 8) \
+           + chr(0) + chr(1) + chr(0) + chr(0x04) + chr(0) + consts + code
+
+
+# A func with a long code img, so a few parts make a large image
+def big(a):
+    a = a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+    a = a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+    a = a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+    a = a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a + a
+    return a
+
+
+w = pipeIn()
+
+# An image larger than the host sends whole (IMG_MAX_SIZE in tools/ipm.py)
+# comes in parts
+parts = []
+n = 0
+while n <= 512 * 3 / 2:
+    n = n + sendPart(big)
+    assert ipm._getImg(parts) == 1
+os.write(w, frames("I", refsImg(len(parts)), 64))
+f = eval(ipm._co(ipm._getImg(parts), parts))
+assert f(1) == big(1)
+
+# All frames of an image are of one type
+img = imgOf(big, 0, 64)
+os.write(w, frame("P", img) + frame("I", ""))
+assert ipm._getImg([]) == None
+
+print "Test 146 passed"
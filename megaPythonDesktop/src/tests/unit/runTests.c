@@ -12,6 +12,8 @@ CuSuite *getSuite_testCodeObj(void);
 CuSuite *getSuite_testFuncObj(void);
 CuSuite *getSuite_testIntObj(void);
 CuSuite *getSuite_testInterp(void);
+CuSuite *getSuite_testModuleObj(void);
+CuSuite *getSuite_testClassObj(void);
 CuSuite *getSuite_testStringObj(void);
 CuSuite *getSuite_testTupleObj(void);
 
@@ -29,6 +31,8 @@ int main(void)
     CuSuiteAddSuite(suite, getSuite_testFuncObj());
     CuSuiteAddSuite(suite, getSuite_testIntObj());
     CuSuiteAddSuite(suite, getSuite_testInterp());
+    CuSuiteAddSuite(suite, getSuite_testModuleObj());
+    CuSuiteAddSuite(suite, getSuite_testClassObj());
     CuSuiteAddSuite(suite, getSuite_testStringObj());
     CuSuiteAddSuite(suite, getSuite_testTupleObj());
 
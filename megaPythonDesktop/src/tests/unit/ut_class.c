@@ -0,0 +1,172 @@
+/*
+ * PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+ * Copyright 2007 Dean Hall
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * Class Object Unit Tests
+ *
+ * Tests the Class and Class Instance Object implementation.
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/06   First.
+ */
+
+
+#include "CuTest.h"
+#include "pm.h"
+
+
+/** Makes a class named "C" with the given attrs dict and no bases */
+static pPmObj_t
+ut_class_makeClass(pPmObj_t pattrs)
+{
+    uint8_t const *pcname = (uint8_t const *)"C";
+    pPmObj_t pname;
+    pPmObj_t pbases;
+    pPmObj_t pclass;
+
+    string_new(&pcname, &pname);
+    tuple_new(0, &pbases);
+    class_create((pPmString_t)pname, (pPmDict_t)pattrs, (pPmTuple_t)pbases,
+                 &pclass);
+    return pclass;
+}
+
+
+/**
+ * Tests class_setAttr() and class_getAttr():
+ *      retval is OK
+ *      the value set is the value got
+ *      instances share the class's slots, not values
+ */
+void
+ut_class_setAttr_000(CuTest *tc)
+{
+    uint8_t const *pcx = (uint8_t const *)"x";
+    pPmObj_t pattrs;
+    pPmObj_t pclass;
+    pPmObj_t pinst1;
+    pPmObj_t pinst2;
+    pPmObj_t px;
+    pPmObj_t pval;
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    dict_new(&pattrs);
+    pclass = ut_class_makeClass(pattrs);
+    class_newInstance((pPmClass_t)pclass, &pinst1);
+    class_newInstance((pPmClass_t)pclass, &pinst2);
+    string_new(&pcx, &px);
+
+    retval = class_setAttr(pinst1, px, PM_ONE);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    retval = class_setAttr(pinst2, px, PM_NEGONE);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertTrue(tc, ((pPmClass_t)pclass)->cl_slots->sl_length == 1);
+
+    retval = class_getAttr(pinst1, px, &pval);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertPtrEquals(tc, PM_ONE, pval);
+    retval = class_getAttr(pinst2, px, &pval);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertPtrEquals(tc, PM_NEGONE, pval);
+}
+
+
+/**
+ * Tests class_getAttr():
+ *      attr not in the instance is got from the class
+ *      attr in neither raises AttributeError
+ */
+void
+ut_class_getAttr_000(CuTest *tc)
+{
+    uint8_t const *pcx = (uint8_t const *)"x";
+    uint8_t const *pcy = (uint8_t const *)"y";
+    pPmObj_t pattrs;
+    pPmObj_t pclass;
+    pPmObj_t pinst;
+    pPmObj_t px;
+    pPmObj_t py;
+    pPmObj_t pval;
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    dict_new(&pattrs);
+    string_new(&pcx, &px);
+    string_new(&pcy, &py);
+    dict_setItem(pattrs, px, PM_ONE);
+    pclass = ut_class_makeClass(pattrs);
+    class_newInstance((pPmClass_t)pclass, &pinst);
+
+    retval = class_getAttr(pinst, px, &pval);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    CuAssertPtrEquals(tc, PM_ONE, pval);
+
+    retval = class_getAttr(pinst, py, &pval);
+    CuAssertTrue(tc, retval == PM_RET_EX_ATTR);
+}
+
+
+/**
+ * Tests class_delAttr():
+ *      deleting a set attr is OK and uncovers the class attr
+ *      deleting it again raises AttributeError
+ */
+void
+ut_class_delAttr_000(CuTest *tc)
+{
+    uint8_t const *pcx = (uint8_t const *)"x";
+    pPmObj_t pattrs;
+    pPmObj_t pclass;
+    pPmObj_t pinst;
+    pPmObj_t px;
+    pPmObj_t pval;
+    PmReturn_t retval;
+
+    pm_init(MEMSPACE_RAM, C_NULL);
+    dict_new(&pattrs);
+    string_new(&pcx, &px);
+    dict_setItem(pattrs, px, PM_ONE);
+    pclass = ut_class_makeClass(pattrs);
+    class_newInstance((pPmClass_t)pclass, &pinst);
+
+    class_setAttr(pinst, px, PM_NEGONE);
+    retval = class_delAttr(pinst, px);
+    CuAssertTrue(tc, retval == PM_RET_OK);
+    retval = class_getAttr(pinst, px, &pval);
+    CuAssertPtrEquals(tc, PM_ONE, pval);
+
+    retval = class_delAttr(pinst, px);
+    CuAssertTrue(tc, retval == PM_RET_EX_ATTR);
+}
+
+
+/** Make a suite from all tests in this file */
+CuSuite *getSuite_testClassObj(void)
+{
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, ut_class_setAttr_000);
+    SUITE_ADD_TEST(suite, ut_class_getAttr_000);
+    SUITE_ADD_TEST(suite, ut_class_delAttr_000);
+
+    return suite;
+}
@@ -46,6 +46,11 @@ Log
 ==========      ==============================================================
 Date            Action
 ==========      ==============================================================
+2008/03/25      #144: Add -p to pool the strs and ints code images share,
+                add co_to_parts() so ipm can send a large image in parts
+2008/03/23      #143: Add -z to compress code images
+2008/02/26      #131: Allow generator funcs
+2008/02/08      #112: Turn method calls into LOAD_METHOD/CALL_METHOD
 2006/12/01      #51: Update to Python 2.5 bytecodes
 2006/09/15      #28: Module with __NATIVE__ at root doesn't load
 2006/09/12      #2: Separate stdlib from user app
@@ -84,6 +89,11 @@ __usage__ = """USAGE:
     -s      Place native functions in the PyMite standard library (default)
     -u      Place native functions in the user library
 
+    -z      Compress each code image that gets smaller and fits in a heap
+            chunk once expanded; the VM expands it when it is imported
+    -p      Put the strings and ints the code images share in a pool
+            before the images; the images refer to them by index
+
     OPTIONS:
     --native-file=filename  If specified, pmImgCreator will write a C source
                             file with native functions from the python files.
@@ -120,6 +130,9 @@ OBJ_TYPE_CLI = 0x09     # Class instance
 OBJ_TYPE_CIM = 0x0A     # Code image
 OBJ_TYPE_NIM = 0x0B     # Native func img
 OBJ_TYPE_NOB = 0x0C     # Native func obj
+OBJ_TYPE_ZIM = 0x0F     # Compressed code image
+OBJ_TYPE_PIM = 0x1E     # Pool of the objs the images share
+OBJ_TYPE_PRF = 0x1F     # Ref to an obj in the pool
 # All types after this never appear in an image
 
 # Number of bytes from top of code img to start of consts
@@ -128,9 +141,41 @@ CO_IMG_FIXEDPART_SIZE = 6
 # Number of bytes in a native image (constant)
 NATIVE_IMG_SIZE = 4
 
+# Number of bytes from top of compressed img to the name
+# Must match ZI_NAME_FIELD in codeobj.h
+ZIM_NAME_FIELD = 5
+
+# Maximum number of bytes of a code img the device holds in a string;
+# it must fit in a heap chunk (HEAP_MAX_CHUNK_SIZE in heap.c)
+MAX_STR_IMG_LEN = 1984
+
+# Maximum number of bytes of a code img that is compressed (it is expanded
+# into a string)
+MAX_ZIM_LEN = MAX_STR_IMG_LEN
+
+# Number of bytes back a match of the compression may start
+LZ_WINDOW = 4096
+
+# Minimum and maximum number of bytes in a match of the compression
+LZ_MIN_MATCH = 3
+LZ_MAX_MATCH = 18
+
+# Flag of a generator func's code obj (Python's CO_GENERATOR)
+CO_GENERATOR = 0x20
+
+# Flag set in the argcount of a generator func's code img
+# Must match CI_GENERATOR_FLAG in codeobj.h
+CI_GENERATOR_FLAG = 0x80
+
 # Maximum number of objs in a tuple
 MAX_TUPLE_LEN = 253
 
+# Maximum number of objs in the pool (it is a tuple, refs are one byte)
+MAX_POOL_LEN = MAX_TUPLE_LEN
+
+# Number of bytes in a ref to the pool (type and index)
+POOL_REF_SIZE = 2
+
 # Maximum number of chars in a string (XXX bytes vs UTF-8 chars?)
 MAX_STRING_LEN = 999
 
@@ -196,7 +241,8 @@ UNIMPLEMENTED_BCODES = (
 #    "BREAK_LOOP",
     "WITH_CLEANUP",
 #    "LOAD_LOCALS", "RETURN_VALUE", "IMPORT_STAR", 
-    "EXEC_STMT", "YIELD_VALUE",
+    "EXEC_STMT",
+#    "YIELD_VALUE",
 #    "POP_BLOCK",
     "END_FINALLY",
 #    "BUILD_CLASS",
@@ -223,6 +269,33 @@ UNIMPLEMENTED_BCODES = (
     "CALL_FUNCTION_VAR_KW", "EXTENDED_ARG"
     )
 
+# PyMite-only bytecodes (unused by Python 2.x), must match PmBcode_e
+LOAD_METHOD = 138
+CALL_METHOD = 139
+
+# Stack use (pops, pushes) of the bytecodes that may come between
+# a LOAD_ATTR and the CALL_FUNCTION that calls the loaded attr.
+# A None entry means the number of pops is the bytecode's argument.
+# Any other bytecode stops the search for the call.
+METHOD_CALL_STACK_USE = {
+    "LOAD_CONST": (0, 1), "LOAD_NAME": (0, 1),
+    "LOAD_GLOBAL": (0, 1), "LOAD_FAST": (0, 1),
+    "LOAD_ATTR": (1, 1), "DUP_TOP": (1, 2), "GET_ITER": (1, 1),
+    "UNARY_POSITIVE": (1, 1), "UNARY_NEGATIVE": (1, 1),
+    "UNARY_NOT": (1, 1), "UNARY_INVERT": (1, 1),
+    "BINARY_POWER": (2, 1), "BINARY_MULTIPLY": (2, 1),
+    "BINARY_DIVIDE": (2, 1), "BINARY_FLOOR_DIVIDE": (2, 1),
+    "BINARY_MODULO": (2, 1), "BINARY_ADD": (2, 1),
+    "BINARY_SUBTRACT": (2, 1), "BINARY_SUBSCR": (2, 1),
+    "BINARY_LSHIFT": (2, 1), "BINARY_RSHIFT": (2, 1),
+    "BINARY_AND": (2, 1), "BINARY_XOR": (2, 1), "BINARY_OR": (2, 1),
+    "COMPARE_OP": (2, 1), "BUILD_MAP": (0, 1),
+    "SLICE+0": (1, 1), "SLICE+1": (2, 1), "SLICE+2": (2, 1),
+    "SLICE+3": (3, 1),
+    "BUILD_TUPLE": (None, 1), "BUILD_LIST": (None, 1),
+    "BUILD_SLICE": (None, 1),
+    }
+
 
 ################################################################
 # GLOBALS
@@ -262,6 +335,14 @@ class PmImgCreator:
         self._U8_to_str = chr
         self._str_to_U8 = ord
 
+        # no pool until convert_files() makes one (ipm uses co_to_str())
+        self.poolindex = {}
+        self.poolcounts = {}
+        self.poolimgs = []
+
+        # the nested code imgs made apart while co_to_parts() runs
+        self.parts = None
+
 
     def set_options(self,
                     outfn,
@@ -270,6 +351,8 @@ class PmImgCreator:
                     memspace,
                     nativeFilename,
                     infiles,
+                    compress=False,
+                    pool=False,
                    ):
         self.outfn = outfn
         self.imgtype = imgtype
@@ -277,6 +360,8 @@ class PmImgCreator:
         self.memspace = memspace
         self.nativeFilename = nativeFilename
         self.infiles = infiles
+        self.compress = compress
+        self.pool = pool
 
 ################################################################
 # CONVERSION FUNCTIONS
@@ -287,6 +372,33 @@ class PmImgCreator:
         Creates a dict whose keys are the filenames
         and values are the code object string.
         """
+        # #144: a first conversion counts the strs and ints the code objs
+        # share; the ones worth it are pooled and referred to by the second
+        self.poolindex = {}
+        self.poolcounts = {}
+        self.poolimgs = []
+        poolimg = None
+        if self.pool:
+            self._convert_infiles()
+            poolimg = self._make_pool()
+        imgs = self._convert_infiles()
+
+        # the pool leads the images
+        if poolimg:
+            imgs["fns"].insert(0, "pool")
+            imgs["imgs"].insert(0, poolimg)
+
+        # Append null terminator to list of images
+        imgs["fns"].append("null-terminator")
+        imgs["imgs"].append("\x00")
+
+        self.imgDict = imgs
+        return
+
+
+    def _convert_infiles(self,):
+        """Converts all source files, returns the image dict.
+        """
         # init image dict
         imgs = {"imgs": [], "fns": []}
 
@@ -313,14 +425,44 @@ class PmImgCreator:
             # try to compile and convert the file
             co = compile(open(fn).read(), fn, 'exec')
             imgs["fns"].append(fn)
-            imgs["imgs"].append(self.co_to_str(co))
+            img = self.co_to_str(co)
+            if self.compress:
+                img = self.compress_img(img)
+            imgs["imgs"].append(img)
 
-        # Append null terminator to list of images
-        imgs["fns"].append("null-terminator")
-        imgs["imgs"].append("\x00")
+        return imgs
 
-        self.imgDict = imgs
-        return
+
+    def _make_pool(self,):
+        """Picks the objs to pool from the counts of the last conversion.
+
+        Returns the pool image (see img_findInMem() in img.c),
+        or None if no obj is worth pooling.
+        """
+        # an obj seen n times saves n - 1 copies of it, less n refs
+        gains = []
+        for (key, n) in self.poolcounts.items():
+            if key[0] == "str":
+                size = 3 + len(key[1])
+            else:
+                size = 5
+            gain = (n - 1) * size - n * POOL_REF_SIZE
+            if gain > 0:
+                gains.append((-gain, key))
+        gains.sort()
+        keys = [key for (gain, key) in gains[:MAX_POOL_LEN]]
+        if not keys:
+            return None
+
+        # the pool holds the objs themselves, so make it before the index
+        objs = [obj for (typename, obj) in keys]
+        pooltup = self._seq_to_str(objs)
+        self.poolimgs = [self._seq_to_str((obj,))[2:] for obj in objs]
+        for i in range(len(keys)):
+            self.poolindex[keys[i]] = i
+        return self._U8_to_str(OBJ_TYPE_PIM) + \
+               self._U16_to_str(3 + len(pooltup)) + \
+               pooltup
 
 
     def _str_to_U16(self, s):
@@ -368,6 +510,15 @@ class PmImgCreator:
             obj = seq[i]
             objtype = type(obj)
 
+            # refer to the obj if it is pooled (#144), else count it
+            if objtype in (types.StringType, types.IntType):
+                key = (objtype.__name__, obj)
+                if self.poolindex.has_key(key):
+                    imgstr += _U8_to_str(OBJ_TYPE_PRF) + \
+                              _U8_to_str(self.poolindex[key])
+                    continue
+                self.poolcounts[key] = self.poolcounts.get(key, 0) + 1
+
             # if its a string
             if objtype == types.StringType:
                 # ensure string is not too long
@@ -393,7 +544,14 @@ class PmImgCreator:
                     NATIVE_INDICATOR)):
                     imgstr += self.no_to_str(obj)
                 else:
-                    imgstr += self.co_to_str(obj)
+                    coimg = self.co_to_str(obj)
+                    # a part of a large img is referred to by its index
+                    if self.parts is not None:
+                        assert len(self.parts) < MAX_POOL_LEN
+                        self.parts.append(coimg)
+                        coimg = _U8_to_str(OBJ_TYPE_PRF) + \
+                                _U8_to_str(len(self.parts) - 1)
+                    imgstr += coimg
 
             #if its a tuple
             elif objtype == types.TupleType:
@@ -419,7 +577,7 @@ class PmImgCreator:
         """
 
         # filter code object elements
-        consts, names, code, nativecode = self._filter_co(co)
+        consts, names, code, nativecode, stacksize = self._filter_co(co)
 
         # list of strings to build image
 
@@ -427,10 +585,13 @@ class PmImgCreator:
         objtype = OBJ_TYPE_CIM
 
         # skip co_type and size
-        # co_argcount
-        imgstr = self._U8_to_str(co.co_argcount)
+        # co_argcount, flagged if the co is a generator
+        argcount = co.co_argcount
+        if co.co_flags & CO_GENERATOR:
+            argcount |= CI_GENERATOR_FLAG
+        imgstr = self._U8_to_str(argcount)
         # co_stacksize
-        imgstr += self._U8_to_str(co.co_stacksize)
+        imgstr += self._U8_to_str(stacksize)
         # co_nlocals
         imgstr += self._U8_to_str(co.co_nlocals)
 
@@ -461,6 +622,113 @@ class PmImgCreator:
         return imgstr
 
 
+    def co_to_parts(self, co, maxlen=MAX_STR_IMG_LEN):
+        """Convert a Python code object to the images ipm sends for it.
+
+        Returns a list of parts and the code image.  If the code image
+        is longer than maxlen, its nested code imgs are the parts,
+        innermost first, and the code image and the parts refer to a part
+        by its index (as to a pool).  Else there are none.
+        """
+        img = self.co_to_str(co)
+        if len(img) <= maxlen:
+            return [], img
+
+        self.parts = []
+        try:
+            img = self.co_to_str(co)
+            return self.parts, img
+        finally:
+            self.parts = None
+
+
+    def compress_img(self, img):
+        """Compress a code image.
+
+        Returns the compressed image (see co_loadFromZim() in codeobj.h),
+        or the code image itself if compressing doesn't make it smaller
+        or it would not fit in the heap once expanded.
+        """
+        if len(img) > MAX_ZIM_LEN:
+            return img
+
+        # the name is the last of the names, which follow the fixed part
+        name = None
+        i = CO_IMG_FIXEDPART_SIZE + 2
+        for n in range(self._str_to_U8(img[CO_IMG_FIXEDPART_SIZE + 1])):
+            if self._str_to_U8(img[i]) == OBJ_TYPE_PRF:
+                name = self.poolimgs[self._str_to_U8(img[i + 1])]
+                i += POOL_REF_SIZE
+                continue
+            namelen = self._str_to_U16(img[i + 1:i + 3])
+            name = img[i:i + 3 + namelen]
+            i += 3 + namelen
+        if name is None:
+            return img
+
+        data = self._lz_compress(img)
+        size = ZIM_NAME_FIELD + len(name) + len(data)
+        if size >= len(img):
+            return img
+        return self._U8_to_str(OBJ_TYPE_ZIM) + \
+               self._U16_to_str(size) + \
+               self._U16_to_str(len(img)) + \
+               name + data
+
+
+    def _lz_compress(self, s):
+        """Compress a string with the scheme co_expand() expands.
+
+        Greedy LZSS: each byte starts the longest match found within
+        the window, or is a literal.  A flags byte leads each group of
+        up to eight items, a set flag (from the lsb) marks a match.
+        """
+        out = []
+        starts = {}
+        flagpos = 0
+        nitems = 8
+        i = 0
+        while i < len(s):
+            # start a new group every eight items
+            if nitems == 8:
+                flagpos = len(out)
+                out.append(0)
+                nitems = 0
+
+            # find the longest match, nearest first
+            matchlen = 0
+            dist = 0
+            for j in reversed(starts.get(s[i:i + LZ_MIN_MATCH], [])):
+                if i - j > LZ_WINDOW:
+                    break
+                n = 0
+                while (n < LZ_MAX_MATCH) and (i + n < len(s)) and \
+                      (s[j + n] == s[i + n]):
+                    n += 1
+                if n > matchlen:
+                    matchlen = n
+                    dist = i - j
+                    if n == LZ_MAX_MATCH:
+                        break
+
+            if matchlen >= LZ_MIN_MATCH:
+                out[flagpos] |= 1 << nitems
+                out.append((dist - 1) & 0xff)
+                out.append((((dist - 1) >> 4) & 0xf0) |
+                           (matchlen - LZ_MIN_MATCH))
+            else:
+                matchlen = 1
+                out.append(self._str_to_U8(s[i]))
+            nitems += 1
+
+            # remember where each string of LZ_MIN_MATCH bytes starts
+            for k in range(i, i + matchlen):
+                starts.setdefault(s[k:k + LZ_MIN_MATCH], []).append(k)
+            i += matchlen
+
+        return string.join(map(self._U8_to_str, out), "")
+
+
     def no_to_str(self, co):
         """Convert a native code object to a PyMite image.
 
@@ -469,7 +737,7 @@ class PmImgCreator:
         """
 
         # filter code object elements
-        consts, names, code, nativecode = self._filter_co(co)
+        consts, names, code, nativecode, stacksize = self._filter_co(co)
 
         # list of strings to build image
 
@@ -516,9 +784,11 @@ class PmImgCreator:
 
         Bcode filter:
             Raise NotImplementedError for an invalid bcode.
+            Turn method calls into LOAD_METHOD/CALL_METHOD and
+            grow the stack size to fit.
 
         If all is well, return the filtered consts list,
-        names list, code string and native code.
+        names list, code string, native code and stack size.
         """
 
         ## General filter
@@ -569,6 +839,20 @@ class PmImgCreator:
                 code += s[i:i+3]
                 i += 3
 
+        # Issue #112: replace the bcodes of method calls
+        calls = self._find_method_calls(code)
+        for (iload, icall) in calls:
+            code = (code[:iload] + chr(LOAD_METHOD) +
+                    code[iload + 1:icall] + chr(CALL_METHOD) +
+                    code[icall + 1:])
+
+        # each method call in progress holds one more item on the stack
+        stacksize = co.co_stacksize
+        for (iload, icall) in calls:
+            depth = len([c for c in calls if c[0] <= iload < c[1]])
+            stacksize = max(stacksize, co.co_stacksize + depth)
+        assert stacksize < 128
+
         # if the first const is a String,
         if (type(consts[0]) == types.StringType):
 
@@ -623,7 +907,65 @@ class PmImgCreator:
             names.append(co.co_name)
 
 
-        return consts, names, code, nativecode
+        return consts, names, code, nativecode, stacksize
+
+
+    def _find_method_calls(self, code):
+        """Issue #112: Find the method calls in the bcode string.
+
+        A method call is a LOAD_ATTR whose result is only used as the
+        callable of a CALL_FUNCTION with no keyword args.  The stack use
+        of each bcode after the LOAD_ATTR is followed until that call;
+        the search gives up at a jump target or an unlisted bcode.
+
+        Returns a list of (LOAD_ATTR offset, CALL_FUNCTION offset) tuples.
+        """
+
+        # decode the bcodes into (offset, name, arg) tuples
+        bcodes = []
+        i = 0
+        while i < len(code):
+            c = ord(code[i])
+            if c < dis.HAVE_ARGUMENT:
+                bcodes.append((i, dis.opname[c], None))
+                i += 1
+            else:
+                bcodes.append((i, dis.opname[c], self._str_to_U16(code[i+1:i+3])))
+                i += 3
+        labels = dis.findlabels(code)
+
+        calls = []
+        for n in range(len(bcodes)):
+            if bcodes[n][1] != "LOAD_ATTR":
+                continue
+
+            # depth is the number of items above the loaded attr
+            depth = 0
+            for (offset, name, arg) in bcodes[n + 1:]:
+                if offset in labels:
+                    break
+
+                if name == "CALL_FUNCTION":
+                    # keyword args are not supported by CALL_METHOD
+                    if arg > 0xFF:
+                        break
+                    if depth == arg:
+                        calls.append((bcodes[n][0], offset))
+                        break
+                    pops, pushes = arg + 1, 1
+                elif name in METHOD_CALL_STACK_USE:
+                    pops, pushes = METHOD_CALL_STACK_USE[name]
+                    if pops == None:
+                        pops = arg
+                else:
+                    break
+
+                # the loaded attr is used by something other than a call
+                if pops > depth:
+                    break
+                depth += pushes - pops
+
+        return calls
 
 
 ################################################################
@@ -796,7 +1138,7 @@ def parse_cmdline():
     """
     try:
         opts, args = getopt.getopt(sys.argv[1:],
-                                   "bcsuo:",
+                                   "bcsuzpo:",
                                    ["memspace=", "native-file="])
     except:
         print __usage__
@@ -808,6 +1150,8 @@ def parse_cmdline():
     memspace = "ram"
     outfn = None
     nativeFilename = None
+    compress = False
+    pool = False
     for opt in opts:
         if opt[0] == "-b":
             imgtype = ".bin"
@@ -817,6 +1161,10 @@ def parse_cmdline():
             imgtarget = "std"
         elif opt[0] == "-u":
             imgtarget = "usr"
+        elif opt[0] == "-z":
+            compress = True
+        elif opt[0] == "-p":
+            pool = True
         elif opt[0] == "--memspace":
             # Error if memspace switch given without arg
             if not opt[1] or (opt[1].lower() not in ["ram", "flash"]):
@@ -848,13 +1196,16 @@ def parse_cmdline():
         print __usage__
         sys.exit(EX_USAGE)
 
-    return outfn, imgtype, imgtarget, memspace, nativeFilename, args
+    return outfn, imgtype, imgtarget, memspace, nativeFilename, args, \
+           compress, pool
 
 
 def main():
     pic = PmImgCreator()
-    outfn, imgtyp, imgtarget, memspace, natfn, fns = parse_cmdline()
-    pic.set_options(outfn, imgtyp, imgtarget, memspace, natfn, fns)
+    outfn, imgtyp, imgtarget, memspace, natfn, fns, compress, pool = \
+        parse_cmdline()
+    pic.set_options(outfn, imgtyp, imgtarget, memspace, natfn, fns, compress,
+                    pool)
     pic.convert_files()
     pic.write_image_file()
     pic.write_native_file()
@@ -28,6 +28,10 @@
  * Log
  * ---
  *
+ * 2008/02/22   #129: The method cache is kept per VM
+ * 2008/02/14   #125: Forget the objs made while GC was held off
+ * 2008/02/08   #112: Add the method cache for LOAD_METHOD
+ * 2008/02/06   #111: Split instance attrs from the class attrs
  * 2008/01/21   First
  */
 
@@ -38,6 +42,14 @@
 #include "pm.h"
 
 
+/***************************************************************
+ * Macros
+ **************************************************************/
+
+/** Method cache of the current VM, see class_getMethod() */
+#define class_methodCache (gVmGlobal.methodCache)
+
+
 /***************************************************************
  * Functions
  **************************************************************/
@@ -58,6 +70,7 @@ class_create(pPmString_t name, pPmDict_t attrs, pPmTuple_t bases, pPmObj_t *r_po
     pclass->name = name;
     pclass->attrs = attrs;
     pclass->bases = bases;
+    pclass->cl_slots = C_NULL;
 
     return retval;
 }
@@ -84,96 +97,243 @@ class_newMethod(pPmFunc_t func, pPmClass_t self, pPmObj_t *r_pobj)
 PmReturn_t
 class_newInstance(const pPmClass_t pclass, pPmObj_t *r_pobj)
 {
-#if 1
-    uint8_t* initstr = (uint8_t*)"__init__";
-#endif
+    uint8_t const *initstr = (uint8_t const *)"__init__";
     PmReturn_t retval = PM_RET_OK;
-    pPmObj_t pobj;
-    pPmClass_t pinstance;
+    pPmInstance_t pinstance;
     pPmObj_t pkey;
     pPmObj_t pval;
-    int16_t i;
-    
+    pPmObj_t pmeth;
+
     /* don't garbage collect while we're working */
     gVmGlobal.nativeframe.nf_active = C_TRUE;
 
-    /* the instance is modeled off of it's type */
-    retval = class_create(pclass->name, pclass->attrs, pclass->bases, r_pobj);
+    /*
+     * #111: The instance starts with no attrs of its own.  Class attrs
+     * (and methods) are found through the class when they are loaded,
+     * so nothing is copied here.
+     */
+    retval = heap_getChunk(sizeof(PmInstance_t), (uint8_t **)r_pobj);
     PM_RETURN_IF_ERROR(retval);
-    pinstance = (pPmClass_t)*r_pobj;
+    pinstance = (pPmInstance_t)*r_pobj;
     OBJ_SET_TYPE(pinstance, OBJ_TYPE_CLI);
+    pinstance->cli_class = pclass;
+    pinstance->cli_vals = C_NULL;
 
-    /* we need a new dict for the class's namespace */
-    retval = dict_new(&pobj);
+    /* Run the class's initializer, if it has one */
+    retval = string_new(&initstr, &pkey);
     PM_RETURN_IF_ERROR(retval);
-    pinstance->attrs = (pPmDict_t)pobj;
-
-#if 0
-    /* make guarantees that the class was created correctly */
-    /* not really useful, b/c these are guarenteed to be true */
-    C_ASSERT(OBJ_GET_TYPE(pinstance) == OBJ_TYPE_CLI);
-    C_ASSERT(OBJ_GET_TYPE(pinstance->attrs) == OBJ_TYPE_DIC);
-    C_ASSERT(OBJ_GET_TYPE(pinstance->name) == OBJ_TYPE_STR);
-    C_ASSERT(OBJ_GET_TYPE(pinstance->bases) == OBJ_TYPE_TUP);
-#endif
-
-    /* We must convert all functions to methods here.
-     * We will iterate through every value in the attribute
-     * dict, looking for functions that should be converted
-     * to methods.
-     *
-     * pkey is the key (func name), pval is the function, and pobj is the method
-     */
-    for (i = 0; i < (pclass->attrs->d_keys->sl_length); i++)
+    retval = dict_getItem((pPmObj_t)pclass->attrs, pkey, &pval);
+    if ((retval == PM_RET_OK) && (OBJ_GET_TYPE(pval) == OBJ_TYPE_FXN))
     {
-        retval = seglist_getItem(pclass->attrs->d_keys, i, &pkey); /* Get a key */
-        PM_RETURN_IF_ERROR(retval);
-
-        retval = seglist_getItem(pclass->attrs->d_vals, i, &pval); /* Get a val */
+        retval = class_newMethod((pPmFunc_t)pval, (pPmClass_t)pinstance,
+                                 &pmeth);
         PM_RETURN_IF_ERROR(retval);
 
-        if (OBJ_GET_TYPE(pval) == OBJ_TYPE_FXN)
-        {
-            retval = class_newMethod((pPmFunc_t)pval, pinstance, &pobj);
-            PM_RETURN_IF_ERROR(retval);
-
-            C_ASSERT(pinstance->attrs != pclass->attrs);
-
-            retval = dict_setItem((pPmObj_t)pinstance->attrs, pkey, pobj);
-            PM_RETURN_IF_ERROR(retval);
-        }
-        /* Assume that shared objects remain */
-        else
-        {
-            C_ASSERT(OBJ_GET_TYPE(pval) != OBJ_TYPE_FXN);
-            retval = dict_setItem((pPmObj_t)pinstance->attrs, pkey, pval);
-            PM_RETURN_IF_ERROR(retval);
-        }
-    }
-#if 1
-    /* Run the class's initializer, if it has one */
-    retval = string_new((uint8_t const **)&initstr, &pkey);
-    PM_RETURN_IF_ERROR(retval);
-    retval = dict_getItem((pPmObj_t)pinstance->attrs, pkey, &pval);
-    if (retval == PM_RET_OK)
-    {
         /* Push the object, so it'll be TOS when __init__ returns */
         PM_PUSH((pPmObj_t)pinstance);
         /* Push the __init__, call it with no args (the self arg is implicit and added automagically) */
-        C_ASSERT(OBJ_GET_TYPE(pval) == OBJ_TYPE_MTH);
-        PM_PUSH(pval);
+        PM_PUSH(pmeth);
         /* The first arg means how many arguments are on the stack, the second means to not push the return value */
-        interp_callFunction(0, 1);
+        retval = interp_callFunction(0, 1);
     }
     /* Doesn't matter, it's fine anyway */
     else
     {
         retval = PM_RET_OK;
     }
-#endif
 
     /* Re-enable GC */
     gVmGlobal.nativeframe.nf_active = C_FALSE;
+    heap_gcEndNative();
 
     return retval;
 }
+
+
+/*
+ * Finds the slot index of the named attr in the class's slot names.
+ * Returns PM_RET_NO if no instance of the class ever had the attr.
+ */
+static PmReturn_t
+class_findSlot(pPmClass_t pclass, pPmObj_t pname, int16_t *r_indx)
+{
+    *r_indx = 0;
+    if (pclass->cl_slots == C_NULL)
+    {
+        return PM_RET_NO;
+    }
+    return seglist_findEqual(pclass->cl_slots, pname, r_indx);
+}
+
+
+PmReturn_t
+class_getAttr(pPmObj_t pinst, pPmObj_t pname, pPmObj_t *r_pobj)
+{
+    PmReturn_t retval;
+    pPmInstance_t pinstance = (pPmInstance_t)pinst;
+    pPmObj_t pval = C_NULL;
+    int16_t indx;
+
+    C_ASSERT(CLASS_IS_INSTANCE(pinst));
+
+    /* Look in the instance's own attrs */
+    retval = class_findSlot(pinstance->cli_class, pname, &indx);
+    if ((retval == PM_RET_OK)
+        && (pinstance->cli_vals != C_NULL)
+        && (indx < pinstance->cli_vals->sl_length))
+    {
+        retval = seglist_getItem(pinstance->cli_vals, indx, &pval);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    if (pval != C_NULL)
+    {
+        *r_pobj = pval;
+        return PM_RET_OK;
+    }
+
+    /* Look in the class attrs; AttributeError if it's not there either */
+    retval = dict_getItem((pPmObj_t)pinstance->cli_class->attrs, pname, &pval);
+    if (retval == PM_RET_EX_KEY)
+    {
+        PM_RAISE(retval, PM_RET_EX_ATTR);
+    }
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Bind a function to the instance as it's loaded */
+    if (OBJ_GET_TYPE(pval) == OBJ_TYPE_FXN)
+    {
+        return class_newMethod((pPmFunc_t)pval, (pPmClass_t)pinstance, r_pobj);
+    }
+
+    *r_pobj = pval;
+    return PM_RET_OK;
+}
+
+
+PmReturn_t
+class_setAttr(pPmObj_t pinst, pPmObj_t pname, pPmObj_t pval)
+{
+    PmReturn_t retval;
+    pPmInstance_t pinstance = (pPmInstance_t)pinst;
+    pPmClass_t pclass = pinstance->cli_class;
+    pSeglist_t pseglist;
+    int16_t indx;
+
+    C_ASSERT(CLASS_IS_INSTANCE(pinst));
+
+    /* Get the slot for the name, adding one to the class if needed */
+    retval = class_findSlot(pclass, pname, &indx);
+    if (retval == PM_RET_NO)
+    {
+        if (pclass->cl_slots == C_NULL)
+        {
+            retval = seglist_new(&pseglist);
+            PM_RETURN_IF_ERROR(retval);
+            pclass->cl_slots = pseglist;
+        }
+        indx = pclass->cl_slots->sl_length;
+        retval = seglist_appendItem(pclass->cl_slots, pname);
+
+        /* Instances may now hide a method cached for this class */
+        class_flushMethodCache();
+    }
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Create the instance's values on its first attr */
+    if (pinstance->cli_vals == C_NULL)
+    {
+        retval = seglist_new(&pseglist);
+        PM_RETURN_IF_ERROR(retval);
+        pinstance->cli_vals = pseglist;
+    }
+
+    /* Fill empty slots for attrs other instances added since */
+    while (pinstance->cli_vals->sl_length <= indx)
+    {
+        retval = seglist_appendItem(pinstance->cli_vals, C_NULL);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    return seglist_setItem(pinstance->cli_vals, pval, indx);
+}
+
+
+PmReturn_t
+class_delAttr(pPmObj_t pinst, pPmObj_t pname)
+{
+    PmReturn_t retval;
+    pPmInstance_t pinstance = (pPmInstance_t)pinst;
+    pPmObj_t pval = C_NULL;
+    int16_t indx;
+
+    C_ASSERT(CLASS_IS_INSTANCE(pinst));
+
+    retval = class_findSlot(pinstance->cli_class, pname, &indx);
+    if ((retval == PM_RET_OK)
+        && (pinstance->cli_vals != C_NULL)
+        && (indx < pinstance->cli_vals->sl_length))
+    {
+        retval = seglist_getItem(pinstance->cli_vals, indx, &pval);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Raise AttributeError if the instance doesn't have the attr */
+    if (pval == C_NULL)
+    {
+        PM_RAISE(retval, PM_RET_EX_ATTR);
+        return retval;
+    }
+
+    /* Empty the slot; the slot itself stays with the class */
+    return seglist_setItem(pinstance->cli_vals, C_NULL, indx);
+}
+
+
+PmReturn_t
+class_getMethod(pPmObj_t pinst, pPmObj_t pname, uint16_t site,
+                pPmObj_t *r_pfunc)
+{
+    PmReturn_t retval;
+    pPmClass_t pclass = ((pPmInstance_t)pinst)->cli_class;
+    pPmMethodCacheEntry_t pentry;
+    pPmObj_t pval;
+    int16_t indx;
+
+    C_ASSERT(CLASS_IS_INSTANCE(pinst));
+
+    /* Return the cached func if this site last resolved the same thing */
+    pentry = (pPmMethodCacheEntry_t)
+        &class_methodCache[site & (CLASS_METHOD_CACHE_SIZE - 1)];
+    if ((pentry->mc_class == pclass) && (pentry->mc_name == pname))
+    {
+        *r_pfunc = (pPmObj_t)pentry->mc_func;
+        return PM_RET_OK;
+    }
+
+    /* An instance attr of the same name would hide the class attr */
+    if (class_findSlot(pclass, pname, &indx) == PM_RET_OK)
+    {
+        return PM_RET_NO;
+    }
+
+    /* Only functions in the class attrs become methods */
+    retval = dict_getItem((pPmObj_t)pclass->attrs, pname, &pval);
+    if ((retval != PM_RET_OK) || (OBJ_GET_TYPE(pval) != OBJ_TYPE_FXN))
+    {
+        return PM_RET_NO;
+    }
+
+    pentry->mc_class = pclass;
+    pentry->mc_name = pname;
+    pentry->mc_func = (pPmFunc_t)pval;
+    *r_pfunc = pval;
+    return PM_RET_OK;
+}
+
+
+void
+class_flushMethodCache(void)
+{
+    sli_memset((uint8_t *)class_methodCache, 0, sizeof(class_methodCache));
+}
@@ -28,6 +28,8 @@
  * Log
  * ---
  *
+ * 2008/02/08   #112: Add the method cache for LOAD_METHOD
+ * 2008/02/06   #111: Split instance attrs from the class attrs
  * 2008/01/21   First.
  */
 
@@ -35,11 +37,27 @@
  * Constants
  **************************************************************/
 
+/**
+ * Number of entries in the method cache used by LOAD_METHOD.
+ * Must be a power of two.  Each entry costs three pointers of RAM.
+ */
+#ifndef CLASS_METHOD_CACHE_SIZE
+#define CLASS_METHOD_CACHE_SIZE 8
+#endif
+
 
 /***************************************************************
  * Macros
  **************************************************************/
 
+/**
+ * Returns true if the obj is a class instance.
+ * Exception objs are instances whose type was changed by set_type().
+ */
+#define CLASS_IS_INSTANCE(pobj) \
+            ((OBJ_GET_TYPE(pobj) == OBJ_TYPE_CLI) \
+             || (OBJ_GET_TYPE(pobj) == OBJ_TYPE_EXN))
+
 
 /***************************************************************
  * Types
@@ -63,9 +81,38 @@ typedef struct PmClass_s
 
     /** Parent class names */
     pPmTuple_t bases;
+
+    /**
+     * Names of the attrs stored in instances of this class.
+     * This is the key half of every instance's (split) attrs dict;
+     * an attr's index in here is its slot in each instance.
+     * C_NULL until the first instance attr is stored.
+     */
+    pSeglist_t cl_slots;
 } PmClass_t,
  *pPmClass_t;
 
+/**
+ * Class instance obj
+ *
+ * Holds only the values of the instance's own attrs, one per slot
+ * in the class's cl_slots.  An empty slot (C_NULL) is an attr this
+ * instance does not have.  Everything else, methods included,
+ * is found through the class.
+ */
+typedef struct PmInstance_s
+{
+    /** Object descriptor */
+    PmObjDesc_t od;
+
+    /** Class of this instance */
+    pPmClass_t cli_class;
+
+    /** Attr values by slot; C_NULL until the first attr is stored */
+    pSeglist_t cli_vals;
+} PmInstance_t,
+ *pPmInstance_t;
+
 /**
  * Method obj
  *
@@ -86,6 +133,26 @@ typedef struct PmMethod_s
  *pPmMethod_t;
 
 
+/**
+ * Method cache entry
+ *
+ * Remembers which function a (class, attr name) pair resolved to.
+ * Entries are indexed by call site, so each site tends to keep its own.
+ */
+typedef struct PmMethodCacheEntry_s
+{
+    /** Class of the instance the method was looked up on */
+    pPmClass_t mc_class;
+
+    /** Name of the method */
+    pPmObj_t mc_name;
+
+    /** Function found in the class attrs */
+    pPmFunc_t mc_func;
+} PmMethodCacheEntry_t,
+ *pPmMethodCacheEntry_t;
+
+
 /***************************************************************
  * Prototypes
  **************************************************************/
@@ -120,4 +187,66 @@ PmReturn_t class_newMethod(pPmFunc_t func, pPmClass_t self, pPmObj_t *r_pobj);
  */
 PmReturn_t class_newInstance(pPmClass_t pclass, pPmObj_t *r_pobj);
 
+/**
+ * Gets an attribute of a class instance.
+ *
+ * The instance's own attrs are searched first, then the class attrs.
+ * A function found in the class is returned bound to the instance
+ * as a new Method obj.
+ *
+ * @param   pinst Class instance
+ * @param   pname String obj, name of the attr
+ * @param   r_pobj Return by reference; the attr
+ * @return  Return status; AttributeError if there is no such attr
+ */
+PmReturn_t class_getAttr(pPmObj_t pinst, pPmObj_t pname, pPmObj_t *r_pobj);
+
+/**
+ * Sets an attribute of a class instance.
+ *
+ * If no instance of the class had an attr of this name before,
+ * a slot is added to the class for it.
+ *
+ * @param   pinst Class instance
+ * @param   pname String obj, name of the attr
+ * @param   pval Value of the attr
+ * @return  Return status
+ */
+PmReturn_t class_setAttr(pPmObj_t pinst, pPmObj_t pname, pPmObj_t pval);
+
+/**
+ * Deletes an attribute of a class instance.
+ *
+ * @param   pinst Class instance
+ * @param   pname String obj, name of the attr
+ * @return  Return status; AttributeError if the instance has no such attr
+ */
+PmReturn_t class_delAttr(pPmObj_t pinst, pPmObj_t pname);
+
+/**
+ * Gets the function of a method of a class instance, without binding it.
+ *
+ * Used by LOAD_METHOD so a method call needs no Method obj.
+ * The (class, name) resolution is kept in the method cache at an entry
+ * chosen by the call site.  Only functions found in the class attrs
+ * qualify; for anything else (including an attr that instances may hold
+ * themselves) PM_RET_NO is returned and class_getAttr() should be used.
+ *
+ * @param   pinst Class instance
+ * @param   pname String obj, name of the method
+ * @param   site Offset of the call site in its code
+ * @param   r_pfunc Return by reference; the function
+ * @return  PM_RET_OK if a function was found, PM_RET_NO otherwise
+ */
+PmReturn_t class_getMethod(pPmObj_t pinst, pPmObj_t pname, uint16_t site,
+                           pPmObj_t *r_pfunc);
+
+/**
+ * Empties the method cache.
+ *
+ * Must be called when the attrs of any class change, when an instance
+ * attr name is added to a class, and when the GC may free classes.
+ */
+void class_flushMethodCache(void);
+
 #endif /* __CLASS_H__ */
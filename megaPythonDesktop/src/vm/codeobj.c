@@ -28,6 +28,8 @@
  * Log
  * ---
  *
+ * 2008/03/23   #143: Add co_loadFromZim()
+ * 2008/03/09   #136: Keep the string that holds a code image in RAM
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
  * 2002/06/04   making co_names a tuple,
@@ -70,6 +72,13 @@ co_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco)
     pco->co_memspace = memspace;
     pco->co_codeimgaddr = pci;
 
+    /* An image in RAM is in the string being loaded, if any */
+    pco->co_imgstr = C_NULL;
+    if (memspace == MEMSPACE_RAM)
+    {
+        pco->co_imgstr = gVmGlobal.pimgstr;
+    }
+
     /* Load names (tuple obj) */
     *paddr = pci + CI_NAMES_FIELD;
     retval = obj_loadFromImg(memspace, paddr, &pobj);
@@ -92,6 +101,121 @@ co_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco)
 }
 
 
+/*
+ * Expands len bytes of compressed data into pdest.
+ * See co_loadFromZim() in codeobj.h for the data.
+ */
+static PmReturn_t
+co_expand(PmMemSpace_t memspace, uint8_t const **paddr,
+          uint8_t *pdest, uint16_t len)
+{
+    PmReturn_t retval = PM_RET_OK;
+    uint8_t *pstart = pdest;
+    uint8_t *pend = pdest + len;
+    uint16_t dist;
+    uint8_t flags = 0;
+    uint8_t nflags = 0;
+    uint8_t n;
+
+    while (pdest < pend)
+    {
+        /* Get the flags of the next group */
+        if (nflags == 0)
+        {
+            flags = mem_getByte(memspace, paddr);
+            nflags = 8;
+        }
+        nflags--;
+
+        /* Copy a byte */
+        if ((flags & 1) == 0)
+        {
+            *pdest++ = mem_getByte(memspace, paddr);
+        }
+
+        /* Copy bytes expanded before; they may overlap the copy */
+        else
+        {
+            dist = mem_getByte(memspace, paddr);
+            n = mem_getByte(memspace, paddr);
+            dist = (dist | ((uint16_t)(n & 0xF0) << 4)) + 1;
+            n = (n & 0x0F) + 3;
+            if ((dist > pdest - pstart) || (n > pend - pdest))
+            {
+                PM_RAISE(retval, PM_RET_EX_TYPE);
+                return retval;
+            }
+            for (; n > 0; n--)
+            {
+                *pdest = *(pdest - dist);
+                pdest++;
+            }
+        }
+        flags >>= 1;
+    }
+    return retval;
+}
+
+
+PmReturn_t
+co_loadFromZim(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco)
+{
+    PmReturn_t retval;
+    pPmString_t pstr;
+    uint8_t const *pimg;
+    uint16_t len;
+    uint8_t objid;
+    uint8_t autogc;
+    pPmObj_t pimgstr;
+
+    /* Store ptr to top of the compressed img (less type byte) */
+    uint8_t const *pzi = *paddr - 1;
+
+    /* Get size of the compressed img */
+    uint16_t size = mem_getWord(memspace, paddr);
+
+    /* Get length of the code img, skip the name to the data */
+    len = mem_getWord(memspace, paddr);
+    *paddr = pzi + ZI_NAME_FIELD + 1;
+    *paddr += mem_getWord(memspace, paddr);
+
+    /* Expand the code img into a string; the code objs keep it (#136) */
+    retval = string_alloc(len, &pstr);
+    PM_RETURN_IF_ERROR(retval);
+    retval = heap_gcPushTempRoot((pPmObj_t)pstr, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    retval = co_expand(memspace, paddr, pstr->val, len);
+    if (retval == PM_RET_OK)
+    {
+        pimg = pstr->val;
+        if (mem_getByte(MEMSPACE_RAM, &pimg) == OBJ_TYPE_CIM)
+        {
+            /*
+             * The objs are not reachable until the code obj is returned,
+             * and the expanded img leaves the heap fuller than a plain
+             * import would; hold the GC off rather than free them.
+             */
+            autogc = heap_gcGetAuto();
+            heap_gcSetAuto(C_FALSE);
+            pimgstr = gVmGlobal.pimgstr;
+            gVmGlobal.pimgstr = (pPmObj_t)pstr;
+            retval = co_loadFromImg(MEMSPACE_RAM, &pimg, r_pco);
+            gVmGlobal.pimgstr = pimgstr;
+            heap_gcSetAuto(autogc);
+        }
+        else
+        {
+            PM_RAISE(retval, PM_RET_EX_TYPE);
+        }
+    }
+    heap_gcPopTempRoot(objid);
+
+    /* Set addr to point one past end of the compressed img */
+    *paddr = pzi + size;
+    return retval;
+}
+
+
 PmReturn_t
 no_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pno)
 {
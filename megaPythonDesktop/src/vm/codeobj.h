@@ -28,6 +28,9 @@
  * Log
  * ---
  *
+ * 2008/03/23   #143: Add co_loadFromZim() for compressed code images
+ * 2008/03/09   #136: Keep the string that holds a code image in RAM
+ * 2008/02/26   #131: Flag generator code in the argcount field
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
  * 2002/06/04   making co_names a tuple,
@@ -47,6 +50,14 @@
 #define CI_NLOCALS_FIELD    5
 #define CI_NAMES_FIELD      6
 
+/** Set in the argcount field of the code image of a generator func */
+#define CI_GENERATOR_FLAG   0x80
+
+/** Compressed code image field offset consts */
+#define ZI_SIZE_FIELD       1
+#define ZI_LENGTH_FIELD     3
+#define ZI_NAME_FIELD       5
+
 /** Native code image size */
 #define NATIVE_IMAGE_SIZE   4
 
@@ -76,6 +87,8 @@ typedef struct PmCo_s
     pPmTuple_t co_consts;
     /** address in memspace of bytecode (or native function) */
     uint8_t const *co_codeaddr;
+    /** string obj that holds the code image in RAM, or C_NULL */
+    pPmObj_t co_imgstr;
 } PmCo_t,
  *pPmCo_t;
 
@@ -127,7 +140,8 @@ typedef struct PmNo_s
  *      -type:      8b - OBJ_TYPE_CIM
  *      -size:      16b - number of bytes
  *                  the code image occupies.
- *      -argcount:  8b - number of arguments to this code obj.
+ *      -argcount:  8b - number of arguments to this code obj;
+ *                  CI_GENERATOR_FLAG is set for a generator func.
  *      -stacksz:   8b - the maximum arg-stack size needed.
  *      -nlocals:   8b - number of local vars in the code obj.
  *      -names:     Tuple - tuple of string objs.
@@ -145,6 +159,44 @@ typedef struct PmNo_s
 PmReturn_t
 co_loadFromImg(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco);
 
+/**
+ * Creates a code object from a compressed code image.
+ *
+ * The code image in it is expanded into a string in the heap, and
+ * the code object is loaded from there as from any code image in RAM.
+ * The string lasts as long as the code objects loaded from it.
+ * Leaves contents of paddr pointing one byte past end of
+ * the compressed image.
+ *
+ * The compressed code image has the following structure:
+ *      -type:      8b - OBJ_TYPE_ZIM
+ *      -size:      16b - number of bytes
+ *                  the compressed image occupies.
+ *      -length:    16b - number of bytes of the code image
+ *                  once it is expanded.
+ *      -name:      String - name of the module; the last of the
+ *                  names in the code image.
+ *      -data:      8b[] - the code image, compressed.
+ *
+ * The data is a series of groups.  A group is a flags byte and up to
+ * eight items, one for each flag from the least significant bit.
+ * An item with its flag clear is a byte to copy.  An item with its flag
+ * set is two bytes, d0 and d1: copy (d1 & 0x0F) + 3 bytes, one at a
+ * time, from (d0 | (d1 & 0xF0) << 4) + 1 bytes back in the expanded
+ * image.  pmImgCreator.py -z makes compressed images.
+ *
+ * @param   memspace memory space containing image
+ * @param   paddr ptr to ptr to the byte after the type byte
+ *          return by reference: paddr points one byte
+ *          past end of the compressed image
+ * @param   r_pco Return arg.  New code object with fields
+ *          filled in.
+ * @return  Return status; PM_RET_EX_MEM if the code image doesn't fit
+ *          in a heap chunk, PM_RET_EX_TYPE if the data is not valid
+ */
+PmReturn_t
+co_loadFromZim(PmMemSpace_t memspace, uint8_t const **paddr, pPmObj_t *r_pco);
+
 /**
  * Creates a Native code object by loading a native image.
  *
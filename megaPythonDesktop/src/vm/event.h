@@ -0,0 +1,130 @@
+/*
+ * PyMite - A flyweight Python interpreter for 8-bit microcontrollers and more.
+ * Copyright 2007 David Greenberg
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+/**
+ * Event Queue
+ *
+ * Carries events from interrupt handlers (or signal handlers) to the
+ * interpreter.  An event is a small ID and an int of data.
+ *
+ * The queue is a ring buffer with one producer, the interrupt side,
+ * and one consumer, the interpreter.  Each side writes only its own
+ * index, so neither needs to lock out the other and the producer
+ * never allocates.  When the ring is full, the producer counts the
+ * event in the overflow count of its ID instead; the event still runs
+ * its callback, but its data is lost and the callback gets None.
+ *
+ * Log
+ * ---
+ *
+ * 2008/02/20   #128: First
+ */
+
+/***************************************************************
+ * Constants
+ **************************************************************/
+
+/**
+ * Number of events the ring buffer holds.
+ * Must be a power of two, at most 128.
+ */
+#ifndef EVENT_QUEUE_SIZE
+#define EVENT_QUEUE_SIZE 16
+#endif
+
+/** Number of event IDs (and callbacks); IDs are 0 to EVENT_NUM_IDS - 1 */
+#ifndef EVENT_NUM_IDS
+#define EVENT_NUM_IDS 8
+#endif
+
+
+/***************************************************************
+ * Types
+ **************************************************************/
+
+/** Event */
+typedef struct PmEvent_s
+{
+    /** Data passed to the callback */
+    int32_t ev_data;
+
+    /** ID of the event; selects the callback */
+    uint8_t ev_id;
+} PmEvent_t,
+ *pPmEvent_t;
+
+/**
+ * Event queue
+ *
+ * The indices run freely and wrap at 256; they are masked to index
+ * the buffer.  The ring is empty when they are equal.
+ */
+typedef struct PmEventQueue_s
+{
+    /** Ring buffer */
+    PmEvent_t eq_buf[EVENT_QUEUE_SIZE];
+
+    /** Index of the next event to put; written only by the producer */
+    uint8_t eq_head;
+
+    /** Index of the next event to take; written only by the consumer */
+    uint8_t eq_tail;
+
+    /** Events per ID that didn't fit in the ring; written by the producer */
+    uint8_t eq_lost[EVENT_NUM_IDS];
+
+    /** Lost events per ID dispatched; written only by the consumer */
+    uint8_t eq_lostDone[EVENT_NUM_IDS];
+} PmEventQueue_t,
+ *pPmEventQueue_t;
+
+
+/***************************************************************
+ * Prototypes
+ **************************************************************/
+
+/**
+ * Posts an event to the interpreter.
+ *
+ * Safe to call from an interrupt or signal handler (but not from two
+ * handlers that can interrupt each other).  Takes constant time,
+ * allocates nothing and requests a reschedule, at which the event is
+ * dispatched.
+ *
+ * The error is returned, not raised: the error info in the globals
+ * belongs to the interpreter this may have interrupted.
+ *
+ * @param   id ID of the event
+ * @param   data Data to pass to the callback
+ * @return  Return status; PM_RET_EX_VAL if there is no such ID
+ */
+PmReturn_t event_post(uint8_t id, int32_t data);
+
+/**
+ * Dispatches the posted events, in order, to their callbacks
+ * by calling interp_callback().  Called by the interpreter only.
+ *
+ * @return  Return status
+ */
+PmReturn_t event_dispatch(void);
+
+#endif /* __EVENT_H__ */
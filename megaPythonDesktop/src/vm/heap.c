@@ -30,6 +30,28 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: Mark the pool of an image info struct
+ * 2008/03/23   #143: A compressed img is never a heap obj, add
+ *              heap_gcGetAuto()
+ * 2008/03/19   #141: Add heap_getUsed()
+ * 2008/03/17   #140: Add heap_relocate()
+ * 2008/03/15   #139: Mark the image file a code image is in, unmap the
+ *              image files nothing marked
+ * 2008/03/09   #136: Mark the string that holds a code image in RAM
+ * 2008/02/26   #131: Mark generators
+ * 2008/02/24   #130: Mark the objs in a channel's ring
+ * 2008/02/22   #129: The heap is part of the VM instance
+ * 2008/02/20   #128: Mark the callbacks by event ID
+ * 2008/02/18   #127: Mark sync objs and the sync obj a thread waits on
+ * 2008/02/14   #125: Clear the survival marks of objs made by native code,
+ *              inside native code too when its new objs are all known,
+ *              and of the known ones when the native code returns
+ * 2008/02/12   #124: Mark a view's parent and the single-char strings
+ * 2008/02/10   #123: Add temporary roots for objs held only by C code,
+ *              the string cache no longer keeps strings alive
+ * 2008/02/08   #112: Flush the method cache on GC and init
+ * 2008/02/06   #111: Mark instance slots and values
+ * 2008/02/04   #110: Mark the module cached in an image info struct
  * 2007/05/21   #104: Design and implement garbage collection
  * 2007/02/02   #87: Redesign the heap
  * 2007/01/09   #75: Added thread type, fail correctly w/o GC (P.Adelt)
@@ -54,14 +76,6 @@
  * Constants
  **************************************************************/
 
-/**
- * Static initial size of the heap.
- * A value should be provided by the makefile
- */
-#ifndef HEAP_SIZE
-#error HEAP_SIZE not defined by the build environment
-#endif
-
 /**
  * The maximum size a chunk can be.
  * The chunk size is limited by the od_size field in the object descriptor.
@@ -77,6 +91,9 @@
 /** The minimum size a chunk can be */
 #define HEAP_MIN_CHUNK_SIZE sizeof(PmHeapDesc_t)
 
+/** The heap of the current VM */
+#define pmHeap (PM_VM->vm_heap)
+
 
 /***************************************************************
  * Macros
@@ -101,76 +118,6 @@
     while (0)
 
 
-/***************************************************************
- * Types
- **************************************************************/
-
-/**
- * The following is a diagram of the heap descriptor at the head of the chunk:
- *
- *                MSb          LSb
- *                7 6 5 4 3 2 1 0
- *      pchunk-> +-+-+-+-+-+-+-+-+
- *               |     S[9:2]    |     S := Size of the chunk (2 LSbs dropped)
- *               +-+-+-----------+     F := Chunk free bit (not in use)
- *               |F|R| S[15:10]  |     R := Bit reserved for future use
- *               +-+-+-----------+
- *               |     P(L)      |     P := hd_prev: Pointer to previous node
- *               |     P(H)      |     N := hd_next: Pointer to next node
- *               |     N(L)      |
- *               |     N(H)      |     Theoretical min size == 6
- *               +---------------+     Effective min size == 8
- *               | unused space  |     (12 on 32-bit MCUs)
- *               ...           ...
- *               | end chunk     |
- *               +---------------+
- */
-typedef struct PmHeapChunk_s
-{
-    /** Heap descriptor */
-    uint16_t hd;
-
-    /** Ptr to prev heap chunk */
-    struct PmHeapChunk_s *prev;
-
-    /** Ptr to next heap chunk */
-    struct PmHeapChunk_s *next;
-} PmHeapDesc_t,
- *pPmHeapDesc_t;
-
-typedef struct PmHeap_s
-{
-    /*
-     * WARNING: Leave 'base' field at the top of struct to increase chance
-     * of alignment when compiler doesn't recognize the aligned attribute
-     * which is specific to GCC
-     */
-    /** Global declaration of heap. */
-    uint8_t base[HEAP_SIZE];
-
-    /** Ptr to list of free chunks; sorted smallest to largest. */
-    pPmHeapDesc_t pfreelist;
-
-    /** The amount of heap space available in free list */
-    uint16_t avail;
-
-    /** Garbage collection mark value */
-    uint8_t gcval;
-
-    /** Boolean to indicate if GC should run automatically */
-    uint8_t auto_gc;
-} PmHeap_t,
- *pPmHeap_t;
-
-
-/***************************************************************
- * Globals
- **************************************************************/
-
-/** The PyMite heap */
-static PmHeap_t pmHeap;
-
-
 /***************************************************************
  * Functions
  **************************************************************/
@@ -300,11 +247,13 @@ heap_init(void)
     pmHeap.avail = HEAP_SIZE;
     pmHeap.gcval = (uint8_t)0;
     pmHeap.auto_gc = C_TRUE;
+    pmHeap.temp_root_index = (uint8_t)0;
 
     C_DEBUG_PRINT(VERBOSITY_LOW, "heap_init(), id=%p, s=%d\n",
                   pmHeap.base, HEAP_SIZE);
 
     string_cacheInit();
+    class_flushMethodCache();
 
     return PM_RET_OK;
 }
@@ -388,6 +337,17 @@ heap_getChunkImpl(uint16_t size, uint8_t **r_pchunk)
     if (gVmGlobal.nativeframe.nf_active)
     {
         OBJ_SET_GCVAL(pchunk, !pmHeap.gcval);
+
+        /* Note the chunk so the GC can mark it again after clearing marks */
+        if (gVmGlobal.nativeframe.nf_numNew < NATIVE_NUM_NEW)
+        {
+            gVmGlobal.nativeframe.nf_new[gVmGlobal.nativeframe.nf_numNew] =
+                (pPmObj_t)pchunk;
+        }
+        if (gVmGlobal.nativeframe.nf_numNew <= NATIVE_NUM_NEW)
+        {
+            gVmGlobal.nativeframe.nf_numNew++;
+        }
     }
 
     /*
@@ -467,6 +427,7 @@ PmReturn_t
 heap_freeChunk(pPmObj_t ptr)
 {
     PmReturn_t retval;
+    uint8_t i;
 
     C_DEBUG_PRINT(VERBOSITY_HIGH, "heap_freeChunk(), id=%p, s=%d\n",
                   ptr, OBJ_GET_SIZE(ptr));
@@ -475,6 +436,19 @@ heap_freeChunk(pPmObj_t ptr)
     C_ASSERT(((uint8_t *)ptr >= pmHeap.base)
              && ((uint8_t *)ptr < pmHeap.base + HEAP_SIZE));
 
+    /* Forget the chunk if it was noted as made by the native code */
+    if (gVmGlobal.nativeframe.nf_active)
+    {
+        for (i = 0; (i < gVmGlobal.nativeframe.nf_numNew)
+                    && (i < NATIVE_NUM_NEW); i++)
+        {
+            if (gVmGlobal.nativeframe.nf_new[i] == ptr)
+            {
+                gVmGlobal.nativeframe.nf_new[i] = C_NULL;
+            }
+        }
+    }
+
     /* Insert the chunk into the freelist */
     OBJ_SET_FREE(ptr, 1);
 
@@ -498,6 +472,25 @@ heap_getAvail(uint16_t *r_avail)
 }
 
 
+uint16_t
+heap_getUsed(void)
+{
+    pPmHeapDesc_t pchunk;
+
+    /* Look for the free chunk at the end of the heap */
+    for (pchunk = pmHeap.pfreelist; pchunk != C_NULL; pchunk = pchunk->next)
+    {
+        if (((uint8_t *)pchunk + OBJ_GET_SIZE(pchunk))
+            == &pmHeap.base[HEAP_SIZE])
+        {
+            return (uint16_t)((uint8_t *)pchunk - pmHeap.base)
+                   + sizeof(PmHeapDesc_t);
+        }
+    }
+    return HEAP_SIZE;
+}
+
+
 /*****************************************************************************
  * Garbage Collector
  ****************************************************************************/
@@ -542,14 +535,21 @@ heap_gcMarkObj(pPmObj_t pobj)
         case OBJ_TYPE_INT:
         case OBJ_TYPE_FLT:
         case OBJ_TYPE_NOB:
+        case OBJ_TYPE_IMF:
             OBJ_SET_GCVAL(pobj, pmHeap.gcval);
             break;
 
         case OBJ_TYPE_STR:
+            /* The string cache does not keep strings alive (#123) */
             OBJ_SET_GCVAL(pobj, pmHeap.gcval);
-#if USE_STRING_CACHE
-            retval = heap_gcMarkObj((pPmObj_t)((pPmString_t)pobj)->next);
-#endif
+
+#if USE_STRING_VIEWS
+            /* A view keeps the string holding its chars alive */
+            if (((pPmString_t)pobj)->parent != C_NULL)
+            {
+                retval = heap_gcMarkObj((pPmObj_t)((pPmString_t)pobj)->parent);
+            }
+#endif /* USE_STRING_VIEWS */
             break;
 
         case OBJ_TYPE_TUP:
@@ -599,14 +599,16 @@ heap_gcMarkObj(pPmObj_t pobj)
             retval = heap_gcMarkObj((pPmObj_t)((pPmCo_t)pobj)->co_consts);
             PM_RETURN_IF_ERROR(retval);
 
-            /* #122: Mark the code image if it is in RAM */
-            if (((pPmCo_t)pobj)->co_memspace == MEMSPACE_RAM)
+            /* #122: Mark the string that holds the code image in RAM */
+            retval = heap_gcMarkObj(((pPmCo_t)pobj)->co_imgstr);
+#ifdef TARGET_DESKTOP
+            /* #139: Mark the image file if the code image is in one */
+            if (((pPmCo_t)pobj)->co_memspace != MEMSPACE_RAM)
             {
-                /* Special case: The image is contained in a string object */
-                retval = heap_gcMarkObj((pPmObj_t)
-                                        (((pPmCo_t)pobj)->co_codeimgaddr
-                                         - sizeof(PmObjDesc_t)));
+                retval = heap_gcMarkObj(
+                    img_getFile(((pPmCo_t)pobj)->co_codeimgaddr));
             }
+#endif /* TARGET_DESKTOP */
             break;
 
         case OBJ_TYPE_MOD:
@@ -628,12 +630,27 @@ heap_gcMarkObj(pPmObj_t pobj)
                                     ((pPmFunc_t)pobj)->f_defaultargs);
             break;
 
-        case OBJ_TYPE_CLO:
         case OBJ_TYPE_CLI:
         case OBJ_TYPE_EXN:
             /* Mark the obj head */
             OBJ_SET_GCVAL(pobj, pmHeap.gcval);
 
+            /* Mark the class */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmInstance_t)pobj)->cli_class);
+            PM_RETURN_IF_ERROR(retval);
+
+            /* Mark the attr values */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmInstance_t)pobj)->cli_vals);
+            break;
+
+        case OBJ_TYPE_CLO:
+            /* Mark the obj head */
+            OBJ_SET_GCVAL(pobj, pmHeap.gcval);
+
+            /* Mark the instance attr names */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmClass_t)pobj)->cl_slots);
+            PM_RETURN_IF_ERROR(retval);
+
             /* Mark the attrs dict */
             retval = heap_gcMarkObj((pPmObj_t)((pPmClass_t)pobj)->attrs);
             PM_RETURN_IF_ERROR(retval);
@@ -652,6 +669,9 @@ heap_gcMarkObj(pPmObj_t pobj)
          */
         case OBJ_TYPE_CIM:
         case OBJ_TYPE_NIM:
+        case OBJ_TYPE_ZIM:
+        case OBJ_TYPE_PIM:
+        case OBJ_TYPE_PRF:
             PM_RAISE(retval, PM_RET_EX_SYS);
             return retval;
 
@@ -739,6 +759,42 @@ heap_gcMarkObj(pPmObj_t pobj)
 
             /* Mark the current frame */
             retval = heap_gcMarkObj((pPmObj_t)((pPmThread_t)pobj)->pframe);
+            PM_RETURN_IF_ERROR(retval);
+
+            /* Mark the sync obj it waits on */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmThread_t)pobj)->waitSync);
+            break;
+
+        case OBJ_TYPE_SYN:
+            /* Mark the obj desc */
+            OBJ_SET_GCVAL(pobj, pmHeap.gcval);
+
+            /* Mark the owner, the first waiter and a condition's lock */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmSync_t)pobj)->owner);
+            PM_RETURN_IF_ERROR(retval);
+            retval = heap_gcMarkObj((pPmObj_t)((pPmSync_t)pobj)->waitHead);
+            PM_RETURN_IF_ERROR(retval);
+            retval = heap_gcMarkObj((pPmObj_t)((pPmSync_t)pobj)->plock);
+            PM_RETURN_IF_ERROR(retval);
+
+            /* Mark the objs in a channel's ring */
+            if (((pPmSync_t)pobj)->kind == SYNC_KIND_CHAN)
+            {
+                for (i = 0; i < ((pPmChannel_t)pobj)->ch_size; i++)
+                {
+                    retval = heap_gcMarkObj(((pPmChannel_t)pobj)->ch_ring[i]);
+                    PM_RETURN_IF_ERROR(retval);
+                }
+            }
+            break;
+
+        case OBJ_TYPE_GEN:
+            /* Mark the generator obj head */
+            OBJ_SET_GCVAL(pobj, pmHeap.gcval);
+
+            /* Mark the generator's frame */
+            retval =
+                heap_gcMarkObj((pPmObj_t)((pPmGenerator_t)pobj)->gen_frame);
             break;
 
         case OBJ_TYPE_NFM:
@@ -784,6 +840,21 @@ heap_gcMarkObj(pPmObj_t pobj)
             retval = heap_gcMarkObj((pPmObj_t)((pPmImgInfo_t)pobj)->ii_name);
             PM_RETURN_IF_ERROR(retval);
 
+            /* Mark the cached module (the index nodes are all in the list) */
+            retval = heap_gcMarkObj(((pPmImgInfo_t)pobj)->ii_module);
+            PM_RETURN_IF_ERROR(retval);
+
+            /* Mark the pool of the image's set (#144) */
+            retval = heap_gcMarkObj((pPmObj_t)((pPmImgInfo_t)pobj)->ii_pool);
+            PM_RETURN_IF_ERROR(retval);
+
+#ifdef TARGET_DESKTOP
+            /* #139: Mark the image file if the image is in one */
+            retval = heap_gcMarkObj(
+                img_getFile(((pPmImgInfo_t)pobj)->ii_addr));
+            PM_RETURN_IF_ERROR(retval);
+#endif /* TARGET_DESKTOP */
+
             /* Mark the next node in the list */
             retval = heap_gcMarkObj((pPmObj_t)((pPmImgInfo_t)pobj)->next);
             break;
@@ -825,6 +896,10 @@ static PmReturn_t
 heap_gcMarkRoots(void)
 {
     PmReturn_t retval;
+    uint8_t i;
+#if USE_STRING_CHARS
+    uint16_t j;
+#endif /* USE_STRING_CHARS */
 
     /* Toggle the GC marking value so it differs from the last run */
     pmHeap.gcval ^= 1;
@@ -856,13 +931,55 @@ heap_gcMarkRoots(void)
     /* Mark the thread list */
     retval = heap_gcMarkObj((pPmObj_t)gVmGlobal.threadList);
 
-    /* Mark the callback dict */
-    retval = heap_gcMarkObj((pPmObj_t)gVmGlobal.callbacks);
+    /* Mark the callbacks */
+    for (i = 0; i < EVENT_NUM_IDS; i++)
+    {
+        retval = heap_gcMarkObj((pPmObj_t)gVmGlobal.callbacks[i]);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Mark the objs that C code is still building */
+    for (i = 0; i < pmHeap.temp_root_index; i++)
+    {
+        retval = heap_gcMarkObj(pmHeap.temp_roots[i]);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+#if USE_STRING_CHARS
+    /* Mark the single-char strings */
+    for (j = 0; j < 256; j++)
+    {
+        if (gVmGlobal.pcharstrs[j] != C_NULL)
+        {
+            retval = heap_gcMarkObj((pPmObj_t)gVmGlobal.pcharstrs[j]);
+            PM_RETURN_IF_ERROR(retval);
+        }
+    }
+#endif /* USE_STRING_CHARS */
 
     return retval;
 }
 
 
+/* Sets the mark of every chunk in use to the value of "unmarked" */
+static void
+heap_gcClearMarks(void)
+{
+    pPmObj_t pobj;
+
+    pobj = (pPmObj_t)pmHeap.base;
+    while ((uint8_t *)pobj < &pmHeap.base[HEAP_SIZE])
+    {
+        if (!OBJ_GET_FREE(pobj))
+        {
+            /* The roots marking toggles gcval, so this is "unmarked" */
+            OBJ_SET_GCVAL(pobj, pmHeap.gcval);
+        }
+        pobj = (pPmObj_t)((uint8_t *)pobj + OBJ_GET_SIZE(pobj));
+    }
+}
+
+
 /*
  * Reclaims any object that doesn't have a current mark.
  * Puts it in the free list.  Coalesces all contiguous free chunks.
@@ -983,6 +1100,8 @@ PmReturn_t
 heap_gcRun(void)
 {
     PmReturn_t retval;
+    pPmObj_t pobj;
+    uint8_t i;
 
     C_DEBUG_PRINT(VERBOSITY_LOW, "heap_gcRun()\n");
 
@@ -1004,14 +1123,104 @@ heap_gcRun(void)
         }
     }
 
+    /*
+     * Objs made by native code were marked to survive one GC cycle.
+     * Outside of native code they are reachable (or garbage) by now,
+     * so unmark them; otherwise the marking would stop at them and
+     * miss any objs they have come to refer to since.
+     * Inside native code, only the objs of the running session must
+     * keep their mark.  If they are all known, clear the marks and mark
+     * them again; they may not be filled in yet, so don't trace them.
+     */
+    if (!gVmGlobal.nativeframe.nf_active)
+    {
+        heap_gcClearMarks();
+    }
+    else if (gVmGlobal.nativeframe.nf_numNew <= NATIVE_NUM_NEW)
+    {
+        heap_gcClearMarks();
+        for (i = 0; i < gVmGlobal.nativeframe.nf_numNew; i++)
+        {
+            /* A chunk the native code has freed already was forgotten */
+            pobj = gVmGlobal.nativeframe.nf_new[i];
+            if (pobj != C_NULL)
+            {
+                OBJ_SET_GCVAL(pobj, !pmHeap.gcval);
+            }
+        }
+    }
+
     retval = heap_gcMarkRoots();
     PM_RETURN_IF_ERROR(retval);
+
+    /* Unlink the strings about to be freed from the string cache */
+    string_cacheSweep();
+
+#ifdef TARGET_DESKTOP
+    /* Unmap the image files no code obj or image info is in */
+    img_sweepFiles();
+#endif /* TARGET_DESKTOP */
+
     retval = heap_gcSweep();
 
+    /* The method cache does not keep classes alive; forget freed ones */
+    class_flushMethodCache();
+
+    return retval;
+}
+
+
+uint8_t
+heap_gcIsMarked(pPmObj_t pobj)
+{
+    return OBJ_GET_GCVAL(pobj) == pmHeap.gcval;
+}
+
+
+PmReturn_t
+heap_gcPushTempRoot(pPmObj_t pobj, uint8_t *r_objid)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    if (pmHeap.temp_root_index >= HEAP_NUM_TEMP_ROOTS)
+    {
+        PM_RAISE(retval, PM_RET_EX_MEM);
+        return retval;
+    }
+
+    *r_objid = pmHeap.temp_root_index;
+    pmHeap.temp_roots[pmHeap.temp_root_index++] = pobj;
     return retval;
 }
 
 
+void
+heap_gcPopTempRoot(uint8_t objid)
+{
+    pmHeap.temp_root_index = objid;
+}
+
+
+void
+heap_gcEndNative(void)
+{
+    pPmObj_t pobj;
+    uint8_t i;
+
+    for (i = 0; (i < gVmGlobal.nativeframe.nf_numNew) && (i < NATIVE_NUM_NEW);
+         i++)
+    {
+        /* The roots marking toggles gcval, so this is "unmarked" */
+        pobj = gVmGlobal.nativeframe.nf_new[i];
+        if (pobj != C_NULL)
+        {
+            OBJ_SET_GCVAL(pobj, pmHeap.gcval);
+        }
+    }
+    gVmGlobal.nativeframe.nf_numNew = 0;
+}
+
+
 /* Enables or disables automatic garbage collection */
 PmReturn_t
 heap_gcSetAuto(uint8_t bool)
@@ -1019,3 +1228,295 @@ heap_gcSetAuto(uint8_t bool)
     pmHeap.auto_gc = bool;
     return PM_RET_OK;
 }
+
+
+/* Returns true if automatic garbage collection is enabled */
+uint8_t
+heap_gcGetAuto(void)
+{
+    return pmHeap.auto_gc;
+}
+
+
+#if USE_HEAP_SNAPSHOT
+/****************************************************************************
+ * Relocation of a restored VM
+ ****************************************************************************/
+
+/** Where the bytes of a restored VM came from, see heap_relocate() */
+typedef struct PmReloc_s
+{
+    /** Address of the VM the bytes were copied from */
+    uint8_t const *rl_oldVm;
+
+    /** Address of a code image in the old process */
+    uint8_t const *rl_oldImg;
+
+    /** Address of the same code image now */
+    uint8_t const *rl_newImg;
+} PmReloc_t,
+ *pPmReloc_t;
+
+/** Moves the pointer in the given field of a restored VM */
+#define HEAP_RELOC(field) heap_relocPtr(prl, (uint8_t *)&(field))
+
+
+/*
+ * Moves the pointer at the given address.  The pointer is copied byte
+ * by byte, since it may be of any type.
+ */
+static void
+heap_relocPtr(pPmReloc_t prl, uint8_t *pptr)
+{
+    uint8_t const *p;
+
+    sli_memcpy((uint8_t *)&p, pptr, sizeof(p));
+    if (p == C_NULL)
+    {
+        return;
+    }
+
+    if ((p >= prl->rl_oldVm) && (p <= prl->rl_oldVm + sizeof(PmVm_t)))
+    {
+        p = (uint8_t const *)PM_VM + (p - prl->rl_oldVm);
+    }
+    else
+    {
+        p = prl->rl_newImg + (p - prl->rl_oldImg);
+    }
+    sli_memcpy(pptr, (uint8_t *)&p, sizeof(p));
+}
+
+
+/*
+ * Moves the pointers in the chunk.  Unlike heap_gcMarkObj(), every
+ * pointer is moved, not only those that keep objs alive.
+ */
+static void
+heap_relocChunk(pPmReloc_t prl, pPmObj_t pobj)
+{
+    int16_t i;
+    pPmObj_t *ppobj;
+
+    if (OBJ_GET_FREE(pobj))
+    {
+        HEAP_RELOC(((pPmHeapDesc_t)pobj)->prev);
+        HEAP_RELOC(((pPmHeapDesc_t)pobj)->next);
+        return;
+    }
+
+    switch (OBJ_GET_TYPE(pobj))
+    {
+        case OBJ_TYPE_STR:
+#if USE_STRING_CACHE
+            HEAP_RELOC(((pPmString_t)pobj)->next);
+#endif /* USE_STRING_CACHE */
+#if USE_STRING_VIEWS
+            HEAP_RELOC(((pPmString_t)pobj)->parent);
+#endif /* USE_STRING_VIEWS */
+            break;
+
+        case OBJ_TYPE_TUP:
+            for (i = 0; i < ((pPmTuple_t)pobj)->length; i++)
+            {
+                HEAP_RELOC(((pPmTuple_t)pobj)->val[i]);
+            }
+            break;
+
+        case OBJ_TYPE_LST:
+            HEAP_RELOC(((pPmList_t)pobj)->val);
+            break;
+
+        case OBJ_TYPE_DIC:
+            HEAP_RELOC(((pPmDict_t)pobj)->d_keys);
+            HEAP_RELOC(((pPmDict_t)pobj)->d_vals);
+            break;
+
+        case OBJ_TYPE_COB:
+            HEAP_RELOC(((pPmCo_t)pobj)->co_codeimgaddr);
+            HEAP_RELOC(((pPmCo_t)pobj)->co_names);
+            HEAP_RELOC(((pPmCo_t)pobj)->co_consts);
+            HEAP_RELOC(((pPmCo_t)pobj)->co_codeaddr);
+            HEAP_RELOC(((pPmCo_t)pobj)->co_imgstr);
+            break;
+
+        case OBJ_TYPE_MOD:
+        case OBJ_TYPE_FXN:
+            HEAP_RELOC(((pPmFunc_t)pobj)->f_co);
+            HEAP_RELOC(((pPmFunc_t)pobj)->f_attrs);
+            HEAP_RELOC(((pPmFunc_t)pobj)->f_globals);
+            HEAP_RELOC(((pPmFunc_t)pobj)->f_defaultargs);
+            break;
+
+        case OBJ_TYPE_CLI:
+        case OBJ_TYPE_EXN:
+            HEAP_RELOC(((pPmInstance_t)pobj)->cli_class);
+            HEAP_RELOC(((pPmInstance_t)pobj)->cli_vals);
+            break;
+
+        case OBJ_TYPE_CLO:
+            HEAP_RELOC(((pPmClass_t)pobj)->name);
+            HEAP_RELOC(((pPmClass_t)pobj)->attrs);
+            HEAP_RELOC(((pPmClass_t)pobj)->bases);
+            HEAP_RELOC(((pPmClass_t)pobj)->cl_slots);
+            break;
+
+        case OBJ_TYPE_FRM:
+            /* The stack pointer is moved last; it bounds the locals */
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_back);
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_func);
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_ip);
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_blockstack);
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_attrs);
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_globals);
+            HEAP_RELOC(((pPmFrame_t)pobj)->fo_sp);
+            for (ppobj = ((pPmFrame_t)pobj)->fo_locals;
+                 ppobj < ((pPmFrame_t)pobj)->fo_sp;
+                 ppobj++)
+            {
+                HEAP_RELOC(*ppobj);
+            }
+            break;
+
+        case OBJ_TYPE_BLK:
+            HEAP_RELOC(((pPmBlock_t)pobj)->b_sp);
+            HEAP_RELOC(((pPmBlock_t)pobj)->b_handler);
+            HEAP_RELOC(((pPmBlock_t)pobj)->next);
+            break;
+
+        case OBJ_TYPE_SEG:
+            for (i = 0; i < SEGLIST_OBJS_PER_SEG; i++)
+            {
+                HEAP_RELOC(((pSegment_t)pobj)->s_val[i]);
+            }
+            HEAP_RELOC(((pSegment_t)pobj)->next);
+            break;
+
+        case OBJ_TYPE_SGL:
+            HEAP_RELOC(((pSeglist_t)pobj)->sl_rootseg);
+            HEAP_RELOC(((pSeglist_t)pobj)->sl_lastseg);
+            break;
+
+        case OBJ_TYPE_SQI:
+            HEAP_RELOC(((pPmSeqIter_t)pobj)->si_sequence);
+            break;
+
+        case OBJ_TYPE_THR:
+            HEAP_RELOC(((pPmThread_t)pobj)->pframe);
+            HEAP_RELOC(((pPmThread_t)pobj)->next);
+            HEAP_RELOC(((pPmThread_t)pobj)->timerNext);
+            HEAP_RELOC(((pPmThread_t)pobj)->waitSync);
+            break;
+
+        case OBJ_TYPE_SYN:
+            HEAP_RELOC(((pPmSync_t)pobj)->owner);
+            HEAP_RELOC(((pPmSync_t)pobj)->waitHead);
+            HEAP_RELOC(((pPmSync_t)pobj)->plock);
+            if (((pPmSync_t)pobj)->kind == SYNC_KIND_CHAN)
+            {
+                for (i = 0; i < ((pPmChannel_t)pobj)->ch_size; i++)
+                {
+                    HEAP_RELOC(((pPmChannel_t)pobj)->ch_ring[i]);
+                }
+            }
+            break;
+
+        case OBJ_TYPE_GEN:
+            HEAP_RELOC(((pPmGenerator_t)pobj)->gen_frame);
+            break;
+
+        case OBJ_TYPE_IIS:
+            HEAP_RELOC(((pPmImgInfo_t)pobj)->ii_name);
+            HEAP_RELOC(((pPmImgInfo_t)pobj)->ii_addr);
+            HEAP_RELOC(((pPmImgInfo_t)pobj)->next);
+            HEAP_RELOC(((pPmImgInfo_t)pobj)->ii_hnext);
+            HEAP_RELOC(((pPmImgInfo_t)pobj)->ii_module);
+            HEAP_RELOC(((pPmImgInfo_t)pobj)->ii_pool);
+            break;
+
+        case OBJ_TYPE_SLC:
+            HEAP_RELOC(((pPmSlice_t)pobj)->start);
+            HEAP_RELOC(((pPmSlice_t)pobj)->end);
+            HEAP_RELOC(((pPmSlice_t)pobj)->step);
+            break;
+
+        case OBJ_TYPE_MTH:
+            HEAP_RELOC(((pPmMethod_t)pobj)->func);
+            HEAP_RELOC(((pPmMethod_t)pobj)->self);
+            break;
+
+        /* Objs with no pointers */
+        default:
+            break;
+    }
+}
+
+
+void
+heap_relocate(uint8_t const *poldvm,
+              uint8_t const *poldimg, uint8_t const *pnewimg)
+{
+    PmReloc_t rl;
+    pPmReloc_t prl = &rl;
+    pPmObj_t pobj;
+    uint16_t i;
+
+    rl.rl_oldVm = poldvm;
+    rl.rl_oldImg = poldimg;
+    rl.rl_newImg = pnewimg;
+
+    /* Move the pointers in each chunk, free or not */
+    pobj = (pPmObj_t)pmHeap.base;
+    while ((uint8_t *)pobj < &pmHeap.base[HEAP_SIZE])
+    {
+        heap_relocChunk(prl, pobj);
+        pobj = (pPmObj_t)((uint8_t *)pobj + OBJ_GET_SIZE(pobj));
+    }
+    HEAP_RELOC(pmHeap.pfreelist);
+    for (i = 0; i < pmHeap.temp_root_index; i++)
+    {
+        HEAP_RELOC(pmHeap.temp_roots[i]);
+    }
+
+    /* Move the pointers in the globals; the roots and the queues */
+    HEAP_RELOC(gVmGlobal.pnone);
+    HEAP_RELOC(gVmGlobal.pzero);
+    HEAP_RELOC(gVmGlobal.pone);
+    HEAP_RELOC(gVmGlobal.pnegone);
+    HEAP_RELOC(gVmGlobal.pcodeStr);
+    HEAP_RELOC(gVmGlobal.builtins);
+    HEAP_RELOC(gVmGlobal.pimglist);
+    for (i = 0; i < IMG_INDEX_SIZE; i++)
+    {
+        HEAP_RELOC(gVmGlobal.imgindex[i]);
+    }
+    HEAP_RELOC(gVmGlobal.threadList);
+    HEAP_RELOC(gVmGlobal.pthread);
+    for (i = 0; i < THREAD_NUM_PRIORITIES; i++)
+    {
+        HEAP_RELOC(gVmGlobal.readyHead[i]);
+        HEAP_RELOC(gVmGlobal.readyTail[i]);
+    }
+    for (i = 0; i < THREAD_TIMER_SLOTS; i++)
+    {
+        HEAP_RELOC(gVmGlobal.timerWheel[i]);
+    }
+#if USE_STRING_CACHE
+    HEAP_RELOC(gVmGlobal.pstrcache);
+#endif /* USE_STRING_CACHE */
+    for (i = 0; i < EVENT_NUM_IDS; i++)
+    {
+        HEAP_RELOC(gVmGlobal.callbacks[i]);
+    }
+#if USE_STRING_CHARS
+    for (i = 0; i < 256; i++)
+    {
+        HEAP_RELOC(gVmGlobal.pcharstrs[i]);
+    }
+#endif /* USE_STRING_CHARS */
+
+    /* The native frame was not in use; the method cache is refilled */
+    gVmGlobal.nativeframe.nf_numNew = 0;
+    class_flushMethodCache();
+}
+#endif /* USE_HEAP_SNAPSHOT */
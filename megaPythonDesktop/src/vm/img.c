@@ -29,6 +29,12 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: Load the pool that may lead an image set
+ * 2008/03/23   #143: Index compressed images by the name before their
+ *              data
+ * 2008/03/15   #139: Add img_dropOlder(), img_findInFile() and the
+ *              unmapping of unused image files
+ * 2008/02/04   #110: Hashed image index and per-image module cache
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
  * 2002/05/17   First.
@@ -53,12 +59,16 @@
  * Otherwise, it is assumed a valid image begins at that address
  * and it should be read for identification.
  * Root objects cannot be of type OBJ_TYPE_NIM (native objs).
+ * #143: An image may also be compressed, OBJ_TYPE_ZIM; it is indexed
+ * by the name before its data and expanded when it is imported.
  *
  * The name of the image is always the last entry
  * in the co_names field.  When the name is found,
  * the string is extracted, and--along with the memspace
  * and address info--is inserted into an entry in
- * the global struct which lists all modules.
+ * the global struct which lists all modules.  The entry is also
+ * pushed into its bucket of the image index so img_lookup()
+ * need not walk the whole list.
  *
  * Multiple images are obtained by scanning the memory
  * immediately following the current until the type byte
@@ -68,8 +78,8 @@
  * WARNING: Images with the same module name will be blindly inserted
  * into the image list, but only the first image found will be used.
  */
-PmReturn_t
-img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr)
+static PmReturn_t
+img_indexImgs(PmMemSpace_t memspace, uint8_t const **paddr, pPmTuple_t ppool)
 {
     PmReturn_t retval = PM_RET_ERR;
     uint8_t const *imgtop = (uint8_t const *)C_NULL;
@@ -79,6 +89,7 @@ img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr)
     pPmImgInfo_t pii = C_NULL;
     pPmObj_t pnamestr = C_NULL;
     uint8_t *pchunk;
+    uint8_t bucket;
 
     /* Addr is top of img */
     imgtop = *paddr;
@@ -87,32 +98,47 @@ img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr)
     type = (PmType_t)mem_getByte(memspace, paddr);
 
     /* Get all sequential images */
-    while (type == OBJ_TYPE_CIM)
+    while (IMG_IS_IMAGE(type))
     {
         /* Use size field to calc addr of next potential img */
         size = mem_getWord(memspace, paddr);
 
-        /* Get name of img */
-        /* Point to names tuple */
-        *paddr = imgtop + CI_NAMES_FIELD;
-
-        /* Ensure it's a tuple */
-        type = mem_getByte(memspace, paddr);
-        if (type != OBJ_TYPE_TUP)
+        /* #143: A compressed img has its name before the data */
+        if (type == OBJ_TYPE_ZIM)
         {
-            PM_RAISE(retval, PM_RET_EX_TYPE);
-            return retval;
+            *paddr = imgtop + ZI_NAME_FIELD;
+            retval = obj_loadFromImg(memspace, paddr, &pnamestr);
+            PM_RETURN_IF_ERROR(retval);
+            if (OBJ_GET_TYPE(pnamestr) != OBJ_TYPE_STR)
+            {
+                PM_RAISE(retval, PM_RET_EX_TYPE);
+                return retval;
+            }
         }
+        else
+        {
+            /* Get name of img */
+            /* Point to names tuple */
+            *paddr = imgtop + CI_NAMES_FIELD;
 
-        /* Get index of last obj in tuple */
-        n = mem_getByte(memspace, paddr) - (uint8_t)1;
+            /* Ensure it's a tuple */
+            type = mem_getByte(memspace, paddr);
+            if (type != OBJ_TYPE_TUP)
+            {
+                PM_RAISE(retval, PM_RET_EX_TYPE);
+                return retval;
+            }
 
-        /* Point to names tuple */
-        *paddr = imgtop + CI_NAMES_FIELD;
+            /* Get index of last obj in tuple */
+            n = mem_getByte(memspace, paddr) - (uint8_t)1;
 
-        /* Load name at index */
-        retval = img_getName(memspace, paddr, n, &pnamestr);
-        PM_RETURN_IF_ERROR(retval);
+            /* Point to names tuple */
+            *paddr = imgtop + CI_NAMES_FIELD;
+
+            /* Load name at index */
+            retval = img_getName(memspace, paddr, n, &pnamestr);
+            PM_RETURN_IF_ERROR(retval);
+        }
 
         /* Alloc and fill imginfo struct */
         retval = heap_getChunk(sizeof(PmImgInfo_t), &pchunk);
@@ -122,11 +148,18 @@ img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr)
         pii->ii_name = (pPmString_t)pnamestr;
         pii->ii_memspace = memspace;
         pii->ii_addr = imgtop;
+        pii->ii_module = C_NULL;
+        pii->ii_pool = ppool;
 
         /* Push struct into img stack */
         pii->next = gVmGlobal.pimglist;
         gVmGlobal.pimglist = pii;
 
+        /* Push struct into its img index bucket */
+        bucket = IMG_INDEX_BUCKET(pii->ii_name);
+        pii->ii_hnext = gVmGlobal.imgindex[bucket];
+        gVmGlobal.imgindex[bucket] = pii;
+
         /* Setup for next iteration */
         /* Calc next imgtop */
         imgtop += size;
@@ -141,6 +174,226 @@ img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr)
 }
 
 
+/*
+ * #144: An image set may start with a pool image, OBJ_TYPE_PIM:
+ * the type, the size of the pool image and a tuple of the strings
+ * and ints that the code images of the set share.  The code images
+ * refer to them by their index in the tuple (OBJ_TYPE_PRF), so each
+ * is loaded, and its string interned, only once.  The pool is kept
+ * in the image info structs of the set for when they are imported.
+ */
+PmReturn_t
+img_findInMem(PmMemSpace_t memspace, uint8_t const **paddr)
+{
+    PmReturn_t retval;
+    pPmObj_t ppool = C_NULL;
+    uint8_t const *imgtop = *paddr;
+    uint8_t objid;
+
+    /* Load the pool if the set has one */
+    if (mem_getByte(memspace, paddr) == OBJ_TYPE_PIM)
+    {
+        imgtop += mem_getWord(memspace, paddr);
+        retval = obj_loadFromImg(memspace, paddr, &ppool);
+        PM_RETURN_IF_ERROR(retval);
+        if (OBJ_GET_TYPE(ppool) != OBJ_TYPE_TUP)
+        {
+            PM_RAISE(retval, PM_RET_EX_TYPE);
+            return retval;
+        }
+    }
+    *paddr = imgtop;
+
+    /* The names of the images may be in the pool */
+    retval = heap_gcPushTempRoot(ppool, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    gVmGlobal.pimgpool = (pPmTuple_t)ppool;
+    retval = img_indexImgs(memspace, paddr, (pPmTuple_t)ppool);
+    gVmGlobal.pimgpool = C_NULL;
+    heap_gcPopTempRoot(objid);
+    return retval;
+}
+
+
+PmReturn_t
+img_lookup(pPmString_t pname, pPmImgInfo_t *r_pii)
+{
+    pPmImgInfo_t pii;
+
+    C_ASSERT(pname != C_NULL);
+
+    /* Scan only the bucket the name hashes to */
+    pii = gVmGlobal.imgindex[IMG_INDEX_BUCKET(pname)];
+    while (pii != C_NULL)
+    {
+        if (string_compare(pname, pii->ii_name) == C_SAME)
+        {
+            *r_pii = pii;
+            return PM_RET_OK;
+        }
+        pii = pii->ii_hnext;
+    }
+
+    return PM_RET_NO;
+}
+
+
+void
+img_dropOlder(pPmImgInfo_t pii)
+{
+    pPmImgInfo_t *ppii;
+
+    /* The list and the buckets hold newer images before older ones */
+    ppii = &pii->ii_hnext;
+    while (*ppii != C_NULL)
+    {
+        if (string_compare((*ppii)->ii_name, pii->ii_name) == C_SAME)
+        {
+            *ppii = (*ppii)->ii_hnext;
+        }
+        else
+        {
+            ppii = &(*ppii)->ii_hnext;
+        }
+    }
+
+    ppii = &pii->next;
+    while (*ppii != C_NULL)
+    {
+        if (string_compare((*ppii)->ii_name, pii->ii_name) == C_SAME)
+        {
+            *ppii = (*ppii)->next;
+        }
+        else
+        {
+            ppii = &(*ppii)->next;
+        }
+    }
+}
+
+
+#ifdef TARGET_DESKTOP
+PmReturn_t
+img_findInFile(uint8_t const *fn)
+{
+    PmReturn_t retval;
+    pPmImgFile_t pfile;
+    pPmImgInfo_t pii;
+    pPmImgInfo_t plast;
+    uint8_t const *pimg;
+    uint8_t *pchunk;
+    uint32_t len;
+    uint32_t i = 0;
+    uint32_t start = 0;
+    uint16_t size;
+    uint8_t objid;
+
+    retval = plat_mapFile(fn, &pimg, &len);
+    PM_RETURN_IF_ERROR(retval);
+
+    /*
+     * img_findInMem() trusts the size of each image, so see that the
+     * file has images and that they and the null terminator after them
+     * lie inside it.  #144: A pool may come before the images.
+     */
+    if ((len >= 3) && (pimg[0] == OBJ_TYPE_PIM))
+    {
+        start = (uint16_t)(pimg[1] | (pimg[2] << 8));
+        if (start < 3)
+        {
+            start = len;
+        }
+    }
+    i = start;
+    while ((i < len) && IMG_IS_IMAGE(pimg[i]))
+    {
+        size = (i + 3 <= len) ? (uint16_t)(pimg[i + 1] | (pimg[i + 2] << 8))
+                              : 0;
+        if (size < 3)
+        {
+            break;
+        }
+        i += size;
+    }
+    if ((i == start) || (i >= len) || IMG_IS_IMAGE(pimg[i]))
+    {
+        plat_unmapFile(pimg, len);
+        PM_RAISE(retval, PM_RET_EX_TYPE);
+        return retval;
+    }
+
+    /* Keep the file's place, so the GC can unmap it once it is unused */
+    retval = heap_getChunk(sizeof(PmImgFile_t), &pchunk);
+    if (retval != PM_RET_OK)
+    {
+        plat_unmapFile(pimg, len);
+        return retval;
+    }
+    pfile = (pPmImgFile_t)pchunk;
+    OBJ_SET_TYPE(pfile, OBJ_TYPE_IMF);
+    pfile->if_addr = pimg;
+    pfile->if_len = len;
+    pfile->next = gVmGlobal.pimgfiles;
+    gVmGlobal.pimgfiles = pfile;
+
+    /* Nothing in the file marks it until its first image is indexed */
+    plast = gVmGlobal.pimglist;
+    retval = heap_gcPushTempRoot((pPmObj_t)pfile, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    retval = img_findInMem(MEMSPACE_PROG, &pimg);
+    heap_gcPopTempRoot(objid);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The file's images replace the older ones of the same names */
+    for (pii = gVmGlobal.pimglist;
+         (pii != C_NULL) && (pii != plast);
+         pii = pii->next)
+    {
+        img_dropOlder(pii);
+    }
+
+    return retval;
+}
+
+
+pPmObj_t
+img_getFile(uint8_t const *paddr)
+{
+    pPmImgFile_t pfile;
+
+    for (pfile = gVmGlobal.pimgfiles; pfile != C_NULL; pfile = pfile->next)
+    {
+        if ((paddr >= pfile->if_addr)
+            && (paddr < pfile->if_addr + pfile->if_len))
+        {
+            return (pPmObj_t)pfile;
+        }
+    }
+    return C_NULL;
+}
+
+
+void
+img_sweepFiles(void)
+{
+    pPmImgFile_t volatile *ppfile = &gVmGlobal.pimgfiles;
+
+    while (*ppfile != C_NULL)
+    {
+        if (heap_gcIsMarked((pPmObj_t)*ppfile))
+        {
+            ppfile = &(*ppfile)->next;
+        }
+        else
+        {
+            plat_unmapFile((*ppfile)->if_addr, (*ppfile)->if_len);
+            *ppfile = (*ppfile)->next;
+        }
+    }
+}
+#endif /* TARGET_DESKTOP */
+
+
 PmReturn_t
 img_getName(PmMemSpace_t memspace,
             uint8_t const **paddr, uint8_t n, pPmObj_t *r_pname)
@@ -158,8 +411,15 @@ img_getName(PmMemSpace_t memspace,
     /* Scan to last name */
     for (; n > 0; n--)
     {
-        /* Ensure obj is a string */
+        /* Skip a ref to the pool (#144) */
         type = mem_getByte(memspace, paddr);
+        if (type == OBJ_TYPE_PRF)
+        {
+            (*paddr)++;
+            continue;
+        }
+
+        /* Ensure obj is a string */
         C_ASSERT(type == OBJ_TYPE_STR);
         
         /* Skip the length of the string */
@@ -167,9 +427,9 @@ img_getName(PmMemSpace_t memspace,
         (*paddr) += len;
     }
 
-    /* Ensure it's a string */
+    /* Ensure it's a string or a ref to one */
     type = mem_getByte(memspace, paddr);
-    C_ASSERT(type == OBJ_TYPE_STR);
+    C_ASSERT((type == OBJ_TYPE_STR) || (type == OBJ_TYPE_PRF));
 
     /* Backtrack paddr to point to top of string img */
     (*paddr)--;
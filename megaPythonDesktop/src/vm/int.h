@@ -27,6 +27,7 @@
  *
  * Log:
  *
+ * 2008/03/07   #135: Add int_hexByte()
  * 2007/01/09   #75: Printing support (P.Adelt)
  * 2002/05/04   First.
  */
@@ -116,6 +117,14 @@ PmReturn_t int_bitInvert(pPmObj_t pobj, pPmObj_t *r_pint);
  */
 PmReturn_t int_print(pPmObj_t pint);
 
+/**
+ * Puts the two lowercase hex digits of the byte in the buffer
+ *
+ * @param b Byte to convert
+ * @param pbuf Buffer for the two digits, most significant first
+ */
+void int_hexByte(uint8_t b, uint8_t *pbuf);
+
 /**
  * Prints the byte in ascii-coded hexadecimal out the platform output
  *
@@ -28,6 +28,26 @@
  * Log
  * ---
  *
+ * 2008/03/05   #134: Count the bytecodes, run time, preemptions and
+ *              ready-to-run waits of each thread
+ * 2008/03/03   #133: Make ready the threads whose I/O can go on when
+ *              rescheduling
+ * 2008/03/01   #132: Check for a reschedule only at backward jumps and
+ *              calls; a running thread keeps running until its slice
+ *              is over
+ * 2008/02/26   #131: Add generators: YIELD_VALUE and FOR_ITER over them
+ * 2008/02/22   #129: Keep the bytecode count per VM, look for sleepers
+ *              due when checking for preemption
+ * 2008/02/20   #128: Dispatch posted events when rescheduling
+ * 2008/02/16   #126: Wake sleeping threads, idle when no thread is ready
+ * 2008/02/14   #125: Schedule threads from priority ready queues
+ * 2008/02/12   #124: Slice strings
+ * 2008/02/10   #123: BINARY_ADD concatenates strings,
+ *              BUILD_LIST keeps the new list where the GC finds it
+ * 2008/02/08   #112: Add LOAD_METHOD and CALL_METHOD bytecodes
+ * 2008/02/06   #111: Split instance attrs from the class attrs
+ * 2008/02/04   #110: Prevent importing previously-loaded module,
+ *              forget the modules a failed thread was importing
  * 2007/04/14   #102: Implement the remaining IMPORT_ bytecodes
  * 2007/01/29   #80: Fix DUP_TOPX bytecode
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
@@ -60,6 +80,48 @@
 /** if retval is not OK, break from the interpreter */
 #define PM_BREAK_IF_ERROR(retval) if((retval) != PM_RET_OK)break
 
+#if USE_MULTI_VM
+/*
+ * The tick may go to another VM's native thread (or to none),
+ * so see for ourselves if a tick passed that may end the slice
+ * or wake a sleeper
+ */
+#define INTERP_IS_RESCHEDULE() \
+    (VM_IS_RESCHEDULE() || (gVmGlobal.timerTick != pm_timerMsTicks))
+#else
+#define INTERP_IS_RESCHEDULE() VM_IS_RESCHEDULE()
+#endif /* USE_MULTI_VM */
+
+#if USE_THREAD_STATS
+/**
+ * #134: Adds the bytecodes run since the last backward jump or call to
+ * the running thread, so the count costs a local increment per bytecode
+ */
+#define INTERP_COUNT_BYTECODES() \
+    do \
+    { \
+        gVmGlobal.pthread->bcCount += bcCount; \
+        bcCount = 0; \
+    } \
+    while (0)
+#else
+#define INTERP_COUNT_BYTECODES()
+#endif /* USE_THREAD_STATS */
+
+/**
+ * #132: Reschedules if asked to.  Only done at backward jumps and after
+ * calls, since a thread can only loop or block there; a long run of
+ * other bytecodes always ends in one of those.
+ * Sets retval, which the caller breaks on if it is not OK.
+ */
+#define INTERP_CHECK_RESCHEDULE() \
+    do \
+    { \
+        INTERP_COUNT_BYTECODES(); \
+        retval = INTERP_IS_RESCHEDULE() ? interp_reschedule() : PM_RET_OK; \
+    } \
+    while (0)
+
 
 /***************************************************************
  * Prototypes
@@ -84,10 +146,10 @@ interpret(const uint8_t returnOnNoThreads)
     int16_t t16 = 0;
     int8_t t8 = 0;
     uint8_t bc;
-
-#if INTERP_PREEMPTIVE_MULTITASKING == 1
-    static uint8_t bcExecCount = 0;
-#endif /* INTERP_PREEMPTIVE_MULTITASKING */
+    uint8_t objid;
+#if USE_THREAD_STATS
+    uint32_t bcCount = 0;
+#endif /* USE_THREAD_STATS */
 
     /* Activate a thread the first time */
     retval = interp_reschedule();
@@ -98,12 +160,18 @@ interpret(const uint8_t returnOnNoThreads)
     {
         if (gVmGlobal.pthread == C_NULL)
         {
-            if (returnOnNoThreads)
+            if (returnOnNoThreads && (gVmGlobal.threadList->length == 0))
             {
                 /* User chose to return on no threads left */
                 return retval;
             }
 
+            /*
+             * No thread is ready, so let the platform idle until an
+             * interrupt (such as the tick that wakes a sleeping thread)
+             */
+            plat_idle();
+
             /*
              * Without a frame there is nothing to execute, so reschedule
              * (possibly activating a recently added thread).
@@ -113,27 +181,11 @@ interpret(const uint8_t returnOnNoThreads)
             continue;
         }
 
-#if INTERP_PREEMPTIVE_MULTITASKING == 1
-        bcExecCount++;
-        bcExecCount %= INTERP_PREEMPT_COUNT;
-        /* If we've executed the right number of threads and others are waiting */
-        if ((bcExecCount == 0) && (gVmGlobal.threadList->length > 1))
-        {
-            /* Set the reschedule flag to true */
-            VM_SET_RESCHEDULE(1);
-        }
-#endif /* INTERP_PREEMPTIVE_MULTITASKING */
-
-        /* Reschedule threads if flag is true?*/
-        if (VM_IS_RESCHEDULE())
-        {
-printf("####RESCHEDULING####\n");
-            retval = interp_reschedule();
-            PM_BREAK_IF_ERROR(retval);
-        }
-
         /* Get byte; the func post-incrs IP */
         bc = mem_getByte(MS, &IP);
+#if USE_THREAD_STATS
+        bcCount++;
+#endif /* USE_THREAD_STATS */
 
 #if 0
 printf("bytecode = %u\n",bc);
@@ -269,6 +321,12 @@ if (bc == LOAD_ATTR)
                 /* Get the sequence from the top of stack */
                 pobj1 = TOS;
 
+                /* #131: A generator is its own iterator */
+                if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_GEN)
+                {
+                    continue;
+                }
+
                 /* Convert sequence to sequence-iterator */
                 retval = seqiter_new(pobj1, &pobj2);
                 PM_BREAK_IF_ERROR(retval);
@@ -386,6 +444,19 @@ if (bc == LOAD_ATTR)
                     continue;
                 }
 
+                /* If both objs are strings, concatenate them */
+                if ((OBJ_GET_TYPE(TOS) == OBJ_TYPE_STR)
+                    && (OBJ_GET_TYPE(TOS1) == OBJ_TYPE_STR))
+                {
+                    /* Leave the strings on the stack in case the GC runs */
+                    retval = string_concat((pPmString_t)TOS1,
+                                           (pPmString_t)TOS, &pobj3);
+                    PM_BREAK_IF_ERROR(retval);
+                    SP--;
+                    TOS = pobj3;
+                    continue;
+                }
+
                 /* Otherwise raise a TypeError */
                 PM_RAISE(retval, PM_RET_EX_TYPE);
                 break;
@@ -435,7 +506,15 @@ if (bc == LOAD_ATTR)
 
                     else if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_SLC)
                     {
-                        if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_LST)
+                        if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_STR)
+                        {
+                            retval = string_getSlice(pobj2,
+                                (int16_t)((pPmSlice_t)pobj1)->start->val,
+                                (int16_t)((pPmSlice_t)pobj1)->end->val,
+                                (int16_t)((pPmSlice_t)pobj1)->step->val,
+                                &pobj3);
+                        }
+                        else if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_LST)
                         {
                             list_getSlice(pobj2, ((pPmSlice_t)pobj1)->start->val, ((pPmSlice_t)pobj1)->end->val, ((pPmSlice_t)pobj1)->step->val, &pobj3);
                         }
@@ -515,7 +594,14 @@ if (bc == LOAD_ATTR)
                 }
 
                 /* create and push slice */
-                if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_LST)
+                if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_STR)
+                {
+                    retval = string_getSlice(pobj2,
+                                             (int16_t)((pPmInt_t)pobj1)->val,
+                                             ((pPmString_t)pobj2)->length,
+                                             1, &pobj3);
+                }
+                else if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_LST)
                 {
                     retval = list_getSlice(pobj2, ((pPmInt_t)pobj1)->val, ((pPmList_t)pobj2)->length, 1, &pobj3);
                 }
@@ -551,7 +637,13 @@ if (bc == LOAD_ATTR)
                 }
 
                 /* create and push slice */
-                if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_LST)
+                if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_STR)
+                {
+                    retval = string_getSlice(pobj2, 0,
+                                             (int16_t)((pPmInt_t)pobj1)->val,
+                                             1, &pobj3);
+                }
+                else if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_LST)
                 {
                     retval = list_getSlice(pobj2, 0, ((pPmInt_t)pobj1)->val, 1, &pobj3);
                 }
@@ -594,7 +686,14 @@ if (bc == LOAD_ATTR)
                 }
 
                 /* create and push slice */
-                if (OBJ_GET_TYPE(pobj3) == OBJ_TYPE_LST)
+                if (OBJ_GET_TYPE(pobj3) == OBJ_TYPE_STR)
+                {
+                    retval = string_getSlice(pobj3,
+                                             (int16_t)((pPmInt_t)pobj2)->val,
+                                             (int16_t)((pPmInt_t)pobj1)->val,
+                                             1, &pobj4);
+                }
+                else if (OBJ_GET_TYPE(pobj3) == OBJ_TYPE_LST)
                 {
                     retval = list_getSlice(pobj3, ((pPmInt_t)pobj2)->val, ((pPmInt_t)pobj1)->val, 1, &pobj4);
                 }
@@ -1061,6 +1160,20 @@ if (bc == LOAD_ATTR)
                 /* Otherwise return to previous frame */
                 FP = FP->fo_back;
 
+                /*
+                 * #131: A generator that returns is done.  Its value is
+                 * dropped and the FOR_ITER that ran it is run again,
+                 * which now ends the loop.
+                 */
+                if (((pPmFrame_t)pobj1)->fo_isGen)
+                {
+                    C_ASSERT(OBJ_GET_TYPE(TOS) == OBJ_TYPE_GEN);
+                    ((pPmGenerator_t)TOS)->gen_frame = C_NULL;
+                    IP -= 3;
+                    PM_BREAK_IF_ERROR(heap_freeChunk(pobj1));
+                    continue;
+                }
+
                 /*
                  * Push frame's return val, except if the expiring frame
                  * was due to an special in-vm call
@@ -1074,6 +1187,25 @@ if (bc == LOAD_ATTR)
                 PM_BREAK_IF_ERROR(heap_freeChunk(pobj1));
                 continue;
 
+            case YIELD_VALUE:
+                /* Raise SystemError if the generator was not run by FOR_ITER */
+                if (!FP->fo_isGen || (FP->fo_back == C_NULL))
+                {
+                    PM_RAISE(retval, PM_RET_EX_SYS);
+                    break;
+                }
+
+                /* The value of the yield expression is None */
+                pobj2 = PM_POP();
+                PM_PUSH(PM_NONE);
+
+                /* Suspend the generator's frame and give the item to FOR_ITER */
+                pobj1 = (pPmObj_t)FP;
+                FP = FP->fo_back;
+                ((pPmFrame_t)pobj1)->fo_back = C_NULL;
+                PM_PUSH(pobj2);
+                continue;
+
             case IMPORT_STAR:
                 /* #102: Implement the remaining IMPORT_ bytecodes */
                 /* Expect a module on the top of the stack */
@@ -1247,6 +1379,31 @@ if (bc == LOAD_ATTR)
                 t16 = GET_ARG();
                 pobj1 = TOS;
 
+                /* #131: Run a generator's frame until it yields or returns */
+                if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_GEN)
+                {
+                    pobj2 = (pPmObj_t)((pPmGenerator_t)pobj1)->gen_frame;
+
+                    /* If the generator returned, pop it and exit the loop */
+                    if (pobj2 == C_NULL)
+                    {
+                        pobj1 = PM_POP();
+                        IP += t16;
+                        continue;
+                    }
+
+                    /* Raise ValueError if the generator is already running */
+                    if (((pPmFrame_t)pobj2)->fo_back != C_NULL)
+                    {
+                        PM_RAISE(retval, PM_RET_EX_VAL);
+                        break;
+                    }
+
+                    ((pPmFrame_t)pobj2)->fo_back = FP;
+                    FP = (pPmFrame_t)pobj2;
+                    continue;
+                }
+
                 /* Get the next item in the sequence iterator */
                 retval = seqiter_getNext(pobj1, &pobj2);
 
@@ -1269,6 +1426,19 @@ if (bc == LOAD_ATTR)
                 /* Get names index */
                 t16 = GET_ARG();
 
+                /* #111: Instance attrs are kept in the instance's slots */
+                if (CLASS_IS_INSTANCE(TOS))
+                {
+                    /* Leave obj and val on the stack so the GC sees them */
+                    retval = class_setAttr(TOS,
+                                           FP->fo_func->f_co->co_names->val[t16],
+                                           TOS1);
+                    PM_BREAK_IF_ERROR(retval);
+                    pobj1 = PM_POP();
+                    pobj1 = PM_POP();
+                    continue;
+                }
+
                 /* Get obj */
                 pobj1 = PM_POP();
 
@@ -1282,9 +1452,7 @@ if (bc == LOAD_ATTR)
                 {
                     pobj2 = (pPmObj_t)((pPmMethod_t)pobj1)->func->f_attrs;
                 }
-                else if ((OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
-                         || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLI)
-                         || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_EXN))
+                else if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
                 {
                     pobj2 = (pPmObj_t)((pPmClass_t)pobj1)->attrs;
                 }
@@ -1305,6 +1473,12 @@ if (bc == LOAD_ATTR)
                 /* Get name/key obj */
                 pobj3 = FP->fo_func->f_co->co_names->val[t16];
 
+                /* #112: A class attr may replace a cached method */
+                if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
+                {
+                    class_flushMethodCache();
+                }
+
                 /* Set key=val in obj's dict */
                 retval = dict_setItem(pobj2, pobj3, PM_POP());
                 PM_BREAK_IF_ERROR(retval);
@@ -1319,6 +1493,15 @@ if (bc == LOAD_ATTR)
                 /* Get obj */
                 pobj1 = PM_POP();
 
+                /* #111: Instance attrs are kept in the instance's slots */
+                if (CLASS_IS_INSTANCE(pobj1))
+                {
+                    retval = class_delAttr(pobj1,
+                                           FP->fo_func->f_co->co_names->val[t16]);
+                    PM_BREAK_IF_ERROR(retval);
+                    continue;
+                }
+
                 /* Get attrs dict from obj */
                 if ((OBJ_GET_TYPE(pobj1) == OBJ_TYPE_FXN)
                     || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_MOD))
@@ -1329,9 +1512,7 @@ if (bc == LOAD_ATTR)
                 {
                     pobj2 = (pPmObj_t)((pPmMethod_t)pobj1)->func->f_attrs;
                 }
-                else if ((OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
-                         || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLI)
-                         || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_EXN))
+                else if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
                 {
                     pobj2 = (pPmObj_t)((pPmClass_t)pobj1)->attrs;
                 }
@@ -1353,6 +1534,12 @@ if (bc == LOAD_ATTR)
                 /* Get name/key obj */
                 pobj3 = FP->fo_func->f_co->co_names->val[t16];
 
+                /* #112: A class attr may remove a cached method */
+                if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
+                {
+                    class_flushMethodCache();
+                }
+
                 /* Remove key in obj's dict */
                 retval = dict_removeItem(pobj2, pobj3);
                 PM_BREAK_IF_ERROR(retval);
@@ -1471,19 +1658,25 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 t16 = GET_ARG();
                 retval = list_new(&pobj1);
                 PM_BREAK_IF_ERROR(retval);
-                for (; --t16 >= 0;)
-                {
-                    /* Get obj */
-                    pobj2 = PM_POP();
 
-                    /* Insert obj into list */
-                    retval = list_insert(pobj1, 0, pobj2);
+                /*
+                 * Append the objs from the deepest (first) one up, leaving
+                 * them on the stack and the list in a temp root so the GC
+                 * finds them all while the list grows
+                 */
+                retval = heap_gcPushTempRoot(pobj1, &objid);
+                PM_BREAK_IF_ERROR(retval);
+                for (; t16 > 0; t16--)
+                {
+                    retval = list_append(pobj1, STACK(t16 - 1));
                     PM_BREAK_IF_ERROR(retval);
                 }
+                heap_gcPopTempRoot(objid);
                 /* Test again outside for loop */
                 PM_BREAK_IF_ERROR(retval);
 
-                /* push list onto stack */
+                /* Replace the objs with the list */
+                SP -= ((pPmList_t)pobj1)->length;
                 PM_PUSH(pobj1);
                 continue;
 
@@ -1495,9 +1688,39 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 PM_PUSH(pobj1);
                 continue;
 
+            case LOAD_METHOD:
             case LOAD_ATTR:
                 t16 = GET_ARG();
 
+                /* #111: Instance attrs, then class attrs; binds methods */
+                if (CLASS_IS_INSTANCE(TOS))
+                {
+                    pobj3 = FP->fo_func->f_co->co_names->val[t16];
+
+                    /* #112: Push func and self; no Method obj is made */
+                    if ((bc == LOAD_METHOD)
+                        && (class_getMethod(TOS, pobj3,
+                                            (uint16_t)(IP - FP->fo_func->f_co->co_codeaddr),
+                                            &pobj4) == PM_RET_OK))
+                    {
+                        pobj1 = TOS;
+                        TOS = pobj4;
+                        PM_PUSH(pobj1);
+                        continue;
+                    }
+
+                    retval = class_getAttr(TOS, pobj3, &pobj4);
+                    PM_BREAK_IF_ERROR(retval);
+                    TOS = pobj4;
+
+                    /* #112: Not a method; an empty self tells CALL_METHOD */
+                    if (bc == LOAD_METHOD)
+                    {
+                        PM_PUSH(C_NULL);
+                    }
+                    continue;
+                }
+
                 /* Get obj that has the attrs */
                 pobj1 = PM_POP();
 
@@ -1511,9 +1734,7 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 {
                     pobj2 = (pPmObj_t)((pPmMethod_t)pobj1)->func->f_attrs;
                 }
-                else if ((OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
-                         || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLI)
-                         || (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_EXN))
+                else if (OBJ_GET_TYPE(pobj1) == OBJ_TYPE_CLO)
                 {
                     pobj2 = (pPmObj_t)((pPmClass_t)pobj1)->attrs;
                 }
@@ -1539,6 +1760,12 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 retval = dict_getItem(pobj2, pobj3, &pobj4);
                 PM_BREAK_IF_ERROR(retval);
                 PM_PUSH(pobj4);
+
+                /* #112: Not a method; an empty self tells CALL_METHOD */
+                if (bc == LOAD_METHOD)
+                {
+                    PM_PUSH(C_NULL);
+                }
                 continue;
 
             case COMPARE_OP:
@@ -1649,7 +1876,13 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 pobj3 = TOS;
                 C_ASSERT(obj_compare(pobj3, PM_NEGONE) == C_SAME);
 
-                /* TODO #110: Prevent importing previously-loaded module */
+                /* #110: A previously-loaded module is not run again */
+                if (mod_lookup(pobj1, &pobj2) == PM_RET_OK)
+                {
+                    TOS = pobj2;
+                    continue;
+                }
+
                 /* Load module from image */
                 retval = mod_import(pobj1, &pobj2);
                 PM_BREAK_IF_ERROR(retval);
@@ -1712,6 +1945,8 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
 
                 /* Jump to base_ip + arg */
                 IP = FP->fo_func->f_co->co_codeaddr + t16;
+                INTERP_CHECK_RESCHEDULE();
+                PM_BREAK_IF_ERROR(retval);
                 continue;
 
             case FOR_LOOP:
@@ -1872,8 +2107,7 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 PM_PUSH(pobj1);
 
                 /* Get the exception's code attr */
-                retval = dict_getItem((pPmObj_t)((pPmClass_t)pobj1)->attrs,
-                                      PM_CODE_STR, &pobj2);
+                retval = class_getAttr(pobj1, PM_CODE_STR, &pobj2);
                 PM_BREAK_IF_ERROR(retval);
 
                 /* Raise exception by breaking with retval set to code */
@@ -1885,6 +2119,36 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
                 t16 = GET_ARG();
                 retval = interp_callFunction(t16, 0);
                 PM_BREAK_IF_ERROR(retval);
+                INTERP_CHECK_RESCHEDULE();
+                PM_BREAK_IF_ERROR(retval);
+                continue;
+
+            case CALL_METHOD:
+                /*
+                 * #112: Stack is func, self, args... after a method was
+                 * found by LOAD_METHOD, otherwise it is callable, C_NULL,
+                 * args...  The self becomes the first arg of the func.
+                 */
+                t16 = GET_ARG();
+                if (STACK(t16) != C_NULL)
+                {
+                    retval = interp_callFunction(t16 + 1, 0);
+                    PM_BREAK_IF_ERROR(retval);
+                    INTERP_CHECK_RESCHEDULE();
+                    PM_BREAK_IF_ERROR(retval);
+                    continue;
+                }
+
+                /* Remove the empty self by moving the args down over it */
+                for (t8 = (int8_t)t16; t8 > 0; t8--)
+                {
+                    STACK(t8) = STACK(t8 - 1);
+                }
+                pobj1 = PM_POP();
+                retval = interp_callFunction(t16, 0);
+                PM_BREAK_IF_ERROR(retval);
+                INTERP_CHECK_RESCHEDULE();
+                PM_BREAK_IF_ERROR(retval);
                 continue;
 
             case MAKE_FUNCTION:
@@ -1989,12 +2253,30 @@ printf("key = ");obj_print(pobj1,0);printf("\n");
          * current thread and reschedule.
          */
 
+        /*
+         * #110: The error ends the thread, so the modules it was importing
+         * never finish; don't keep them for later imports
+         */
+        if (retval != PM_RET_OK)
+        {
+            for (pobj1 = (pPmObj_t)FP; pobj1 != C_NULL;
+                 pobj1 = (pPmObj_t)((pPmFrame_t)pobj1)->fo_back)
+            {
+                pobj2 = (pPmObj_t)((pPmFrame_t)pobj1)->fo_func;
+                if (OBJ_GET_TYPE(pobj2) == OBJ_TYPE_MOD)
+                {
+                    mod_forget(pobj2);
+                }
+            }
+        }
+
         /* If this is the last thread, return the error code */
         if ((gVmGlobal.threadList->length <= 1) && (retval != PM_RET_OK))
         {
             break;
         }
 
+        INTERP_COUNT_BYTECODES();
         retval = list_remove((pPmObj_t)gVmGlobal.threadList,
                              (pPmObj_t)gVmGlobal.pthread);
         gVmGlobal.pthread = C_NULL;
@@ -2011,34 +2293,53 @@ PmReturn_t
 interp_reschedule(void)
 {
     PmReturn_t retval = PM_RET_OK;
-    static uint8_t threadIndex = (uint8_t)0;
-    pPmObj_t pobj;
-    
+    pPmThread_t pthread = gVmGlobal.pthread;
+
     /* If we are in atomic mode, return without doing anything if there's a thread running */
-    if (VM_IS_ATOMIC() && gVmGlobal.pthread != C_NULL)
+    if (VM_IS_ATOMIC() && (pthread != C_NULL)
+        && (pthread->state == THREAD_STATE_RUNNING))
     {
         return retval;
     }
 
-    /* If there are no threads in the runnable list, null the active thread */
-    if (gVmGlobal.threadList->length == 0)
-    {
-        gVmGlobal.pthread = C_NULL;
-    }
+    /* Start the callbacks of events posted by interrupts (#128) */
+    retval = event_dispatch();
+    PM_RETURN_IF_ERROR(retval);
 
-    /* Otherwise, get the next thread in the list (round robin) */
-    else
+    /* Make ready the sleeping threads whose time has come (#126) */
+    thread_wakeSleepers();
+
+    /* And those whose I/O can go on (#133) */
+    plat_pollIo();
+
+    /* A running thread goes to the back of its ready queue (#125) */
+    if ((pthread != C_NULL) && (pthread->state == THREAD_STATE_RUNNING))
     {
-        if (++threadIndex >= gVmGlobal.threadList->length)
+        /* It keeps running until its slice is over or it is outranked */
+        if (!THREAD_IS_SLICE_OVER()
+            && !THREAD_IS_READY_FROM(pthread->priority + 1))
         {
-            threadIndex = (uint8_t)0;
+            VM_SET_RESCHEDULE(0);
+            return retval;
         }
-        retval = list_getItem((pPmObj_t)gVmGlobal.threadList, threadIndex, 
-                              &pobj);
-        gVmGlobal.pthread = (pPmThread_t)pobj;
-        PM_RETURN_IF_ERROR(retval);
+        thread_makeReady(pthread);
     }
 
+    /* Run the first of the highest priority ready threads, if any */
+    pthread = thread_takeReady();
+    if (pthread != C_NULL)
+    {
+        pthread->state = THREAD_STATE_RUNNING;
+        gVmGlobal.sliceEnd = pm_timerMsTicks + pthread->sliceMs;
+    }
+#if USE_THREAD_STATS
+    if (pthread != gVmGlobal.pthread)
+    {
+        thread_countSwitch(gVmGlobal.pthread, pthread);
+    }
+#endif /* USE_THREAD_STATS */
+    gVmGlobal.pthread = pthread;
+
     /* Clear flag to indicate a reschedule has occurred */
     VM_SET_RESCHEDULE(0);
     return retval;
@@ -2046,39 +2347,101 @@ interp_reschedule(void)
 
 PmReturn_t
 interp_addThread(pPmFunc_t pfunc)
+{
+    return interp_addThreadPrio(pfunc, THREAD_PRIORITY_DEFAULT);
+}
+
+/* Runs a new thread on the frame at the given priority */
+static PmReturn_t
+interp_startThread(pPmObj_t pframe, uint8_t priority)
 {
     PmReturn_t retval;
-    pPmObj_t pframe;
     pPmObj_t pthread;
+    uint8_t objid;
 
-    /* Create a frame for the func */
-    retval = frame_new((pPmObj_t)pfunc, &pframe);
+    /* Create a thread with this new frame, keeping the frame if the GC runs */
+    retval = heap_gcPushTempRoot(pframe, &objid);
     PM_RETURN_IF_ERROR(retval);
-
-    /* Create a thread with this new frame */
     retval = thread_new(pframe, &pthread);
+    heap_gcPopTempRoot(objid);
     PM_RETURN_IF_ERROR(retval);
+    ((pPmThread_t)pthread)->priority = priority;
 
     /* Add thread to end of list */
-    return list_append((pPmObj_t)gVmGlobal.threadList, pthread);
+    retval = heap_gcPushTempRoot(pthread, &objid);
+    PM_RETURN_IF_ERROR(retval);
+    retval = list_append((pPmObj_t)gVmGlobal.threadList, pthread);
+    heap_gcPopTempRoot(objid);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Queue it to run */
+    thread_makeReady((pPmThread_t)pthread);
+    return retval;
 }
 
 PmReturn_t
-interp_callback(int32_t key)
+interp_addThreadPrio(pPmFunc_t pfunc, uint8_t priority)
 {
     PmReturn_t retval;
-    pPmObj_t pkey, pobj;
+    pPmObj_t pframe;
+
+    /* Raise ValueError if there is no such priority */
+    if (priority >= THREAD_NUM_PRIORITIES)
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
 
-    /* Make temp key */
-    retval = int_new(key, &pkey);
+    /* Create a frame for the func */
+    retval = frame_new((pPmObj_t)pfunc, &pframe);
     PM_RETURN_IF_ERROR(retval);
 
-    /* Get callback function */
-    retval = dict_getItem((pPmObj_t)gVmGlobal.callbacks, pkey, &pobj);
+    return interp_startThread(pframe, priority);
+}
+
+PmReturn_t
+interp_callback(uint8_t id, int32_t data, uint8_t isLost)
+{
+    PmReturn_t retval;
+    pPmFunc_t pfunc;
+    pPmObj_t pframe;
+    pPmObj_t pdata;
+    uint8_t const *paddr;
+    uint8_t objid;
+
+    C_ASSERT(id < EVENT_NUM_IDS);
+
+    /* An event without a callback is dropped */
+    pfunc = gVmGlobal.callbacks[id];
+    if (pfunc == C_NULL)
+    {
+        return PM_RET_OK;
+    }
+
+    /* Create a frame for the callback */
+    retval = frame_new((pPmObj_t)pfunc, &pframe);
     PM_RETURN_IF_ERROR(retval);
 
-    /* Enqueue callback */
-    return interp_addThread((pPmFunc_t)pobj);
+    /* A callback that takes an arg gets the event's data, or None if lost */
+    paddr = pfunc->f_co->co_codeimgaddr + CI_ARGCOUNT_FIELD;
+    if ((OBJ_GET_TYPE(pfunc->f_co) == OBJ_TYPE_COB)
+        && ((mem_getByte(pfunc->f_co->co_memspace, &paddr)
+             & ~CI_GENERATOR_FLAG) > 0))
+    {
+        pdata = PM_NONE;
+        if (!isLost)
+        {
+            retval = heap_gcPushTempRoot(pframe, &objid);
+            PM_RETURN_IF_ERROR(retval);
+            retval = int_new(data, &pdata);
+            heap_gcPopTempRoot(objid);
+            PM_RETURN_IF_ERROR(retval);
+        }
+        ((pPmFrame_t)pframe)->fo_locals[0] = pdata;
+    }
+
+    /* It preempts threads of the default priority */
+    return interp_startThread(pframe, THREAD_PRIORITY_CALLBACK);
 }
 
 PmReturn_t
@@ -2088,6 +2451,7 @@ interp_callFunction(int8_t args, uint8_t noReturn)
     pPmObj_t pobj1 = C_NULL;
     pPmObj_t pobj2 = C_NULL;
     pPmObj_t pobj3 = C_NULL;
+    uint8_t objid;
 
     /* Ensure no keyword args */
     if ((args & (uint16_t)0xFF00) != 0)
@@ -2162,6 +2526,21 @@ interp_callFunction(int8_t args, uint8_t noReturn)
             pobj3 = PM_POP();
         }
 
+        /* #131: Calling a generator func makes a generator to run later */
+        if (((pPmFrame_t)pobj2)->fo_isGen)
+        {
+            retval = heap_gcPushTempRoot(pobj2, &objid);
+            PM_RETURN_IF_ERROR(retval);
+            retval = frame_newGenerator((pPmFrame_t)pobj2, &pobj3);
+            heap_gcPopTempRoot(objid);
+            PM_RETURN_IF_ERROR(retval);
+            if (!noReturn)
+            {
+                PM_PUSH(pobj3);
+            }
+            return retval;
+        }
+
         /* Keep ref to current frame */
         ((pPmFrame_t)pobj2)->fo_back = FP;
 
@@ -2228,6 +2607,7 @@ interp_callFunction(int8_t args, uint8_t noReturn)
         
         /* Reset GC count since the native session is done */
         gVmGlobal.nativeframe.nf_gcCount = 0;
+        heap_gcEndNative();
 
         /* If the frame pointer was switched, do nothing to TOS */
         if (retval == PM_RET_FRAME_SWITCH)
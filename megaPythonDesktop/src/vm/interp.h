@@ -28,6 +28,10 @@
  * Log
  * ---
  *
+ * 2008/02/20   #128: Callbacks run for posted events
+ * 2008/02/16   #126: Idle when no thread is ready
+ * 2008/02/14   #125: Schedule threads from priority ready queues
+ * 2008/02/08   #112: Add LOAD_METHOD and CALL_METHOD bytecodes
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
  * 2002/05/04   First.
@@ -48,12 +52,8 @@
 #define INTERP_LOOP_FOREVER          0
 #define INTERP_RETURN_ON_NO_THREADS  1
 
-/* Use bytecode counting for preemption */
+/* Preempt a thread when its timeslice is over (see THREAD_SLICE_MS) */
 #define INTERP_PREEMPTIVE_MULTITASKING 1
-/* Number of bytecodes before a context switch should occur */
-#define INTERP_PREEMPT_COUNT 48
-/* Use timer for preemption (this might be broken) */
-#define USE_TIMED_PERIODIC_PREEMPTION 0
 
 
 /***************************************************************
@@ -281,8 +281,8 @@ typedef enum PmBcode_e
     LOAD_CLOSURE,
     LOAD_DEREF,
     STORE_DEREF,
-    UNUSED_8A,
-    UNUSED_8B,
+    LOAD_METHOD,                /* PyMite only, made by pmImgCreator */
+    CALL_METHOD,                /* PyMite only, made by pmImgCreator */
     CALL_FUNCTION_VAR,          /* d140 */
     CALL_FUNCTION_KW,
     CALL_FUNCTION_VAR_KW,
@@ -325,6 +325,7 @@ typedef enum PmBcode_e
 
 /**
  * Interprets the available threads. Does not return.
+ * While no thread is ready (e.g. all are sleeping), calls plat_idle().
  *
  * @param returnOnNoThreads Loop forever if 0, exit with status if no more
  *                          threads left.
@@ -336,8 +337,9 @@ PmReturn_t interpret(const uint8_t returnOnNoThreads);
 /**
  * Selects a thread to run and changes the VM internal variables to
  * let the switch-loop execute the chosen one in the next iteration.
- * For the moment the algorithm is primitive and will change the
- * thread each time it is called in a round-robin fashion.
+ * The current thread, if it is still running, goes to the back of its
+ * ready queue; then the first thread of the highest priority ready
+ * queue is chosen.  Threads of the same priority take turns.
  */
 PmReturn_t interp_reschedule(void);
 
@@ -354,14 +356,28 @@ PmReturn_t interp_reschedule(void);
 PmReturn_t interp_addThread(pPmFunc_t pfunc);
 
 /**
- * Invokes a callback designated by the passed in key.  That callback
- * will run in a separate thread.  Python code should use critLock() if
- * it needs exclusive access without timeslicing.
+ * Like interp_addThread(), but the thread runs at the given priority.
+ * A thread of higher priority than the current one preempts it.
  *
- * @param pkey Key in the dict.
+ * @param pfunc Ptr to function to be executed as a thread.
+ * @param priority Priority, 0 (lowest) to THREAD_NUM_PRIORITIES - 1
+ * @return Return status; ValueError if there is no such priority
+ */
+PmReturn_t interp_addThreadPrio(pPmFunc_t pfunc, uint8_t priority);
+
+/**
+ * Invokes the callback registered for an event ID.  That callback
+ * will run in a separate thread at THREAD_PRIORITY_CALLBACK.
+ * If the callback takes an arg, it is passed the event's data, or None
+ * if the data was lost.
+ * Interrupt handlers must use event_post() instead.
+ *
+ * @param id ID of the event
+ * @param data Data of the event
+ * @param isLost Nonzero if the event's data was lost; data is ignored
  * @return Return status
  */
-PmReturn_t interp_callback(int32_t pkey);
+PmReturn_t interp_callback(uint8_t id, int32_t data, uint8_t isLost);
 
 /**
  * Invokes a function object, with the assumption that the function was
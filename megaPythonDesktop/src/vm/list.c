@@ -28,6 +28,8 @@
  * Log
  * ---
  *
+ * 2008/03/07   #135: Print the separator with one plat_putBytes()
+ * 2008/03/05   #134: Keep a new slice or copy in a temp root while it grows
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
  * 2007/01/09   #75: Printing support (P.Adelt)
  * 2007/01/09   #75: implemented list_remove() and list_index() (P.Adelt)
@@ -150,6 +152,7 @@ list_new(pPmObj_t *r_pobj)
 {
     PmReturn_t retval = PM_RET_OK;
     pPmList_t plist = C_NULL;
+    uint8_t objid;
 
     /* Allocate a list */
     retval = heap_getChunk(sizeof(PmList_t), (uint8_t **)r_pobj);
@@ -159,9 +162,13 @@ list_new(pPmObj_t *r_pobj)
     plist = (pPmList_t)*r_pobj;
     OBJ_SET_TYPE(plist, OBJ_TYPE_LST);
     plist->length = 0;
+    plist->val = C_NULL;
 
-    /* Create empty seglist */
+    /* Create empty seglist, keeping the list if the GC runs */
+    retval = heap_gcPushTempRoot((pPmObj_t)plist, &objid);
+    PM_RETURN_IF_ERROR(retval);
     retval = seglist_new(&plist->val);
+    heap_gcPopTempRoot(objid);
     return retval;
 }
 
@@ -181,6 +188,7 @@ list_replicate(pPmObj_t psrclist, int16_t n, pPmObj_t *r_pnewlist)
     int16_t j = 0;
     int16_t length = 0;
     pPmObj_t pitem = C_NULL;
+    uint8_t objid;
 
     C_ASSERT(psrclist != C_NULL);
     C_ASSERT(r_pnewlist != C_NULL);
@@ -193,22 +201,26 @@ list_replicate(pPmObj_t psrclist, int16_t n, pPmObj_t *r_pnewlist)
     }
     length = ((pPmList_t)psrclist)->length;
 
-    /* Allocate new list */
+    /* Allocate new list, keeping it if the GC runs while it grows */
     retval = list_new(r_pnewlist);
     PM_RETURN_IF_ERROR(retval);
+    retval = heap_gcPushTempRoot(*r_pnewlist, &objid);
+    PM_RETURN_IF_ERROR(retval);
 
     /* Copy srclist the designated number of times */
-    for (i = n; i > 0; i--)
+    for (i = n; (i > 0) && (retval == PM_RET_OK); i--)
     {
         /* Iterate over the length of srclist */
-        for (j = 0; j < length; j++)
+        for (j = 0; (j < length) && (retval == PM_RET_OK); j++)
         {
             retval = list_getItem(psrclist, j, &pitem);
-            PM_RETURN_IF_ERROR(retval);
-            retval = list_append(*r_pnewlist, pitem);
-            PM_RETURN_IF_ERROR(retval);
+            if (retval == PM_RET_OK)
+            {
+                retval = list_append(*r_pnewlist, pitem);
+            }
         }
     }
+    heap_gcPopTempRoot(objid);
     return retval;
 }
 
@@ -447,6 +459,7 @@ list_getSlice(pPmObj_t plist, int16_t startIndex, int16_t endIndex, int16_t step
     PmReturn_t retval = PM_RET_OK;
     pPmObj_t pobj;
     uint16_t i;
+    uint8_t objid;
 
     /* Sanity check that slice step isn't 0 */
     if (step == 0)
@@ -474,15 +487,19 @@ list_getSlice(pPmObj_t plist, int16_t startIndex, int16_t endIndex, int16_t step
 
     retval = list_new(rlist);
     PM_RETURN_IF_ERROR(retval);
+    retval = heap_gcPushTempRoot(*rlist, &objid);
+    PM_RETURN_IF_ERROR(retval);
 
     /* Copy the middle bit, as requested */
-    for (i = startIndex; i < endIndex; i+=step)
+    for (i = startIndex; (i < endIndex) && (retval == PM_RET_OK); i+=step)
     {
         retval = list_getItem(plist, i, &pobj);
-        PM_RETURN_IF_ERROR(retval);
-        retval = list_append(*rlist, pobj);
-        PM_RETURN_IF_ERROR(retval);
+        if (retval == PM_RET_OK)
+        {
+            retval = list_append(*rlist, pobj);
+        }
     }
+    heap_gcPopTempRoot(objid);
 
     return retval;
 }
@@ -515,8 +532,8 @@ list_print(pPmObj_t plist)
     {
         if (index != 0)
         {
-            plat_putByte(',');
-            plat_putByte(' ');
+            retval = plat_putBytes((uint8_t const *)", ", 2);
+            PM_RETURN_IF_ERROR(retval);
         }
 
         /* Print each item */
@@ -28,6 +28,10 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: Load the image with the pool of its image set
+ * 2008/02/04   #110: Add mod_forget() for a module whose body raised
+ * 2008/03/17   #140: Clear a new module's default args
+ * 2008/02/04   #110: Prevent importing previously-loaded module
  * 2006/08/31   #9: Fix BINARY_SUBSCR for case stringobj[intobj]
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
@@ -66,6 +70,9 @@ mod_new(pPmObj_t pco, pPmObj_t *pmod)
     OBJ_SET_TYPE(*pmod, OBJ_TYPE_MOD);
     ((pPmFunc_t)*pmod)->f_co = (pPmCo_t)pco;
 
+    /* A module has no default args; the GC marks the field all the same */
+    ((pPmFunc_t)*pmod)->f_defaultargs = C_NULL;
+
     /* Alloc and init attrs dict */
     retval = dict_new(&pobj);
     ((pPmFunc_t)*pmod)->f_attrs = (pPmDict_t)pobj;
@@ -77,6 +84,31 @@ mod_new(pPmObj_t pco, pPmObj_t *pmod)
 }
 
 
+PmReturn_t
+mod_lookup(pPmObj_t pstr, pPmObj_t *pmod)
+{
+    pPmImgInfo_t pii = C_NULL;
+    PmReturn_t retval;
+
+    /* If it's not a string obj, raise SyntaxError */
+    if (OBJ_GET_TYPE(pstr) != OBJ_TYPE_STR)
+    {
+        PM_RAISE(retval, PM_RET_EX_SYNTAX);
+        return retval;
+    }
+
+    /* Return no result if there is no such img or it was never imported */
+    retval = img_lookup((pPmString_t)pstr, &pii);
+    if ((retval != PM_RET_OK) || (pii->ii_module == C_NULL))
+    {
+        return PM_RET_NO;
+    }
+
+    *pmod = pii->ii_module;
+    return PM_RET_OK;
+}
+
+
 PmReturn_t
 mod_import(pPmObj_t pstr, pPmObj_t *pmod)
 {
@@ -93,30 +125,53 @@ mod_import(pPmObj_t pstr, pPmObj_t *pmod)
         return retval;
     }
 
-    /* Iterate through the global img list */
-    pii = gVmGlobal.pimglist;
-
-    /* Scan until end of list or string matches */
-    while ((pii != C_NULL)
-           && (string_compare((pPmString_t)pstr, pii->ii_name) == C_DIFFER))
-    {
-        pii = pii->next;
-    }
+    /* Find the img through the img index */
+    retval = img_lookup((pPmString_t)pstr, &pii);
 
     /* If img was not found, raise ImportError */
-    if (pii == C_NULL)
+    if (retval == PM_RET_NO)
     {
         PM_RAISE(retval, PM_RET_EX_IMPRT);
         return retval;
     }
+    PM_RETURN_IF_ERROR(retval);
+
+    /* If the module was already made, return the same one */
+    if (pii->ii_module != C_NULL)
+    {
+        *pmod = pii->ii_module;
+        return PM_RET_OK;
+    }
 
     /* Make copy of addr so image list pointer isn't modified */
     imgaddr = pii->ii_addr;
 
-    /* Load img into code obj */
+    /* Load img into code obj; its refs are to the pool of its set */
+    gVmGlobal.pimgpool = pii->ii_pool;
     retval = obj_loadFromImg(pii->ii_memspace, &imgaddr, &pobj);
+    gVmGlobal.pimgpool = C_NULL;
     PM_RETURN_IF_ERROR(retval);
     pco = (pPmCo_t)pobj;
 
-    return mod_new((pPmObj_t)pco, pmod);
+    retval = mod_new((pPmObj_t)pco, pmod);
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Cache the module before its body runs so circular imports find it */
+    pii->ii_module = *pmod;
+    return retval;
+}
+
+
+void
+mod_forget(pPmObj_t pmod)
+{
+    pPmImgInfo_t pii;
+
+    for (pii = gVmGlobal.pimglist; pii != C_NULL; pii = pii->next)
+    {
+        if (pii->ii_module == pmod)
+        {
+            pii->ii_module = C_NULL;
+        }
+    }
 }
@@ -28,6 +28,12 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: Load refs to the pool of an image set
+ * 2008/03/23   #143: Load compressed code images
+ * 2008/03/07   #135: Print the words with one plat_putBytes()
+ * 2008/02/26   #131: Print generators like other objs
+ * 2008/02/18   #127: Print sync objs like other objs
+ * 2008/02/12   #124: Read chars through STRING_GET_CHARS()
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
  * 2007/01/09   #75: Printing support (P.Adelt)
  * 2006/09/20   #35: Macroize all operations on object descriptors
@@ -54,6 +60,7 @@ obj_loadFromImg(PmMemSpace_t memspace,
 {
     PmReturn_t retval = PM_RET_OK;
     PmObj_t obj;
+    uint8_t n;
     
 
     /* Get the object descriptor */
@@ -90,6 +97,23 @@ obj_loadFromImg(PmMemSpace_t memspace,
             retval = co_loadFromImg(memspace, paddr, r_pobj);
             break;
 
+        case OBJ_TYPE_ZIM:
+            /* If it's a compressed code img, expand it and load it */
+            retval = co_loadFromZim(memspace, paddr, r_pobj);
+            break;
+
+        case OBJ_TYPE_PRF:
+            /* If it's a ref to the pool, return the obj the pool holds */
+            n = mem_getByte(memspace, paddr);
+            if ((gVmGlobal.pimgpool == C_NULL)
+                || (n >= gVmGlobal.pimgpool->length))
+            {
+                PM_RAISE(retval, PM_RET_EX_TYPE);
+                break;
+            }
+            *r_pobj = gVmGlobal.pimgpool->val[n];
+            break;
+
         default:
             /* All other types should not be in an img obj */
             PM_RAISE(retval, PM_RET_EX_SYS);
@@ -189,10 +213,10 @@ obj_isIn(pPmObj_t pobj, pPmObj_t pitem)
             }
 
             /* Iterate over string to find char */
-            c = ((pPmString_t)pitem)->val[0];
+            c = STRING_GET_CHARS(pitem)[0];
             for (i = 0; i < ((pPmString_t)pobj)->length; i++)
             {
-                if (c == ((pPmString_t)pobj)->val[i])
+                if (c == STRING_GET_CHARS(pobj)[i])
                 {
                     retval = PM_RET_OK;
                     break;
@@ -294,10 +318,7 @@ printf("null");return retval;}
         case OBJ_TYPE_NON:
             if (marshallString)
             {
-                plat_putByte('N');
-                plat_putByte('o');
-                plat_putByte('n');
-                retval = plat_putByte('e');
+                retval = plat_putBytes((uint8_t const *)"None", 4);
             }
             break;
         case OBJ_TYPE_INT:
@@ -330,50 +351,22 @@ printf("null");return retval;}
         case OBJ_TYPE_EXN:
         case OBJ_TYPE_SQI:
         case OBJ_TYPE_THR:
+        case OBJ_TYPE_SYN:
+        case OBJ_TYPE_GEN:
             if (marshallString)
             {
                 retval = plat_putByte('\'');
                 PM_RETURN_IF_ERROR(retval);
             }
-            plat_putByte('<');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('o');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('b');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('j');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte(' ');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('t');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('y');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('p');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('e');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte(' ');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('0');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('x');
-            PM_RETURN_IF_ERROR(retval);
-            int_printHexByte(OBJ_GET_TYPE(pobj));
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte(' ');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte('@');
-            PM_RETURN_IF_ERROR(retval);
-            plat_putByte(' ');
+            retval = plat_putBytes((uint8_t const *)"<obj type 0x", 12);
             PM_RETURN_IF_ERROR(retval);
-            plat_putByte('0');
+            retval = int_printHexByte(OBJ_GET_TYPE(pobj));
             PM_RETURN_IF_ERROR(retval);
-            plat_putByte('x');
+            retval = plat_putBytes((uint8_t const *)" @ 0x", 5);
             PM_RETURN_IF_ERROR(retval);
-            _int_printHex((int)pobj);
+            retval = _int_printHex((int)pobj);
             PM_RETURN_IF_ERROR(retval);
-            plat_putByte('>');
+            retval = plat_putByte('>');
             PM_RETURN_IF_ERROR(retval);
             if (marshallString)
             {
@@ -28,6 +28,12 @@
  * Log
  * ---
  *
+ * 2008/03/25   #144: Add OBJ_TYPE_PIM and OBJ_TYPE_PRF
+ * 2008/03/23   #143: OBJ_TYPE_ZIM for compressed code images
+ * 2008/03/15   #139: OBJ_TYPE_IMF for mapped image files
+ * 2008/02/26   #131: OBJ_TYPE_GEN for generators
+ * 2008/02/24   #130: OBJ_TYPE_SYN is also used for channels
+ * 2008/02/18   #127: OBJ_TYPE_SYN for locks, semaphores and conditions
  * 2007/03/16   #99: Design a way for ipm to be able to receive images larger
  *              than HEAP_MAX_CHUNK_SIZE
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
@@ -208,6 +214,9 @@ typedef enum PmType_e
     /* All types after this are not hashable */
     OBJ_TYPE_HASHABLE_MAX = 0x0E,
 
+    /** Compressed code image; only found in images, never an obj */
+    OBJ_TYPE_ZIM = 0x0F,
+
     /** List (mutable sequence) */
     OBJ_TYPE_LST = 0x10,
 
@@ -243,6 +252,21 @@ typedef enum PmType_e
 
     /** Method */
     OBJ_TYPE_MTH = 0x1A,
+
+    /** Sync obj (lock, semaphore, condition or channel) */
+    OBJ_TYPE_SYN = 0x1B,
+
+    /** Generator */
+    OBJ_TYPE_GEN = 0x1C,
+
+    /** Mapped image file */
+    OBJ_TYPE_IMF = 0x1D,
+
+    /** Pool of the objs an image set shares; only found in images */
+    OBJ_TYPE_PIM = 0x1E,
+
+    /** Ref to an obj in the pool; only found in images */
+    OBJ_TYPE_PRF = 0x1F,
 } PmType_t, *pPmType_t;
 
 
@@ -26,6 +26,11 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: Add plat_memRead()
+ * 2008/03/09   #136: Add plat_getBytes()
+ * 2008/03/07   #135: Add plat_putBytes() and plat_flush()
+ * 2008/03/03   #133: Add plat_pollIo()
+ * 2008/02/16   #126: Add plat_idle()
  * 2007/01/31   #86: Move platform-specific code to the platform impl file
  * 2007/01/10   #75: Added time tick service for desktop (POSIX) and AVR. (P.Adelt)
  * 2006/12/26   #65: Create plat module with put and get routines
@@ -37,6 +42,7 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
+#include <avr/sleep.h>
 
 #include "../pm.h"
 
@@ -200,6 +206,39 @@ plat_memGetByte(PmMemSpace_t memspace, uint8_t const **paddr)
 }
 
 
+/*
+ * Reads bytes from the address in the designated memory space
+ */
+void
+plat_memRead(PmMemSpace_t memspace, uint8_t const *paddr,
+             uint8_t *pbuf, uint16_t len)
+{
+    switch (memspace)
+    {
+        case MEMSPACE_RAM:
+            sli_memcpy(pbuf, paddr, len);
+            return;
+
+        case MEMSPACE_PROG:
+            memcpy_P(pbuf, paddr, len);
+            return;
+
+        case MEMSPACE_EEPROM:
+            eeprom_read_block(pbuf, paddr, len);
+            return;
+
+        case MEMSPACE_SEEPROM:
+        case MEMSPACE_OTHER0:
+        case MEMSPACE_OTHER1:
+        case MEMSPACE_OTHER2:
+        case MEMSPACE_OTHER3:
+        default:
+            sli_memset(pbuf, 0, len);
+            return;
+    }
+}
+
+
 /*
  * UART receive char routine MUST return exactly and only the received char;
  * it should not translate \n to \r\n.
@@ -227,6 +266,24 @@ plat_getByte(uint8_t *b)
 }
 
 
+/* Gets all len bytes, one at a time from the UART */
+PmReturn_t
+plat_getBytes(uint8_t *buf, uint16_t len, uint16_t *r_len)
+{
+    PmReturn_t retval = PM_RET_OK;
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        retval = plat_getByte(&buf[i]);
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    *r_len = len;
+    return retval;
+}
+
+
 /*
  * UART send char routine MUST send exactly and only the given char;
  * it should not translate \n to \r\n.
@@ -247,6 +304,29 @@ plat_putByte(uint8_t b)
 }
 
 
+/* The UART is not buffered, so the bytes are sent one at a time */
+PmReturn_t
+plat_putBytes(uint8_t const *buf, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        plat_putByte(buf[i]);
+    }
+
+    return PM_RET_OK;
+}
+
+
+/* Nothing is held back, see plat_putBytes() */
+PmReturn_t
+plat_flush(void)
+{
+    return PM_RET_OK;
+}
+
+
 /*
  * This operation is made atomic by temporarily disabling
  * the interrupts. The old state is restored afterwards.
@@ -264,6 +344,22 @@ plat_getMsTicks(uint32_t *r_ticks)
 }
 
 
+/* Idle mode keeps the timers running, so the next tick wakes the CPU */
+void
+plat_idle(void)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+}
+
+
+/* Threads don't wait for I/O here, so none is made ready */
+void
+plat_pollIo(void)
+{
+}
+
+
 void 
 plat_reportError(PmReturn_t result)
 {
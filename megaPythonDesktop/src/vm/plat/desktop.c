@@ -25,12 +25,32 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: Add plat_memRead() and plat_openMemspace(), the
+ *              memspaces from MEMSPACE_EEPROM on may be read from files;
+ *              their descriptors are locked, since all VMs read them
+ * 2008/03/19   #141: Add plat_closeIo()
+ * 2008/03/17   #140: Add plat_readFile() and plat_writeFile()
+ * 2008/03/15   #139: Add plat_unmapFile()
+ * 2008/03/13   #138: Add plat_mapFile()
+ * 2008/03/09   #136: Stdin is read into a buffer as much as it has,
+ *              add plat_getBytes() and plat_inReady(); the buffer is
+ *              locked, since VMs on other threads read it too
+ * 2008/03/07   #135: Output is buffered by stdio and flushed at newlines,
+ *              idle, input waits and plat_flush(), not after each byte
+ * 2008/03/03   #133: Ticks come from a timerfd read by a tick thread, not
+ *              from SIGALRM; threads wait on descriptors in an epoll
+ *              set; plat_getByte() reads stdin unbuffered
+ * 2008/03/01   #132: The tick counts the time measured by the monotonic
+ *              clock, not the number of SIGALRMs
+ * 2008/02/22   #129: plat_idle() sleeps at most a ms, since the
+ *              SIGALRM may go to another VM's thread
+ * 2008/02/16   #126: Add plat_idle(), plat_getMsTicks() returns ms
  * 2007/01/10   #75: Added time tick service for desktop (POSIX) and AVR. (P.Adelt)
  * 2006/12/26   #65: Create plat module with put and get routines
  */
 
 /* PyMite build process uses -ansi which disables certain features that
- * in turn disable features needed for signal processing. To work around
+ * in turn disable the POSIX clock, thread and I/O features. To work around
  * this, temporarily disable the corresponding #define. This is not
  * needed for Cygwin but for Linux. The -ansi option of GCC is explained
  * here: http://gcc.gnu.org/onlinedocs/gcc-4.0.3/gcc/C-Dialect-Options.html
@@ -44,19 +64,76 @@
 #endif
 #include <time.h>
 #include <unistd.h>
-#include <signal.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "../pm.h"
 
+/***************************************************************
+ * Constants
+ **************************************************************/
+
+/** Most descriptor waits ended by one look at the epoll set */
+#define PLAT_IO_EVENTS 8
+
+/** Size of the buffer of bytes read from stdin */
+#define PLAT_IN_SIZE 256
+
+/**
+ * Address of the first byte of a file opened by plat_openMemspace();
+ * not 0, so the address of an image in the file is never C_NULL
+ */
+#define PLAT_MEMSPACE_BASE ((uint8_t const *)0x1000)
+
+/** Number of memspaces that may be read from files */
+#define PLAT_MEMSPACE_FILES (MEMSPACE_OTHER3 - MEMSPACE_EEPROM + 1)
+
 /***************************************************************
  * Globals
  **************************************************************/
 
+/** Monotonic clock time at the last tick */
+static struct timespec plat_lastTick;
+
+/** Starts the tick thread once for all VMs */
+static pthread_once_t plat_tickOnce = PTHREAD_ONCE_INIT;
+
+/** Timer fd that expires every ms, -1 if it couldn't be made */
+static int plat_tickFd = -1;
+
+/** Bytes read from stdin that are not got yet; from plat_inNext on */
+static uint8_t plat_inBuf[PLAT_IN_SIZE];
+
+/** Index of the next byte in plat_inBuf */
+static uint16_t plat_inNext = 0;
+
+/** Number of bytes in plat_inBuf that are not got yet */
+static uint16_t plat_inCount = 0;
+
+/** Held while a VM uses plat_inBuf, plat_inNext or plat_inCount */
+static pthread_mutex_t plat_inLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Descriptors plus one of the files of the memspaces; 0 if none */
+static int plat_memFds[PLAT_MEMSPACE_FILES];
+
+/** Held while a VM uses plat_memFds */
+static pthread_mutex_t plat_memLock = PTHREAD_MUTEX_INITIALIZER;
+
 /***************************************************************
  * Prototypes
  **************************************************************/
 
-void plat_sigalrm_handler(int signal);
+static void plat_startTick(void);
+static void *plat_tickThread(void *arg);
+static PmReturn_t plat_readIn(uint8_t *buf, uint16_t len, uint16_t *r_len);
+static PmReturn_t plat_getBytesLocked(uint8_t *buf, uint16_t len,
+                                      uint16_t *r_len);
 
 /***************************************************************
  * Functions
@@ -66,24 +143,104 @@ void plat_sigalrm_handler(int signal);
 PmReturn_t
 plat_init(void)
 {
-    /* Let POSIX' SIGALRM fire every full millisecond. */
-    /* 
-     * #67 Using sigaction complicates the use of getchar (below),
-     * so signal() is used instead.
+    PmReturn_t retval = PM_RET_OK;
+
+    /*
+     * #133: The ms tick is counted by a thread of its own that reads
+     * a timerfd, so no signal interrupts the VM's system calls
      */
-    signal(SIGALRM, plat_sigalrm_handler);
-    ualarm(1000, 1000);
+    pthread_once(&plat_tickOnce, plat_startTick);
+    if (plat_tickFd < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_SYS);
+    }
 
-    return PM_RET_OK;
+    return retval;
 }
 
 
-void
-plat_sigalrm_handler(int signal)
+/* Makes the timer fd and the thread that reads it */
+static void
+plat_startTick(void)
+{
+    struct itimerspec period;
+    pthread_t tid;
+
+    plat_tickFd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (plat_tickFd < 0)
+    {
+        return;
+    }
+
+    period.it_interval.tv_sec = 0;
+    period.it_interval.tv_nsec = 1000000;
+    period.it_value = period.it_interval;
+    clock_gettime(CLOCK_MONOTONIC, &plat_lastTick);
+    if ((timerfd_settime(plat_tickFd, 0, &period, C_NULL) != 0)
+        || (pthread_create(&tid, C_NULL, plat_tickThread, C_NULL) != 0))
+    {
+        close(plat_tickFd);
+        plat_tickFd = -1;
+        return;
+    }
+    pthread_detach(tid);
+}
+
+
+/*
+ * Passes the time since the last tick to the VM at each expiry of the
+ * timer fd.  Expiries can come late or be merged, so the time is
+ * measured.
+ */
+static void *
+plat_tickThread(void *arg)
 {
     PmReturn_t retval;
-    retval = pm_vmPeriodic(1000);
-    PM_REPORT_IF_ERROR(retval);
+    struct timespec now;
+    uint64_t expiries;
+    int32_t usecs;
+
+#if USE_MULTI_VM
+    /* Count the time for all VMs; each looks at the count itself */
+    pm_bindVm(C_NULL);
+#endif /* USE_MULTI_VM */
+
+    while (1)
+    {
+        if (read(plat_tickFd, &expiries, sizeof(expiries)) < 0)
+        {
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        usecs = (int32_t)(now.tv_sec - plat_lastTick.tv_sec) * 1000000
+                + (now.tv_nsec - plat_lastTick.tv_nsec) / 1000;
+        if (usecs <= 0)
+        {
+            continue;
+        }
+
+        /* Keep the time that doesn't fit for the next tick */
+        if (usecs > 60000)
+        {
+            usecs = 60000;
+            plat_lastTick.tv_nsec += 60000000;
+            if (plat_lastTick.tv_nsec >= 1000000000)
+            {
+                plat_lastTick.tv_nsec -= 1000000000;
+                plat_lastTick.tv_sec++;
+            }
+        }
+        else
+        {
+            plat_lastTick = now;
+        }
+
+        retval = pm_vmPeriodic((uint16_t)usecs);
+        PM_REPORT_IF_ERROR(retval);
+    }
+
+    return C_NULL;
 }
 
 
@@ -110,32 +267,190 @@ plat_memGetByte(PmMemSpace_t memspace, uint8_t const **paddr)
         case MEMSPACE_OTHER1:
         case MEMSPACE_OTHER2:
         case MEMSPACE_OTHER3:
+            /* One transaction per byte, as on a serial bus */
+            plat_memRead(memspace, *paddr, &b, 1);
+            *paddr += 1;
+            return b;
+
         default:
             return 0;
     }
 }
 
 
-/* Desktop target shall use stdio for I/O routines */
+/* Reads bytes of a memspace; a file's bytes are read at once */
+void
+plat_memRead(PmMemSpace_t memspace, uint8_t const *paddr,
+             uint8_t *pbuf, uint16_t len)
+{
+    ssize_t n = 0;
+    int fd;
+
+    if ((memspace == MEMSPACE_RAM) || (memspace == MEMSPACE_PROG))
+    {
+        memcpy(pbuf, paddr, len);
+        return;
+    }
+
+    /* The file may not be closed while it is read */
+    pthread_mutex_lock(&plat_memLock);
+    fd = plat_memFds[memspace - MEMSPACE_EEPROM] - 1;
+    if ((fd >= 0) && (paddr >= PLAT_MEMSPACE_BASE))
+    {
+        n = pread(fd, pbuf, len, (off_t)(paddr - PLAT_MEMSPACE_BASE));
+        if (n < 0)
+        {
+            n = 0;
+        }
+    }
+    pthread_mutex_unlock(&plat_memLock);
+    memset(pbuf + n, 0, len - n);
+}
+
+
 PmReturn_t
-plat_getByte(uint8_t *b)
+plat_openMemspace(PmMemSpace_t memspace, uint8_t const *fn,
+                  uint8_t const **r_paddr)
 {
-    int c;
     PmReturn_t retval = PM_RET_OK;
+    int fd;
 
-    c = getchar();
-    *b = c & 0xFF;
+    if ((memspace < MEMSPACE_EEPROM) || (memspace > MEMSPACE_OTHER3))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
 
-    if (c == EOF)
+    fd = open((char const *)fn, O_RDONLY);
+    if (fd < 0)
     {
         PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    /* A memspace opened again reads the new file */
+    pthread_mutex_lock(&plat_memLock);
+    if (plat_memFds[memspace - MEMSPACE_EEPROM] != 0)
+    {
+        close(plat_memFds[memspace - MEMSPACE_EEPROM] - 1);
     }
+    plat_memFds[memspace - MEMSPACE_EEPROM] = fd + 1;
+    pthread_mutex_unlock(&plat_memLock);
 
+    /* Its address is the same, so pages of the old file are dropped */
+#if USE_MEM_CACHE
+    mem_flushCache(memspace);
+#endif /* USE_MEM_CACHE */
+    *r_paddr = PLAT_MEMSPACE_BASE;
     return retval;
 }
 
 
-/* Desktop target shall use stdio for I/O routines */
+/*
+ * Reads what stdin has, up to len bytes, waiting for at least one.
+ * #136: Stdin is read with read(), not stdio, so plat_waitFd() sees
+ * every byte that is not in plat_inBuf.
+ */
+static PmReturn_t
+plat_readIn(uint8_t *buf, uint16_t len, uint16_t *r_len)
+{
+    ssize_t n;
+    PmReturn_t retval = PM_RET_OK;
+
+    /* The other side may wait for the output before it sends more */
+    retval = plat_flush();
+    PM_RETURN_IF_ERROR(retval);
+
+    do
+    {
+        n = read(STDIN_FILENO, buf, len);
+    }
+    while ((n < 0) && (errno == EINTR));
+
+    if (n <= 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    *r_len = (uint16_t)n;
+    return retval;
+}
+
+
+/* Desktop target shall use stdin for input */
+PmReturn_t
+plat_getByte(uint8_t *b)
+{
+    uint16_t got;
+
+    return plat_getBytes(b, 1, &got);
+}
+
+
+PmReturn_t
+plat_getBytes(uint8_t *buf, uint16_t len, uint16_t *r_len)
+{
+    PmReturn_t retval;
+
+    pthread_mutex_lock(&plat_inLock);
+    retval = plat_getBytesLocked(buf, len, r_len);
+    pthread_mutex_unlock(&plat_inLock);
+    return retval;
+}
+
+
+/*
+ * Gets the buffered bytes if there are any, else reads stdin.  A read
+ * of at least a full buffer goes straight to the caller's buffer.
+ * The caller holds plat_inLock.
+ */
+static PmReturn_t
+plat_getBytesLocked(uint8_t *buf, uint16_t len, uint16_t *r_len)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    C_ASSERT(len > 0);
+
+    if (plat_inCount == 0)
+    {
+        if (len >= PLAT_IN_SIZE)
+        {
+            return plat_readIn(buf, len, r_len);
+        }
+        retval = plat_readIn(plat_inBuf, PLAT_IN_SIZE, &plat_inCount);
+        PM_RETURN_IF_ERROR(retval);
+        plat_inNext = 0;
+    }
+
+    if (len > plat_inCount)
+    {
+        len = plat_inCount;
+    }
+    sli_memcpy(buf, &plat_inBuf[plat_inNext], len);
+    plat_inNext += len;
+    plat_inCount -= len;
+    *r_len = len;
+    return retval;
+}
+
+
+uint16_t
+plat_inReady(void)
+{
+    uint16_t n;
+
+    pthread_mutex_lock(&plat_inLock);
+    n = plat_inCount;
+    pthread_mutex_unlock(&plat_inLock);
+    return n;
+}
+
+
+/*
+ * Desktop target shall use stdio for I/O routines.  Output is flushed
+ * at each newline, so a line costs one write.
+ */
 PmReturn_t
 plat_putByte(uint8_t b)
 {
@@ -143,9 +458,48 @@ plat_putByte(uint8_t b)
     PmReturn_t retval = PM_RET_OK;
 
     i = putchar(b);
-    fflush(stdout);
 
     if ((i != b) || (i == EOF))
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    if (b == '\n')
+    {
+        retval = plat_flush();
+    }
+
+    return retval;
+}
+
+
+PmReturn_t
+plat_putBytes(uint8_t const *buf, uint16_t len)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    if (fwrite(buf, 1, len, stdout) != len)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    if (memchr(buf, '\n', len) != C_NULL)
+    {
+        retval = plat_flush();
+    }
+
+    return retval;
+}
+
+
+PmReturn_t
+plat_flush(void)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    if (fflush(stdout) == EOF)
     {
         PM_RAISE(retval, PM_RET_EX_IO);
     }
@@ -157,17 +511,245 @@ plat_putByte(uint8_t b)
 PmReturn_t
 plat_getMsTicks(uint32_t *r_ticks)
 {
-    time_t cur_time;
-    /*
     *r_ticks = pm_timerMsTicks;
-    */
-    cur_time = time(NULL);
-    *r_ticks = cur_time;
 
     return PM_RET_OK;
 }
 
 
+/*
+ * Sleeps a ms, the time to the next tick, or until a descriptor that
+ * a thread waits on is ready
+ */
+void
+plat_idle(void)
+{
+    struct epoll_event ev;
+
+    fflush(stdout);
+    if (gVmGlobal.ioWaits == 0)
+    {
+        usleep(1000);
+        return;
+    }
+    epoll_wait(gVmGlobal.ioEpoll - 1, &ev, 1, 1);
+}
+
+
+/* Makes ready the threads whose descriptors are ready */
+void
+plat_pollIo(void)
+{
+    struct epoll_event ev[PLAT_IO_EVENTS];
+    pPmThread_t pthread;
+    int ep;
+    int n;
+    int i;
+
+    if (gVmGlobal.ioWaits == 0)
+    {
+        return;
+    }
+
+    ep = gVmGlobal.ioEpoll - 1;
+    n = epoll_wait(ep, ev, PLAT_IO_EVENTS, 0);
+    for (i = 0; i < n; i++)
+    {
+        pthread = (pPmThread_t)ev[i].data.ptr;
+        epoll_ctl(ep, EPOLL_CTL_DEL, pthread->waitFd, &ev[i]);
+        close(pthread->waitFd);
+        pthread->waitFd = -1;
+        gVmGlobal.ioWaits--;
+        thread_makeReady(pthread);
+    }
+}
+
+
+PmReturn_t
+plat_waitFd(int fd, uint8_t forWrite)
+{
+    PmReturn_t retval = PM_RET_OK;
+    pPmThread_t pthread = gVmGlobal.pthread;
+    struct pollfd pfd;
+    struct epoll_event ev;
+    int ep;
+
+    /* Don't wait for stdin while its buffer has bytes */
+    if ((fd == STDIN_FILENO) && !forWrite && (plat_inReady() != 0))
+    {
+        return PM_RET_OK;
+    }
+
+    /* Don't wait if it's ready, or if it has an error the I/O reports */
+    pfd.fd = fd;
+    pfd.events = forWrite ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) != 0)
+    {
+        return PM_RET_OK;
+    }
+
+    /* Make the VM's epoll set on the first wait */
+    if (gVmGlobal.ioEpoll == 0)
+    {
+        ep = epoll_create(PLAT_IO_EVENTS);
+        if (ep < 0)
+        {
+            PM_RAISE(retval, PM_RET_EX_IO);
+            return retval;
+        }
+        gVmGlobal.ioEpoll = ep + 1;
+    }
+    ep = gVmGlobal.ioEpoll - 1;
+
+    /*
+     * Each waiting thread adds a copy of the descriptor, so any number
+     * of threads can wait on the same one
+     */
+    pthread->waitFd = dup(fd);
+    if (pthread->waitFd < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    ev.events = forWrite ? EPOLLOUT : EPOLLIN;
+    ev.data.ptr = pthread;
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, pthread->waitFd, &ev) != 0)
+    {
+        close(pthread->waitFd);
+        pthread->waitFd = -1;
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+    gVmGlobal.ioWaits++;
+
+    /* The other side may wait for the output before it sends more */
+    fflush(stdout);
+
+    /* Block the thread; plat_pollIo() makes it ready */
+    pthread->state = THREAD_STATE_BLOCKED;
+    VM_SET_RESCHEDULE(1);
+    return PM_RET_NO;
+}
+
+
+void
+plat_closeIo(void)
+{
+    pPmObj_t pthread;
+    int16_t i;
+
+    /* Closing a waiting thread's copy of its descriptor drops its wait */
+    for (i = 0; i < gVmGlobal.threadList->length; i++)
+    {
+        if ((list_getItem((pPmObj_t)gVmGlobal.threadList, i, &pthread)
+             == PM_RET_OK)
+            && (((pPmThread_t)pthread)->waitFd >= 0))
+        {
+            close(((pPmThread_t)pthread)->waitFd);
+            ((pPmThread_t)pthread)->waitFd = -1;
+        }
+    }
+
+    if (gVmGlobal.ioEpoll != 0)
+    {
+        close(gVmGlobal.ioEpoll - 1);
+        gVmGlobal.ioEpoll = 0;
+    }
+    gVmGlobal.ioWaits = 0;
+}
+
+
+PmReturn_t
+plat_mapFile(uint8_t const *fn, uint8_t const **r_paddr, uint32_t *r_len)
+{
+    PmReturn_t retval = PM_RET_OK;
+    struct stat st;
+    void *paddr = MAP_FAILED;
+    int fd;
+
+    fd = open((char const *)fn, O_RDONLY);
+    if (fd < 0)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    /* The mapping holds the file open, so the descriptor isn't kept */
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0)
+        && (st.st_size <= (off_t)0xFFFFFFFF))
+    {
+        paddr = mmap(C_NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+                     fd, 0);
+    }
+    close(fd);
+    if (paddr == MAP_FAILED)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+        return retval;
+    }
+
+    *r_paddr = (uint8_t const *)paddr;
+    *r_len = (uint32_t)st.st_size;
+    return retval;
+}
+
+
+void
+plat_unmapFile(uint8_t const *paddr, uint32_t len)
+{
+    munmap((void *)paddr, (size_t)len);
+}
+
+
+PmReturn_t
+plat_readFile(uint8_t const *fn, uint32_t offset, uint8_t *pbuf, uint32_t len)
+{
+    PmReturn_t retval = PM_RET_OK;
+    ssize_t got = -1;
+    int fd;
+
+    fd = open((char const *)fn, O_RDONLY);
+    if (fd >= 0)
+    {
+        got = pread(fd, pbuf, (size_t)len, (off_t)offset);
+        close(fd);
+    }
+    if (got != (ssize_t)len)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+    }
+    return retval;
+}
+
+
+PmReturn_t
+plat_writeFile(uint8_t const *fn, uint32_t offset,
+               uint8_t const *pbuf, uint32_t len)
+{
+    PmReturn_t retval = PM_RET_OK;
+    ssize_t put = -1;
+    int fd;
+
+    fd = open((char const *)fn,
+              (offset == 0) ? (O_WRONLY | O_CREAT | O_TRUNC) : O_WRONLY,
+              0644);
+    if (fd >= 0)
+    {
+        put = pwrite(fd, pbuf, (size_t)len, (off_t)offset);
+        if (close(fd) != 0)
+        {
+            put = -1;
+        }
+    }
+    if (put != (ssize_t)len)
+    {
+        PM_RAISE(retval, PM_RET_EX_IO);
+    }
+    return retval;
+}
+
+
 void 
 plat_reportError(PmReturn_t result)
 {
@@ -28,6 +28,19 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: pm_snapshot() refuses images of other memspaces
+ * 2008/03/19   #141: Add pm_setBaseline() and pm_reset()
+ * 2008/03/17   #140: Add pm_snapshot() and pm_restore(), no snapshot
+ *              is made of images in RAM outside the heap; a snapshot
+ *              of other images is refused before the VM is read
+ * 2008/03/15   #139: pm_loadImgFile() is done by img_findInFile()
+ * 2008/03/13   #138: Add pm_loadImgFile()
+ * 2008/03/07   #135: Flush the output when the root module ends
+ * 2008/03/03   #133: pm_vmPeriodic() on a native thread bound to no VM
+ *              only counts the time
+ * 2008/03/01   #132: End the running thread's slice on the tick
+ * 2008/02/22   #129: Add pm_bindVm()
+ * 2008/02/16   #126: Reschedule on the tick a sleeping thread wakes
  * 2007/01/09   #75: Refactored for green thread support (P.Adelt)
  * 2006/09/16   #16: Create pm_init() that does the initial housekeeping
  */
@@ -35,16 +48,125 @@
 #include "pm.h"
 
 
-/** Number of millisecond-ticks to pass before scheduler is run */
-#define PM_THREAD_TIMESLICE_MS  10
-
 extern unsigned char stdlib_img[];
 
 /* Stores the timer millisecond-ticks since system start */
 volatile uint32_t pm_timerMsTicks = 0;
 
-/* Stores tick timestamp of last scheduler run */
-volatile uint32_t pm_lastRescheduleTimestamp = 0;
+/*
+ * Returns true if the VM is at rest: it has no threads, none of its
+ * natives is running and no image file is loaded
+ */
+static uint8_t
+pm_isAtRest(void)
+{
+    if ((gVmGlobal.threadList->length != 0)
+        || gVmGlobal.nativeframe.nf_active)
+    {
+        return C_FALSE;
+    }
+#ifdef TARGET_DESKTOP
+    if ((gVmGlobal.ioWaits != 0) || (gVmGlobal.pimgfiles != C_NULL))
+    {
+        return C_FALSE;
+    }
+#endif /* TARGET_DESKTOP */
+    return C_TRUE;
+}
+
+
+#if USE_HEAP_SNAPSHOT
+/** Starts a snapshot file; the VM's bytes follow it */
+typedef struct PmSnapshotHdr_s
+{
+    /** "PmVm" */
+    uint8_t sh_magic[4];
+
+    /** PM_RELEASE of the VM that saved it */
+    uint16_t sh_release;
+
+    /** CRC-16 of the images of the program, stdlib_img's then the user's */
+    uint16_t sh_imgCrc;
+
+    /** sizeof(PmVm_t); differs if the VM was built otherwise */
+    uint32_t sh_size;
+
+    /**
+     * Offset of the user's images from stdlib_img; the pointers into both
+     * are moved by one amount, so it must be the same
+     */
+    int32_t sh_usrOffset;
+
+    /** Address of the VM that was saved */
+    uint8_t const *sh_vm;
+
+    /** Address of stdlib_img when it was saved */
+    uint8_t const *sh_img;
+} PmSnapshotHdr_t;
+
+
+/* Adds the bytes to the CRC-16 (CCITT) */
+static uint16_t
+pm_crc(uint16_t crc, uint8_t const *pbuf, uint16_t n)
+{
+    uint8_t i;
+
+    while (n-- > 0)
+    {
+        crc ^= (uint16_t)*pbuf++ << 8;
+        for (i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                                 : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+
+/*
+ * Adds the bytes of the set of images in the program to the CRC: its
+ * pool if it has one, and each image up to the byte that ends the set
+ */
+static uint16_t
+pm_crcImgs(uint16_t crc, uint8_t const *pimg)
+{
+    uint16_t size;
+
+    if (*pimg == OBJ_TYPE_PIM)
+    {
+        size = pimg[1] | (pimg[2] << 8);
+        crc = pm_crc(crc, pimg, size);
+        pimg += size;
+    }
+    while (IMG_IS_IMAGE(*pimg))
+    {
+        size = pimg[1] | (pimg[2] << 8);
+        crc = pm_crc(crc, pimg, size);
+        pimg += size;
+    }
+    return pm_crc(crc, pimg, 1);
+}
+
+
+/* Makes the header of a snapshot of the VM with the program's images */
+static void
+pm_snapshotHdr(uint8_t const *pusrimg, PmSnapshotHdr_t *phdr)
+{
+    sli_memcpy(phdr->sh_magic, (uint8_t const *)"PmVm", 4);
+    phdr->sh_release = PM_RELEASE;
+    phdr->sh_imgCrc = pm_crcImgs(0xFFFF, stdlib_img);
+    phdr->sh_usrOffset = 0;
+    if (pusrimg != C_NULL)
+    {
+        phdr->sh_imgCrc = pm_crcImgs(phdr->sh_imgCrc, pusrimg);
+        phdr->sh_usrOffset = (int32_t)(pusrimg - stdlib_img);
+    }
+    phdr->sh_size = sizeof(PmVm_t);
+    phdr->sh_vm = (uint8_t const *)PM_VM;
+    phdr->sh_img = stdlib_img;
+}
+#endif /* USE_HEAP_SNAPSHOT */
 
 PmReturn_t
 pm_init(PmMemSpace_t memspace, uint8_t *pusrimg)
@@ -79,6 +201,190 @@ pm_init(PmMemSpace_t memspace, uint8_t *pusrimg)
 }
 
 
+#ifdef TARGET_DESKTOP
+PmReturn_t
+pm_loadImgFile(uint8_t const *fn)
+{
+    return img_findInFile(fn);
+}
+#endif /* TARGET_DESKTOP */
+
+
+#if USE_HEAP_SNAPSHOT
+PmReturn_t
+pm_snapshot(uint8_t const *fn, uint8_t const *pusrimg)
+{
+    PmReturn_t retval;
+    PmSnapshotHdr_t hdr;
+    pPmImgInfo_t pii;
+
+    /* Only a VM at rest can be saved */
+    if (!pm_isAtRest())
+    {
+        PM_RAISE(retval, PM_RET_EX_SYS);
+        return retval;
+    }
+
+    /*
+     * Only images in the program, or in RAM in the VM's heap, can be found
+     * after a restore; other RAM is not in the snapshot
+     */
+    for (pii = gVmGlobal.pimglist; pii != C_NULL; pii = pii->next)
+    {
+        if ((pii->ii_memspace > MEMSPACE_PROG)
+            || ((pii->ii_memspace == MEMSPACE_RAM)
+                && ((pii->ii_addr < PM_VM->vm_heap.base)
+                    || (pii->ii_addr >= PM_VM->vm_heap.base + HEAP_SIZE))))
+        {
+            PM_RAISE(retval, PM_RET_EX_SYS);
+            return retval;
+        }
+    }
+
+    /* Leave out the garbage; what is left lies in fewer free chunks */
+    retval = heap_gcRun();
+    PM_RETURN_IF_ERROR(retval);
+
+    pm_snapshotHdr(pusrimg, &hdr);
+    retval = plat_writeFile(fn, 0, (uint8_t const *)&hdr, sizeof(hdr));
+    PM_RETURN_IF_ERROR(retval);
+    return plat_writeFile(fn, sizeof(hdr), (uint8_t const *)PM_VM,
+                          sizeof(PmVm_t));
+}
+
+
+PmReturn_t
+pm_restore(uint8_t const *fn, uint8_t const *pusrimg)
+{
+    PmReturn_t retval;
+    PmSnapshotHdr_t hdr;
+    PmSnapshotHdr_t ours;
+
+    retval = plat_init();
+    PM_RETURN_IF_ERROR(retval);
+
+    /* Refuse a snapshot of another build or other images; the VM is kept */
+    retval = plat_readFile(fn, 0, (uint8_t *)&hdr, sizeof(hdr));
+    PM_RETURN_IF_ERROR(retval);
+    pm_snapshotHdr(pusrimg, &ours);
+    if ((sli_strncmp(hdr.sh_magic, ours.sh_magic, 4) != 0)
+        || (hdr.sh_release != ours.sh_release)
+        || (hdr.sh_imgCrc != ours.sh_imgCrc)
+        || (hdr.sh_size != ours.sh_size)
+        || (hdr.sh_usrOffset != ours.sh_usrOffset))
+    {
+        PM_RAISE(retval, PM_RET_EX_VAL);
+        return retval;
+    }
+
+    /* Read the whole VM at once, then move its pointers */
+    retval = plat_readFile(fn, sizeof(hdr), (uint8_t *)PM_VM,
+                           sizeof(PmVm_t));
+    PM_RETURN_IF_ERROR(retval);
+    heap_relocate(hdr.sh_vm, hdr.sh_img, stdlib_img);
+
+    /* What the old process had of the platform is gone */
+    gVmGlobal.ioEpoll = 0;
+    gVmGlobal.timerTick = pm_timerMsTicks;
+
+    /* So is its baseline, which is not in the snapshot */
+    gVmGlobal.pbaseline = C_NULL;
+    gVmGlobal.baselineUsed = 0;
+#if USE_MEM_CACHE
+    sli_memset((uint8_t *)&gVmGlobal.memCache, 0, sizeof(PmMemCache_t));
+#endif /* USE_MEM_CACHE */
+
+    return retval;
+}
+#endif /* USE_HEAP_SNAPSHOT */
+
+
+PmReturn_t
+pm_setBaseline(pPmVm_t pbase)
+{
+    PmReturn_t retval = PM_RET_OK;
+
+    if (!pm_isAtRest())
+    {
+        PM_RAISE(retval, PM_RET_EX_SYS);
+        return retval;
+    }
+
+    /* Load the builtins now, so the runs after a reset needn't */
+    if (PM_PBUILTINS == C_NULL)
+    {
+        retval = global_loadBuiltins();
+        PM_RETURN_IF_ERROR(retval);
+    }
+
+    /* Gather the chunks in use at the start of the heap */
+    retval = heap_gcRun();
+    PM_RETURN_IF_ERROR(retval);
+
+    /* The copy holds its own address, so a reset keeps it */
+    gVmGlobal.pbaseline = pbase;
+    gVmGlobal.baselineUsed = heap_getUsed();
+    sli_memcpy((uint8_t *)pbase, (uint8_t const *)PM_VM, sizeof(PmVm_t));
+    return retval;
+}
+
+
+PmReturn_t
+pm_reset(void)
+{
+    PmReturn_t retval = PM_RET_OK;
+    pPmVm_t pbase = gVmGlobal.pbaseline;
+#ifdef TARGET_DESKTOP
+    pPmImgFile_t pfile;
+#endif /* TARGET_DESKTOP */
+
+    if (pbase == C_NULL)
+    {
+        PM_RAISE(retval, PM_RET_EX_SYS);
+        return retval;
+    }
+
+#ifdef TARGET_DESKTOP
+    /* The baseline has no image files or I/O waits */
+    for (pfile = gVmGlobal.pimgfiles; pfile != C_NULL; pfile = pfile->next)
+    {
+        plat_unmapFile(pfile->if_addr, pfile->if_len);
+    }
+    plat_closeIo();
+#endif /* TARGET_DESKTOP */
+
+    /*
+     * Copy the globals, the start of the heap that holds the baseline's
+     * chunks and the heap fields after the heap's bytes.  The free space
+     * after the chunks is not copied.
+     */
+    sli_memcpy((uint8_t *)&PM_VM->vm_global,
+               (uint8_t const *)&pbase->vm_global, sizeof(PmVmGlobal_t));
+    sli_memcpy(PM_VM->vm_heap.base, pbase->vm_heap.base,
+               gVmGlobal.baselineUsed);
+    sli_memcpy((uint8_t *)&PM_VM->vm_heap.pfreelist,
+               (uint8_t const *)&pbase->vm_heap.pfreelist,
+               (uint8_t *)(&pbase->vm_heap + 1)
+               - (uint8_t *)&pbase->vm_heap.pfreelist);
+
+#ifdef TARGET_DESKTOP
+    /* The baseline's epoll set, if it had one, was closed above */
+    gVmGlobal.ioEpoll = 0;
+#endif /* TARGET_DESKTOP */
+    gVmGlobal.timerTick = pm_timerMsTicks;
+    return retval;
+}
+
+
+#if USE_MULTI_VM
+void
+pm_bindVm(pPmVm_t pvm)
+{
+    pm_vm = pvm;
+}
+#endif /* USE_MULTI_VM */
+
+
 PmReturn_t
 pm_run(uint8_t const *modstr)
 {
@@ -102,6 +408,9 @@ pm_run(uint8_t const *modstr)
     PM_RETURN_IF_ERROR(retval);
     retval = interpret(INTERP_RETURN_ON_NO_THREADS);
 
+    /* Send what the threads printed last */
+    plat_flush();
+
     PM_REPORT_IF_ERROR(retval);
 
     return retval;
@@ -128,14 +437,34 @@ pm_vmPeriodic(uint16_t usecsSinceLastCall)
         pm_timerMsTicks++;
     }
 
-#if USE_TIMED_PERIODIC_PREEMPTION == 1    /* Check if enough time has passed for a scheduler run */
-    if ((pm_timerMsTicks - pm_lastRescheduleTimestamp)
-        >= PM_THREAD_TIMESLICE_MS)
+#if USE_MULTI_VM
+    /* #133: A tick thread of its own has no VM to reschedule */
+    if (PM_VM == C_NULL)
+    {
+        return PM_RET_OK;
+    }
+#endif /* USE_MULTI_VM */
+
+#if INTERP_PREEMPTIVE_MULTITASKING == 1
+    /*
+     * #132: Reschedule when the running thread's slice is over; the
+     * interpreter sees the flag at its next backward jump or call
+     */
+    if (THREAD_IS_SLICE_OVER())
+    {
+        VM_SET_RESCHEDULE(1);
+    }
+#endif /* INTERP_PREEMPTIVE_MULTITASKING */
+
+    /*
+     * #126: Reschedule when the timer wheel slot of this tick holds a
+     * sleeping thread; the interpreter wakes it (not done here, since
+     * the thread queues must not change in interrupt context).
+     */
+    if (gVmGlobal.timerWheel[THREAD_TIMER_SLOT(pm_timerMsTicks)] != C_NULL)
     {
         VM_SET_RESCHEDULE(1);
-        pm_lastRescheduleTimestamp = pm_timerMsTicks;
     }
-#endif /* USE_TIMED_PERIODIC_PREEMPTION */
 
     return PM_RET_OK;
 }
@@ -28,6 +28,17 @@
  * Log
  * ---
  *
+ * 2008/03/21   #142: pm_snapshot() refuses images of other memspaces
+ * 2008/03/19   #141: Add pm_setBaseline() and pm_reset()
+ * 2008/03/17   #140: Add pm_snapshot() and pm_restore(), no snapshot
+ *              is made of images in RAM outside the heap; both take
+ *              the user's images, which name the snapshot's build
+ * 2008/03/15   #139: pm_loadImgFile() replaces images, to reload modules
+ * 2008/03/13   #138: Add pm_loadImgFile() for the desktop
+ * 2008/03/03   #133: A native thread may be bound to no VM
+ * 2008/02/22   #129: Add pm_bindVm(), include class.h before global.h
+ * 2008/02/20   #128: Include event.h
+ * 2008/02/18   #127: Include sync.h
  * 2006/09/16   #16: Create pm_init() that does the initial housekeeping
  * 2006/08/31   #9: Fix BINARY_SUBSCR for case stringobj[intobj]
  * 2006/08/30   #6: Have pmImgCreator append a null terminator to image list
@@ -235,11 +246,13 @@ extern volatile uint32_t pm_timerMsTicks;
 #include "frame.h"
 #include "interp.h"
 #include "img.h"
+#include "event.h"
+#include "class.h"
 #include "global.h"
 #include "misc.h"
 #include "thread.h"
+#include "sync.h"
 #include "slice.h"
-#include "class.h"
 #include "plat/plat.h"
 
 
@@ -266,11 +279,119 @@ PmReturn_t pm_init(PmMemSpace_t memspace, uint8_t *pusrimg);
  */
 PmReturn_t pm_run(uint8_t const *modstr);
 
+#ifdef TARGET_DESKTOP
+/**
+ * Indexes the images in a file made by "pmImgCreator.py -b -u".
+ * The file is mapped, not copied, so the VMs of all processes that
+ * load it share its pages.  Call after pm_init(), or from Python
+ * with os.loadImg().  Its images replace any image of the same name
+ * indexed earlier, such as one in usrlib_img or in a file loaded
+ * before (the same file may be loaded again after it changed).
+ *
+ * Imports that come after get a new module from the new image;
+ * modules imported before, and the frames running their code, keep
+ * the old image.  A file is unmapped by the GC once none of its images
+ * is indexed or used by a code obj.
+ *
+ * The images must not have native code, unless the native code is
+ * linked into the program as the user natives of the same images.
+ * To change a file while a VM uses it, write a new file and rename it
+ * over the old one; the mapped pages must not change.
+ *
+ * @param fn            Name of the image file
+ * @return Return status; PM_RET_EX_IO if the file can't be mapped,
+ *         PM_RET_EX_TYPE if it doesn't hold a list of images
+ */
+PmReturn_t pm_loadImgFile(uint8_t const *fn);
+#endif /* TARGET_DESKTOP */
+
+#if USE_HEAP_SNAPSHOT
+/**
+ * Saves the state of the VM, its heap and globals, to a file.
+ * Call it from the host program once the VM is warmed up, for instance
+ * after pm_init() and a pm_run() of a module that imports the rest;
+ * pm_restore() then starts a new process with that state.
+ *
+ * The VM must be at rest: it has no threads, none of its natives is
+ * running and no image file is loaded (see pm_loadImgFile()).
+ * Its images must be in the program (MEMSPACE_PROG), or in RAM in
+ * the VM's heap; a RAM buffer of the host program is not saved.
+ *
+ * @param fn            Name of the snapshot file
+ * @param pusrimg       The user's images given to pm_init(), or C_NULL
+ * @return Return status; PM_RET_EX_SYS if the VM is not at rest or has
+ *         images elsewhere
+ */
+PmReturn_t pm_snapshot(uint8_t const *fn, uint8_t const *pusrimg);
+
+/**
+ * Initializes the VM from a file saved by pm_snapshot() in place of
+ * pm_init(); the state is read at once and its pointers are moved to
+ * where the VM and the code images are in this process.
+ *
+ * The snapshot must have been saved by the same program.  If it is
+ * of another build or its images differ, the restore fails before the
+ * VM is read, and the VM must be made with pm_init().
+ *
+ * A baseline set with pm_setBaseline() is not saved; set one again
+ * after the restore to use pm_reset().
+ *
+ * @param fn            Name of the snapshot file
+ * @param pusrimg       The user's images, as given to pm_snapshot()
+ * @return Return status; PM_RET_EX_IO if the file can't be read,
+ *         PM_RET_EX_VAL if it is of another program
+ */
+PmReturn_t pm_restore(uint8_t const *fn, uint8_t const *pusrimg);
+#endif /* USE_HEAP_SNAPSHOT */
+
+/**
+ * Copies the VM to the given baseline, for pm_reset() to return to.
+ * Call it after pm_init(), or after a pm_run() of a module that
+ * warms the VM up; the builtins are loaded first if they weren't.
+ *
+ * The VM must be at rest: it has no threads, none of its natives is
+ * running and, on the desktop, no image file is loaded.
+ *
+ * @param pbase         Storage for the copy; must last as long as the VM
+ * @return Return status; PM_RET_EX_SYS if the VM is not at rest
+ */
+PmReturn_t pm_setBaseline(pPmVm_t pbase);
+
+/**
+ * Returns the VM to its state at pm_setBaseline(), to run the next
+ * module as if in a new VM.  Only the part of the heap in use at the
+ * baseline is copied back, so it costs far less than pm_init().
+ * Image files loaded since are unmapped and, on the desktop, the
+ * descriptors of I/O waits and the VM's epoll set are closed.
+ *
+ * Call it after pm_run() has returned, whether or not the run failed.
+ *
+ * @return Return status; PM_RET_EX_SYS if there is no baseline
+ */
+PmReturn_t pm_reset(void);
+
+#if USE_MULTI_VM
+/**
+ * Binds a VM to the calling native thread.  The thread's calls to
+ * pm_init(), pm_run() and the rest of the VM then act on that VM.
+ * A native thread that binds no VM uses pm_vmDefault.
+ * Binding C_NULL leaves the thread with no VM, fit only to call
+ * pm_vmPeriodic().
+ * A VM must be used by one native thread at a time.
+ *
+ * @param pvm           VM; must last as long as it is used
+ */
+void pm_bindVm(pPmVm_t pvm);
+#endif /* USE_MULTI_VM */
+
 /**
  * Needs to be called periodically by the host program.
- * For the desktop target, it is periodically called using a signal.
+ * For the desktop target, it is periodically called by a tick thread.
  * For embedded targets, it needs to be called periodically. It should
  * be called from a timer interrupt.
+ * The tick count is shared by all VMs; the reschedule request is made
+ * to the VM of the interrupted native thread, if it is bound to one.
+ * Other VMs look at the tick count themselves.
  *
  * @param usecsSinceLastCall Microseconds (not less than those) that passed
  *                           since last call. This must be <64535.
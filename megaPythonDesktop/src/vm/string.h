@@ -28,6 +28,10 @@
  * Log
  * ---
  *
+ * 2008/02/12   #124: Add slice views and the single-char strings
+ * 2008/02/10   #123: Add string_concat() and string_join(),
+ *              add string_cacheSweep()
+ * 2008/02/04   #110: Add string_hash() for the image index
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
  * 2007/01/10   #75: Printing support (P.Adelt)
  * 2006/08/31   #9: Fix BINARY_SUBSCR for case stringobj[intobj]
@@ -43,6 +47,27 @@
 /** Set to nonzero to enable string cache */
 #define USE_STRING_CACHE 1
 
+/**
+ * Set to nonzero to make string slices refer to the chars of the sliced
+ * string instead of copying them.  Costs a pointer in every String obj.
+ */
+#ifndef USE_STRING_VIEWS
+#define USE_STRING_VIEWS 1
+#endif
+
+/**
+ * Set to nonzero to keep every single-char string once it is made,
+ * so indexing and iterating over strings do not allocate.
+ * Costs a table of 256 pointers in the VM globals.
+ */
+#ifndef USE_STRING_CHARS
+#ifdef TARGET_AVR
+#define USE_STRING_CHARS 0
+#else
+#define USE_STRING_CHARS 1
+#endif
+#endif
+
 
 /***************************************************************
  * Macros
@@ -66,6 +91,22 @@
 #define string_new(s, r_pstring) \
             string_create(MEMSPACE_RAM, (s), (uint8_t)0, (r_pstring))
 
+/**
+ * Gets a pointer to the chars of a String obj.
+ * The chars of a slice view are not null terminated; use the length.
+ *
+ * @param pstr Ptr to String obj
+ */
+#if USE_STRING_VIEWS
+#define STRING_GET_CHARS(pstr) \
+            ((((pPmString_t)(pstr))->parent == C_NULL) \
+             ? ((pPmString_t)(pstr))->val \
+             : &((pPmString_t)(pstr))->parent \
+                 ->val[((pPmStringView_t)(pstr))->offset])
+#else
+#define STRING_GET_CHARS(pstr) (((pPmString_t)(pstr))->val)
+#endif /* USE_STRING_VIEWS */
+
 /***************************************************************
  * Types
  **************************************************************/
@@ -88,6 +129,11 @@ typedef struct PmString_s
     struct PmString_s *next;
 #endif                          /* USE_STRING_CACHE */
 
+#if USE_STRING_VIEWS
+    /** String whose chars this slice view uses; C_NULL if it has its own */
+    struct PmString_s *parent;
+#endif                          /* USE_STRING_VIEWS */
+
     /**
      * Null-term char array
      *
@@ -98,6 +144,37 @@ typedef struct PmString_s
 } PmString_t,
  *pPmString_t;
 
+#if USE_STRING_VIEWS
+/**
+ * String slice view
+ *
+ * A String obj (of type OBJ_TYPE_STR) made by slicing another string.
+ * It starts like PmString_t, with parent set, and holds the offset of
+ * its chars in the parent where a string would hold its own chars.
+ * The parent always has its own chars.
+ */
+typedef struct PmStringView_s
+{
+    /** Object descriptor */
+    PmObjDesc_t od;
+
+    /** Length of string */
+    uint16_t length;
+
+#if USE_STRING_CACHE
+    /** Always C_NULL; views are not in the cache */
+    struct PmString_s *next;
+#endif                          /* USE_STRING_CACHE */
+
+    /** String whose chars this view uses */
+    struct PmString_s *parent;
+
+    /** Index in the parent's chars of this string's first char */
+    uint16_t offset;
+} PmStringView_t,
+ *pPmStringView_t;
+#endif /* USE_STRING_VIEWS */
+
 
 /***************************************************************
  * Prototypes
@@ -132,9 +209,24 @@ typedef struct PmString_s
 PmReturn_t string_create(PmMemSpace_t memspace, uint8_t const **paddr,
                          uint8_t isimg, pPmObj_t *r_pstring);
 
+/**
+ * Allocates a String obj of the given length whose chars are to be
+ * filled in by the caller.  The char after the last is set to null.
+ *
+ * The new string is not put in the string cache.
+ *
+ * @param   len Length of the string
+ * @param   r_pstr Return arg; ptr to String obj
+ * @return  Return status
+ */
+PmReturn_t string_alloc(uint16_t len, pPmString_t *r_pstr);
+
 /**
  * Creates a new String object from a single character.
  *
+ * If USE_STRING_CHARS is nonzero, the same String obj is returned for
+ * every request of the same char, and it is never freed.
+ *
  * @param   c the character to become the string
  * @param   r_psting Return arg; ptr to String obj
  * @return  Return status
@@ -150,6 +242,65 @@ PmReturn_t string_newFromChar(uint8_t const c, pPmObj_t *r_pstring);
  */
 int8_t string_compare(pPmString_t, pPmString_t);
 
+/**
+ * Creates a new String obj holding the contents of one string
+ * followed by another.
+ *
+ * The new string is not put in the string cache.
+ *
+ * @param   pstr1 Ptr to first string
+ * @param   pstr2 Ptr to second string
+ * @param   r_pstring Return arg; ptr to String obj
+ * @return  Return status
+ */
+PmReturn_t string_concat(pPmString_t pstr1, pPmString_t pstr2,
+                         pPmObj_t *r_pstring);
+
+/**
+ * Creates a new String obj from the strings in a tuple or list,
+ * with the separator string between each of them.
+ *
+ * The result is made with a single allocation no matter how many
+ * pieces there are, so collecting the pieces in a list and joining them
+ * once takes linear time where repeated concatenation would not.
+ * The new string is not put in the string cache.
+ *
+ * @param   psep Ptr to separator string
+ * @param   pseq Ptr to tuple or list of strings
+ * @param   r_pstring Return arg; ptr to String obj
+ * @return  Return status; TypeError if an arg or piece is the wrong type
+ */
+PmReturn_t string_join(pPmObj_t psep, pPmObj_t pseq, pPmObj_t *r_pstring);
+
+/**
+ * Gets a slice of a string, like Python's s[start:end:step].
+ *
+ * Indices are adjusted and clipped as Python does.
+ * A slice of consecutive chars from a long enough string is a view of
+ * the string's chars (if USE_STRING_VIEWS is nonzero); other slices
+ * are copied.
+ *
+ * @param   pstr Ptr to String obj to slice
+ * @param   start Index of the first char
+ * @param   end Index to stop before
+ * @param   step Distance between the chars
+ * @param   r_pstring Return arg; ptr to String obj
+ * @return  Return status; ValueError if step is zero
+ */
+PmReturn_t string_getSlice(pPmObj_t pstr, int16_t start, int16_t end,
+                           int16_t step, pPmObj_t *r_pstring);
+
+/**
+ * Computes a hash value of the string's contents.
+ *
+ * The value is meant for indexing small tables (such as the image index),
+ * so only its low bits are expected to be used.
+ *
+ * @param   pstr Ptr to string obj
+ * @return  Hash value of the string's characters
+ */
+uint16_t string_hash(pPmString_t pstr);
+
 #ifdef HAVE_PRINT
 /**
  * Sends out a string object bytewise. Escaping and framing is configurable
@@ -171,4 +322,11 @@ PmReturn_t string_print(pPmObj_t pstr, uint8_t marshall);
  */
 PmReturn_t string_cacheInit(void);
 
+/**
+ * Removes the strings the GC did not mark from the string cache.
+ * Called by heap_gcRun() between marking and sweeping,
+ * so the cache never refers to a freed string.
+ */
+void string_cacheSweep(void);
+
 #endif /* __STRING_H__ */
@@ -28,6 +28,7 @@
  * Log
  * ---
  *
+ * 2008/03/07   #135: Print the separator with one plat_putBytes()
  * 2007/01/17   #76: Print will differentiate on strings and print tuples
  * 2006/08/29   #15 - All mem_*() funcs and pointers in the vm should use
  *              unsigned not signed or void
@@ -242,8 +243,8 @@ tuple_print(pPmObj_t ptup)
     {
         if (index != 0)
         {
-            plat_putByte(',');
-            plat_putByte(' ');
+            retval = plat_putBytes((uint8_t const *)", ", 2);
+            PM_RETURN_IF_ERROR(retval);
         }
         retval = obj_print(((pPmTuple_t)ptup)->val[index], 1);
         PM_RETURN_IF_ERROR(retval);